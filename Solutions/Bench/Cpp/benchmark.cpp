@@ -0,0 +1,684 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Unified benchmark harness for the solution kernels
+//
+//  PURPOSE: Run every kernel variant of the solution drivers over a sweep
+//           of problem sizes, and report statistics of the kernel times
+//           in a form that can be tracked across driver and hardware
+//           updates:
+//
+//             suite     kernels                          size
+//             vadd      Exercise04 vadd (c = a + b)      vector length
+//             vadd_abc  Exercise05 vadd (d = a + b + c)  vector length
+//             mult      Exercise06-08 matmul kernels     order of A, B, C
+//             gemv      Exercise08 sgemv, sgemv_batched  order of A
+//             pi_ocl    Exercise09 pi                    integration steps
+//             pi_vocl   ExerciseA pi, pi_vec4, pi_vec8   integration steps
+//             life      Exercise13 accelerate_life       board edge
+//
+//           The kernel sources of the exercises are embedded when the
+//           harness is built (see the Makefile), so it measures the same
+//           sources the drivers run.  Each run is timed from its event
+//           (START to END) on a queue created with profiling enabled.  The
+//           first --warmup runs of every variant and size are discarded,
+//           the next --reps are summarised as min, median, mean and
+//           standard deviation (see bench.hpp).
+//
+//           Before the suites, two microbenchmarks measure the peak
+//           multiply-add rate (../roofline.cl) and the global memory
+//           bandwidth of the device, the latter with stream_bandwidth()
+//           from libmatmul.a, the roof the sgemv driver uses too.  The vadd, mult and pi results are
+//           then placed on that roofline from the flops and bytes of one
+//           run: arithmetic intensity, percentage of the attainable rate
+//           and whether the variant is memory or compute bound.  The
+//           bytes are the global loads and stores a kernel issues, with
+//           no reuse through caches assumed, so a kernel that caches
+//           well can pass 100% of its memory roof.
+//
+//  USAGE:   ./benchmark [--device INDEX] [--reps N] [--warmup N]
+//                       [--only SUITE] [--sizes SUITE=n1,n2,...]
+//                       [--csv FILE] [--json FILE] [--no-roofline]
+//
+//           'make bench' builds the harness and writes bench.csv and
+//           bench.json with the default sweeps.
+//
+//  HISTORY: Written for tracking the performance of the solutions
+//
+//------------------------------------------------------------------------------
+
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <sstream>
+
+#include "matmul.hpp"
+#include "tuner.hpp"
+#include "gemv.hpp"
+#include "bench.hpp"
+#include "util.hpp"
+#include "kernel_registry.hpp"
+#include "program_cache.hpp"
+#include "err_code.h"
+#include "device_picker.hpp"
+
+//------------------------------------------------------------------------------
+//  The tuning database of the Exercise08 driver, relative to Bench/Cpp
+//------------------------------------------------------------------------------
+#define MULT_TUNE_DB "../../Exercise08/Cpp/" TUNE_DB
+
+//------------------------------------------------------------------------------
+//  Defaults
+//------------------------------------------------------------------------------
+#define BENCH_REPS    10      // timed runs of each variant and size
+#define BENCH_WARMUP  2       // discarded runs before them
+#define PI_ITERS      1024    // integration steps per work-item
+#define LIFE_BLOCK    16      // work-group is LIFE_BLOCK x LIFE_BLOCK cells
+#define PI_FLOPS      6       // flops per integration step
+#define PEAK_FMA_ITERS 1024   // loop trips of the peak_fma kernel
+#define PEAK_FMA_FLOPS (8 * 4 * 2)  // flops per trip (roofline.cl)
+
+typedef std::function<cl::Event()> Launch;
+typedef std::vector<size_t> Sizes;
+
+//------------------------------------------------------------------------------
+//
+//  Options and the default size sweeps of each suite
+//
+//------------------------------------------------------------------------------
+struct Options
+{
+    int reps;
+    int warmup;
+    std::string only;
+    std::map<std::string, Sizes> sizes;
+};
+
+static Sizes default_sizes(const std::string& suite)
+{
+    static const size_t vadd[] = {1 << 16, 1 << 20, 1 << 24};
+    static const size_t mult[] = {256, 512, 1024};
+    static const size_t gemv[] = {1024, 4096, 8192};
+    static const size_t pi[]   = {1 << 22, 1 << 24, 1 << 26};
+    static const size_t life[] = {256, 1024, 4096};
+
+    if (suite == "vadd" || suite == "vadd_abc")
+        return Sizes(vadd, vadd + 3);
+    if (suite == "mult")
+        return Sizes(mult, mult + 3);
+    if (suite == "gemv")
+        return Sizes(gemv, gemv + 3);
+    if (suite == "pi_ocl" || suite == "pi_vocl")
+        return Sizes(pi, pi + 3);
+    return Sizes(life, life + 3);
+}
+
+static bool wanted(const Options& opt, const std::string& suite)
+{
+    return opt.only.empty() || opt.only == suite;
+}
+
+static const Sizes& sizes_of(Options& opt, const std::string& suite)
+{
+    if (opt.sizes.find(suite) == opt.sizes.end())
+        opt.sizes[suite] = default_sizes(suite);
+    return opt.sizes[suite];
+}
+
+static std::string size_label(size_t n)
+{
+    std::ostringstream s;
+    s << n;
+    return s.str();
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run a kernel warmup + reps times and return the kernel time
+//  of each timed run in seconds
+//
+//------------------------------------------------------------------------------
+static std::vector<double> time_runs(const Options& opt, cl::CommandQueue& queue, Launch launch)
+{
+    std::vector<double> samples;
+
+    for (int i = 0; i < opt.warmup; i++)
+        launch();
+    queue.finish();
+
+    for (int i = 0; i < opt.reps; i++)
+    {
+        cl::Event event = launch();
+        event.wait();
+        cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        cl_ulong end   = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+        samples.push_back((end - start) * 1.0e-9);
+    }
+    return samples;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to measure the ceilings of the roofline: the best of the timed
+//  runs of each microbenchmark, so noise can only lower the peaks
+//
+//------------------------------------------------------------------------------
+static bench::Roofline measure_peaks(cl::Context& context, cl::Device& device,
+    cl::CommandQueue& queue, const Options& opt)
+{
+    cl::Program program = util::buildProgram(context, util::kernelSource("roofline.cl"));
+    bench::Roofline peaks;
+
+    // Multiply-add rate, with every compute unit given several work-groups
+    cl::Kernel fma(program, "peak_fma");
+    const size_t wg = fma.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+    const size_t items = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() * wg * 8;
+    cl::Buffer d_out(context, CL_MEM_WRITE_ONLY, sizeof(float) * items);
+    fma.setArg(0, PEAK_FMA_ITERS);
+    fma.setArg(1, 0.999f);
+    fma.setArg(2, 0.001f);
+    fma.setArg(3, d_out);
+
+    std::vector<double> t = time_runs(opt, queue, [&]() {
+        cl::Event event;
+        queue.enqueueNDRangeKernel(fma, cl::NullRange, cl::NDRange(items), cl::NullRange, NULL, &event);
+        return event; });
+    peaks.gflops = (double)items * PEAK_FMA_ITERS * PEAK_FMA_FLOPS / bench::summarize(t).min / 1.0e9;
+
+    // Bandwidth of b = s * a, measured as the Exercise08 driver does
+    peaks.gbs = stream_bandwidth(queue, opt.warmup, opt.reps);
+
+    printf(" Peaks: %.1f GFLOPS (multiply-add), %.1f GB/s (stream scale), ridge at %.2f flop/B\n\n",
+        peaks.gflops, peaks.gbs, peaks.gflops / peaks.gbs);
+    return peaks;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Vector addition: Exercise04 (c = a + b) and Exercise05 (d = a + b + c)
+//
+//------------------------------------------------------------------------------
+static void bench_vadd(cl::Context& context, cl::CommandQueue& queue, Options& opt,
+    bench::Report& report)
+{
+    cl::Program p2 = util::buildProgram(context, util::kernelSource("vadd_chain.cl"));
+    cl::Program p3 = util::buildProgram(context, util::kernelSource("vadd_abc.cl"));
+    cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, unsigned int> vadd(p2, "vadd");
+    cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, unsigned int> vadd_abc(p3, "vadd");
+
+    std::string suites[2] = {"vadd", "vadd_abc"};
+    for (int s = 0; s < 2; s++)
+    {
+        if (!wanted(opt, suites[s]))
+            continue;
+
+        const Sizes& sizes = sizes_of(opt, suites[s]);
+        for (size_t i = 0; i < sizes.size(); i++)
+        {
+            const unsigned int n = (unsigned int)sizes[i];
+            std::vector<float> h(n, 1.0f);
+            cl::Buffer d_a(context, h.begin(), h.end(), true);
+            cl::Buffer d_b(context, h.begin(), h.end(), true);
+            cl::Buffer d_c(context, h.begin(), h.end(), true);
+            cl::Buffer d_d(context, CL_MEM_WRITE_ONLY, sizeof(float) * n);
+
+            std::vector<double> t;
+            if (s == 0)
+                t = time_runs(opt, queue, [&]() {
+                    return vadd(cl::EnqueueArgs(queue, cl::NDRange(n)), d_a, d_b, d_d, n); });
+            else
+                t = time_runs(opt, queue, [&]() {
+                    return vadd_abc(cl::EnqueueArgs(queue, cl::NDRange(n)), d_a, d_b, d_c, d_d, n); });
+
+            // Bytes read and written per run, one or two adds per element
+            const double bytes = (s == 0 ? 3.0 : 4.0) * sizeof(float) * n;
+            report.add(suites[s], "vadd", size_label(n), bytes, "GB/s", t,
+                (s == 0 ? 1.0 : 2.0) * n, bytes);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the global memory traffic of a matmul kernel variant
+//  at order n, counting every load and store the kernel issues:
+//
+//    elem, row       2n loads for each element of C
+//    row_priv        the row of A once, B once per row of C
+//    row_priv_bloc   B once per work-group of ROW_LOCAL rows
+//    block           A and B once per block of BLKSZ columns or rows
+//    block_reg       A once per TSN columns of C, B once per TSM rows
+//
+//  plus A (where read once) and the store of C.  The private row kernels
+//  take K in passes of PRIV_K, and every pass after the first reads C
+//  back and stores it again.
+//
+//------------------------------------------------------------------------------
+static double mult_bytes(const std::string& variant, int n, const TuneParams& params)
+{
+    const double n2 = (double)n * n, n3 = n2 * n;
+    double loads, stores = n2;
+
+    if (variant == "row_priv" || variant == "row_priv_bloc")
+    {
+        const int passes = (n + PRIV_K - 1) / PRIV_K;
+        loads  = n2 + (variant == "row_priv" ? n3 : n3 / ROW_LOCAL) + (passes - 1) * n2;
+        stores = passes * n2;
+    }
+    else if (variant == "block")
+        loads = 2.0 * n3 / params.blksz;
+    else if (variant == "block_reg")
+        loads = n3 / params.tsn + n3 / params.tsm;
+    else
+        loads = 2.0 * n3;
+
+    return sizeof(float) * (loads + stores);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Matrix multiplication: every kernel of Exercise08, which carries the
+//  naive (Exercise06) and row (Exercise07) kernels forward
+//
+//------------------------------------------------------------------------------
+static void bench_mult(cl::Context& context, cl::Device& device, cl::CommandQueue& queue,
+    Options& opt, bench::Report& report)
+{
+    if (!wanted(opt, "mult"))
+        return;
+
+    typedef cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer> Plain;
+    typedef cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer,
+        cl::LocalSpaceArg> OneLocal;
+    typedef cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer,
+        cl::LocalSpaceArg, cl::LocalSpaceArg> TwoLocal;
+
+    char priv_options[32];
+    sprintf(priv_options, "-DPRIV_K=%d", PRIV_K);
+
+    const Sizes& sizes = sizes_of(opt, "mult");
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        const int n = (int)sizes[i];
+        const double flops = 2.0 * n * n * n;
+        const std::string label = size_label(n) + "x" + size_label(n) + "x" + size_label(n);
+
+        TuneParams params = default_tune_params();
+        load_tuning(MULT_TUNE_DB, device, n, n, n, params);
+
+        util::aligned_vector<float> h_A((size_t)n*n), h_B((size_t)n*n), h_C((size_t)n*n);
+        initmat_random(n, n, n, h_A, h_B, h_C);
+        cl::Buffer d_a(context, h_A.begin(), h_A.end(), true);
+        cl::Buffer d_b(context, h_B.begin(), h_B.end(), true);
+        cl::Buffer d_c(context, CL_MEM_WRITE_ONLY, sizeof(float) * h_C.size());
+
+        cl::Program program;
+        std::vector<double> t;
+        double residual;
+
+        // Check the last timed run's product against the random A and B
+        // (freivalds() in matrix_lib), so a broken kernel is not mistaken
+        // for a fast one
+        #define MULT_RECORD(variant) \
+            cl::copy(queue, d_c, h_C.begin(), h_C.end()); \
+            residual = freivalds(n, n, n, h_A, h_B, h_C, FREIVALDS_ROUNDS); \
+            if (std::isnan(residual) || residual > FREIVALDS_TOL(n)) \
+                printf(" mult/%s: errors in the product at order %d\n", variant, n); \
+            report.add("mult", variant, label, flops, "GFLOPS", t, \
+                flops, mult_bytes(variant, n, params));
+
+        program = util::buildProgram(context, util::kernelSource("C_elem.cl"));
+        Plain elem(program, "mmul");
+        t = time_runs(opt, queue, [&]() {
+            return elem(cl::EnqueueArgs(queue, cl::NDRange(n, n)), n, n, n, d_a, d_b, d_c); });
+        MULT_RECORD("elem");
+
+        program = util::buildProgram(context, util::kernelSource("C_row.cl"));
+        Plain row(program, "mmul");
+        t = time_runs(opt, queue, [&]() {
+            return row(cl::EnqueueArgs(queue, cl::NDRange(n)), n, n, n, d_a, d_b, d_c); });
+        MULT_RECORD("row");
+
+        program = util::buildProgram(context, util::kernelSource("C_row_priv.cl"),
+            priv_options);
+        Plain row_priv(program, "mmul");
+        t = time_runs(opt, queue, [&]() {
+            return row_priv(cl::EnqueueArgs(queue, cl::NDRange(ROUND_UP(n, ROW_LOCAL)), cl::NDRange(ROW_LOCAL)),
+                n, n, n, d_a, d_b, d_c); });
+        MULT_RECORD("row_priv");
+
+        program = util::buildProgram(context, util::kernelSource("C_row_priv_bloc.cl"),
+            priv_options);
+        OneLocal row_priv_bloc(program, "mmul");
+        t = time_runs(opt, queue, [&]() {
+            return row_priv_bloc(cl::EnqueueArgs(queue, cl::NDRange(ROUND_UP(n, ROW_LOCAL)), cl::NDRange(ROW_LOCAL)),
+                n, n, n, d_a, d_b, d_c, cl::Local(sizeof(float) * std::min(n, PRIV_K))); });
+        MULT_RECORD("row_priv_bloc");
+
+        program = util::buildProgram(context, util::kernelSource("C_block_form.cl"),
+            block_options(params, n, n, n));
+        TwoLocal block(program, "mmul");
+        const int bs = params.blksz;
+        t = time_runs(opt, queue, [&]() {
+            return block(cl::EnqueueArgs(queue, cl::NDRange(ROUND_UP(n, bs), ROUND_UP(n, bs)), cl::NDRange(bs, bs)),
+                n, n, n, d_a, d_b, d_c,
+                cl::Local(sizeof(float) * bs*bs), cl::Local(sizeof(float) * bs*bs)); });
+        MULT_RECORD("block");
+
+        program = util::buildProgram(context, util::kernelSource("C_block_reg.cl"),
+            reg_options(params, n, n, n));
+        TwoLocal block_reg(program, "mmul");
+        t = time_runs(opt, queue, [&]() {
+            return block_reg(cl::EnqueueArgs(queue,
+                    cl::NDRange(ROUND_UP(n, params.tsn)/params.wptn, ROUND_UP(n, params.tsm)/params.wptm),
+                    cl::NDRange(params.tsn/params.wptn, params.tsm/params.wptm)),
+                n, n, n, d_a, d_b, d_c,
+                cl::Local(sizeof(float) * params.tsk*params.tsm),
+                cl::Local(sizeof(float) * params.tsk*params.tsn)); });
+        MULT_RECORD("block_reg");
+
+        #undef MULT_RECORD
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to check that every element of a vector y of A * x for A and x
+//  of ones is the length of the dot products, n
+//
+//------------------------------------------------------------------------------
+static bool gemv_ok(cl::CommandQueue& queue, cl::Buffer& d_y, size_t count, int n)
+{
+    std::vector<float> h_y(count);
+    cl::copy(queue, d_y, h_y.begin(), h_y.end());
+    for (size_t i = 0; i < count; i++)
+        if (fabs(h_y[i] - n) > TOL * n)
+            return false;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Matrix-vector products: sgemv of Exercise08 on an A of order n stored by
+//  rows (gemv_rows) and by columns (gemv_cols), and sgemv_batched on the
+//  same bytes of A as products of order GEMV_BATCH_N.  They are bound by
+//  memory bandwidth, so they are reported in GB/s.
+//
+//------------------------------------------------------------------------------
+static void bench_gemv(cl::Context& context, cl::CommandQueue& queue, Options& opt,
+    bench::Report& report)
+{
+    if (!wanted(opt, "gemv"))
+        return;
+
+    const Sizes& sizes = sizes_of(opt, "gemv");
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        const int n = (int)sizes[i];
+
+        // A and x of ones, so every element of y is n
+        std::vector<float> h_A((size_t)n * n, 1.0f), h_x(n, 1.0f);
+        cl::Buffer d_a(context, h_A.begin(), h_A.end(), true);
+        cl::Buffer d_x(context, h_x.begin(), h_x.end(), true);
+        cl::Buffer d_y(context, CL_MEM_READ_WRITE, sizeof(float) * n);
+
+        // A and x read, y written (beta is zero)
+        double bytes = sizeof(float) * ((double)n * n + 2.0 * n);
+        for (int t = 0; t < 2; t++)
+        {
+            const GemmTranspose trans = t ? GemmTrans : GemmNoTrans;
+            const char *variant = t ? "gemv_cols" : "gemv_rows";
+            std::vector<double> times = time_runs(opt, queue, [&]() {
+                return sgemv(queue, GemmRowMajor, trans, n, n, 1.0f, d_a, 0, n,
+                    d_x, 0, 0.0f, d_y, 0); });
+            if (!gemv_ok(queue, d_y, n, n))
+                printf(" gemv/%s: errors in the product at order %d\n", variant, n);
+            report.add("gemv", variant, size_label(n) + "x" + size_label(n), bytes, "GB/s",
+                times, 2.0 * n * n, bytes);
+        }
+
+        // The same A as a batch of small matrices
+        const int nb    = std::min(n, GEMV_BATCH_N);
+        const int batch = (int)(((size_t)n * n) / ((size_t)nb * nb));
+        std::vector<float> h_xb((size_t)batch * nb, 1.0f);
+        cl::Buffer d_xb(context, h_xb.begin(), h_xb.end(), true);
+        cl::Buffer d_yb(context, CL_MEM_READ_WRITE, sizeof(float) * h_xb.size());
+
+        bytes = sizeof(float) * ((double)nb * nb + 2.0 * nb) * batch;
+        std::vector<double> times = time_runs(opt, queue, [&]() {
+            return sgemv_batched(queue, GemmRowMajor, GemmNoTrans, nb, nb, 1.0f,
+                d_a, 0, nb, nb * nb, d_xb, 0, nb, 0.0f, d_yb, 0, nb, batch); });
+        if (!gemv_ok(queue, d_yb, h_xb.size(), nb))
+            printf(" gemv/gemv_batched: errors in the products at order %d\n", nb);
+        report.add("gemv", "gemv_batched",
+            size_label(batch) + "x" + size_label(nb) + "x" + size_label(nb), bytes, "GB/s",
+            times, 2.0 * nb * nb * batch, bytes);
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Pi by numerical integration: Exercise09 and the vectorised ExerciseA
+//
+//------------------------------------------------------------------------------
+static void bench_pi_kernel(cl::Context& context, cl::Device& device, cl::CommandQueue& queue,
+    Options& opt, bench::Report& report, const std::string& suite,
+    cl::Program& program, const char *name)
+{
+    cl::Kernel kernel(program, name);
+    const size_t wg = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+
+    const Sizes& sizes = sizes_of(opt, suite);
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        // Whole work-groups of PI_ITERS steps per work-item, as the drivers do
+        const size_t groups = std::max((size_t)1, sizes[i] / (wg * PI_ITERS));
+        const size_t nsteps = groups * wg * PI_ITERS;
+        const float step_size = 1.0f / (float)nsteps;
+
+        cl::Buffer d_partial_sums(context, CL_MEM_WRITE_ONLY, sizeof(float) * groups);
+        kernel.setArg(0, PI_ITERS);
+        kernel.setArg(1, step_size);
+        kernel.setArg(2, cl::Local(sizeof(float) * wg));
+        kernel.setArg(3, d_partial_sums);
+
+        std::vector<double> t = time_runs(opt, queue, [&]() {
+            cl::Event event;
+            queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                cl::NDRange(groups * wg), cl::NDRange(wg), NULL, &event);
+            return event; });
+
+        // The only global traffic is one partial sum per work-group
+        report.add(suite, name, size_label(nsteps), (double)nsteps, "Gsteps/s", t,
+            (double)PI_FLOPS * nsteps, sizeof(float) * (double)groups);
+    }
+}
+
+static void bench_pi(cl::Context& context, cl::Device& device, cl::CommandQueue& queue,
+    Options& opt, bench::Report& report)
+{
+    if (wanted(opt, "pi_ocl"))
+    {
+        cl::Program program = util::buildProgram(context, util::kernelSource("pi_ocl.cl"));
+        bench_pi_kernel(context, device, queue, opt, report, "pi_ocl", program, "pi");
+    }
+    if (wanted(opt, "pi_vocl"))
+    {
+        cl::Program program = util::buildProgram(context, util::kernelSource("pi_vocl.cl"));
+        bench_pi_kernel(context, device, queue, opt, report, "pi_vocl", program, "pi");
+        bench_pi_kernel(context, device, queue, opt, report, "pi_vocl", program, "pi_vec4");
+        bench_pi_kernel(context, device, queue, opt, report, "pi_vocl", program, "pi_vec8");
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Game of life: one generation of Exercise13 on a random board
+//
+//------------------------------------------------------------------------------
+static void bench_life(cl::Context& context, cl::CommandQueue& queue, Options& opt,
+    bench::Report& report)
+{
+    if (!wanted(opt, "life"))
+        return;
+
+    cl::Program program = util::buildProgram(context, util::kernelSource("gameoflife.cl"));
+    cl::make_kernel<cl::Buffer, cl::Buffer, unsigned int, unsigned int, cl::LocalSpaceArg>
+        accelerate_life(program, "accelerate_life");
+
+    const Sizes& sizes = sizes_of(opt, "life");
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        // The kernel needs whole work-groups across the board
+        const unsigned int n = ROUND_UP((unsigned int)sizes[i], LIFE_BLOCK);
+
+        std::vector<char> h_board((size_t)n * n);
+        for (size_t c = 0; c < h_board.size(); c++)
+            h_board[c] = (rand() % 4 == 0);
+
+        cl::Buffer d_tick(context, h_board.begin(), h_board.end(), false);
+        cl::Buffer d_tock(context, CL_MEM_READ_WRITE, h_board.size());
+
+        std::vector<double> t = time_runs(opt, queue, [&]() {
+            cl::Event event = accelerate_life(
+                cl::EnqueueArgs(queue, cl::NDRange(n, n), cl::NDRange(LIFE_BLOCK, LIFE_BLOCK)),
+                d_tick, d_tock, n, n, cl::Local((LIFE_BLOCK + 2) * (LIFE_BLOCK + 2)));
+            std::swap(d_tick, d_tock);
+            return event; });
+
+        report.add("life", "accelerate_life", size_label(n) + "x" + size_label(n),
+            (double)n * n, "Gcells/s", t);
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to parse a comma separated list of sizes
+//
+//------------------------------------------------------------------------------
+static bool parse_sizes(const char *list, Sizes& sizes)
+{
+    sizes.clear();
+    while (*list)
+    {
+        char *next;
+        unsigned long n = strtoul(list, &next, 10);
+        if (next == list || n == 0)
+            return false;
+        sizes.push_back(n);
+        list = (*next == ',') ? next + 1 : next;
+        if (*next != ',' && *next)
+            return false;
+    }
+    return !sizes.empty();
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    opt.reps = BENCH_REPS;
+    opt.warmup = BENCH_WARMUP;
+    std::string csv, json;
+    bool roofline = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--reps") && i + 1 < argc)
+            opt.reps = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+            opt.warmup = std::max(0, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--only") && i + 1 < argc)
+            opt.only = argv[++i];
+        else if (!strcmp(argv[i], "--csv") && i + 1 < argc)
+            csv = argv[++i];
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+            json = argv[++i];
+        else if (!strcmp(argv[i], "--no-roofline"))
+            roofline = false;
+        else if (!strcmp(argv[i], "--sizes") && i + 1 < argc)
+        {
+            // SUITE=n1,n2,...
+            std::string arg = argv[++i];
+            size_t eq = arg.find('=');
+            Sizes sizes;
+            if (eq == std::string::npos || !parse_sizes(arg.c_str() + eq + 1, sizes))
+            {
+                std::cout << "Invalid sizes (try '--sizes mult=256,512')\n";
+                return EXIT_FAILURE;
+            }
+            opt.sizes[arg.substr(0, eq)] = sizes;
+        }
+    }
+
+    try
+    {
+        cl_uint deviceIndex = 0;
+        parseArguments(argc, argv, &deviceIndex);
+
+        // Get list of devices
+        std::vector<cl::Device> devices;
+        unsigned numDevices = getDeviceList(devices);
+
+        // Check device index in range
+        if (deviceIndex >= numDevices)
+        {
+          std::cout << "Invalid device index (try '--list')\n";
+          return EXIT_FAILURE;
+        }
+
+        cl::Device device = devices[deviceIndex];
+
+        std::string name;
+        getDeviceName(device, name);
+        std::cout << "\nUsing OpenCL device: " << name << "\n";
+
+        std::vector<cl::Device> chosen_device;
+        chosen_device.push_back(device);
+        cl::Context context(chosen_device);
+        cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
+
+        // Record what the numbers were measured on
+        bench::Report report;
+        cl::Platform platform(device.getInfo<CL_DEVICE_PLATFORM>());
+        report.meta("platform", platform.getInfo<CL_PLATFORM_NAME>());
+        report.meta("device", name);
+        report.meta("vendor", device.getInfo<CL_DEVICE_VENDOR>());
+        report.meta("device_version", device.getInfo<CL_DEVICE_VERSION>());
+        report.meta("driver_version", device.getInfo<CL_DRIVER_VERSION>());
+        report.meta("compute_units", size_label(device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()));
+        report.meta("clock_mhz", size_label(device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>()));
+        report.meta("global_mem_mb", size_label(device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() / (1024*1024)));
+        report.meta("warmup", size_label(opt.warmup));
+        report.meta("reps", size_label(opt.reps));
+
+        printf("\n%d timed runs of each after %d warm up runs, kernel times from events\n\n",
+            opt.reps, opt.warmup);
+        if (roofline)
+            report.set_roofline(measure_peaks(context, device, queue, opt));
+        bench::Report::print_header();
+
+        bench_vadd(context, queue, opt, report);
+        bench_mult(context, device, queue, opt, report);
+        bench_gemv(context, queue, opt, report);
+        bench_pi(context, device, queue, opt, report);
+        bench_life(context, queue, opt, report);
+
+        if (!csv.empty() && !report.write_csv(csv))
+            std::cout << "Cannot write " << csv << "\n";
+        if (!json.empty() && !report.write_json(json))
+            std::cout << "Cannot write " << json << "\n";
+
+    } catch (cl::Error err)
+    {
+        std::cout << "Exception\n";
+        std::cerr << "ERROR: "
+                  << err.what()
+                  << "("
+                  << err_code(err.err())
+                  << ")"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
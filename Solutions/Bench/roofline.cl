@@ -0,0 +1,40 @@
+//------------------------------------------------------------------------------
+//
+// kernel:  peak_fma
+//
+// Purpose: Measure the peak multiply-add rate of the device.  Each work-item
+//          runs FMA_CHAINS independent float4 chains of x = x * a + b, so
+//          the pipelines stay full without waiting on one result.  With a
+//          and b passed at run time and the result stored, the compiler
+//          can not fold the loop away.  a < 1 keeps x bounded.
+//
+// flops:   global size * iters * FMA_CHAINS * 4 lanes * 2
+//
+
+#define FMA_CHAINS 8
+
+__kernel void peak_fma(
+   const int iters,
+   const float a,
+   const float b,
+   __global float* out)
+{
+   const float s = (float)get_global_id(0) * 1.0e-6f;
+   float4 x0 = (float4)(s, s + 1.0f, s + 2.0f, s + 3.0f);
+   float4 x1 = x0 + 0.1f, x2 = x0 + 0.2f, x3 = x0 + 0.3f;
+   float4 x4 = x0 + 0.4f, x5 = x0 + 0.5f, x6 = x0 + 0.6f, x7 = x0 + 0.7f;
+
+   for (int i = 0; i < iters; i++) {
+      x0 = mad(x0, a, b);
+      x1 = mad(x1, a, b);
+      x2 = mad(x2, a, b);
+      x3 = mad(x3, a, b);
+      x4 = mad(x4, a, b);
+      x5 = mad(x5, a, b);
+      x6 = mad(x6, a, b);
+      x7 = mad(x7, a, b);
+   }
+
+   float4 sum = ((x0 + x1) + (x2 + x3)) + ((x4 + x5) + (x6 + x7));
+   out[get_global_id(0)] = sum.x + sum.y + sum.z + sum.w;
+}
@@ -0,0 +1,88 @@
+/*------------------------------------------------------------------------------
+ *
+ * Name:       kernel_registry.h
+ *
+ * Purpose:    Look up kernel sources that were embedded in the program at
+ *             build time, so a driver needs no .cl files at run time and
+ *             can be started from any directory.  The C version of
+ *             Cpp_common/kernel_registry.hpp.
+ *
+ *             The table is generated by Tools/embed_opencl, which the
+ *             Makefiles run over the kernels of each driver, e.g.
+ *
+ *                 kernels.c: ../C_elem.cl ../C_row.cl
+ *                     ../../../Tools/embed_opencl $@ $^
+ *
+ *             and is looked up by file name:
+ *
+ *                 char *source = kernelSource("C_elem.cl");
+ *                 ...
+ *                 free(source);
+ *
+ *             To try out an edited kernel without rebuilding, set
+ *             CL_KERNEL_DIR to the directory holding it; files found there
+ *             are used in place of the embedded copies.
+ *
+ * HISTORY:    Written to replace loading kernels from relative paths
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct EmbeddedKernel
+{
+    const char *name;       // file name of the kernel, e.g. "C_elem.cl"
+    const char *source;     // its contents
+};
+
+// The embedded kernels, ending with { 0, 0 } (generated kernels.c)
+extern const struct EmbeddedKernel embedded_kernels[];
+
+// Returns a copy of the source of a kernel, to be freed by the caller.
+// Exits if there is no kernel of that name, as a missing file did.
+static inline char *kernelSource(const char *name)
+{
+    const char *dir = getenv("CL_KERNEL_DIR");
+    if (dir)
+    {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        FILE *file = fopen(path, "r");
+        if (file)
+        {
+            fseek(file, 0, SEEK_END);
+            long len = ftell(file);
+            rewind(file);
+            char *source = (char *)calloc(len + 1, sizeof(char));
+            if (!source)
+            {
+                fprintf(stderr, "Error: Could not allocate memory for source string\n");
+                exit(EXIT_FAILURE);
+            }
+            fread(source, sizeof(char), len, file);
+            fclose(file);
+            return source;
+        }
+    }
+
+    for (const struct EmbeddedKernel *k = embedded_kernels; k->name; k++)
+    {
+        if (strcmp(name, k->name) == 0)
+        {
+            char *source = (char *)malloc(strlen(k->source) + 1);
+            if (!source)
+            {
+                fprintf(stderr, "Error: Could not allocate memory for source string\n");
+                exit(EXIT_FAILURE);
+            }
+            strcpy(source, k->source);
+            return source;
+        }
+    }
+
+    fprintf(stderr, "No embedded kernel: %s\n", name);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,98 @@
+/*------------------------------------------------------------------------------
+ *
+ * Name:       aligned_allocator.hpp
+ *
+ * Purpose:    An allocator for std::vector that aligns the storage, so host
+ *             arrays can be handed to CL_MEM_USE_HOST_PTR buffers without
+ *             the runtime making an aligned copy.  Zero copy typically
+ *             needs page alignment (Intel asks for 4096 bytes) and a
+ *             64 byte (cache line) multiple size; the default gives both.
+ *
+ *                 util::aligned_vector<float> h_a(LENGTH);
+ *
+ *             works anywhere std::vector<float> does (cl::Buffer and
+ *             cl::copy take any iterators), only the type differs.
+ *
+ * HISTORY:    Written for the zero copy buffer modes (host_buffer.hpp)
+ */
+
+#ifndef __ALIGNED_ALLOCATOR_HDR
+#define __ALIGNED_ALLOCATOR_HDR
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace util {
+
+//! Alignment of host arrays: a page, which is also a cache line multiple
+const size_t HOST_ALIGN = 4096;
+
+/*!
+ * \brief std::allocator replacement returning Align aligned storage, with
+ * the size rounded up to a multiple of 64 bytes
+ */
+template <typename T, size_t Align = HOST_ALIGN>
+class AlignedAllocator
+{
+public:
+    typedef T         value_type;
+    typedef T*        pointer;
+    typedef const T*  const_pointer;
+    typedef T&        reference;
+    typedef const T&  const_reference;
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind { typedef AlignedAllocator<U, Align> other; };
+
+    AlignedAllocator() {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(size_t n)
+    {
+        size_t bytes = (n * sizeof(T) + 63) / 64 * 64;
+        if (bytes == 0)
+            bytes = 64;
+        void *p = NULL;
+#if defined(_WIN32)
+        p = _aligned_malloc(bytes, Align);
+#else
+        if (posix_memalign(&p, Align, bytes) != 0)
+            p = NULL;
+#endif
+        if (!p)
+            throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T *p, size_t)
+    {
+#if defined(_WIN32)
+        _aligned_free(p);
+#else
+        free(p);
+#endif
+    }
+};
+
+template <typename T, typename U, size_t Align>
+bool operator==(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&) { return true; }
+
+template <typename T, typename U, size_t Align>
+bool operator!=(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&) { return false; }
+
+//! A std::vector with page aligned storage
+template <typename T>
+using aligned_vector = std::vector<T, AlignedAllocator<T> >;
+
+} // namespace util
+
+#endif // __ALIGNED_ALLOCATOR_HDR
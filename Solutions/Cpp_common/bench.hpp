@@ -0,0 +1,366 @@
+/*------------------------------------------------------------------------------
+ *
+ * Name:       bench.hpp
+ *
+ * Purpose:    Statistics and machine readable output for benchmark runs.
+ *             Each measurement is a list of timed samples (warm up runs
+ *             already discarded) which is summarised as min, median, mean
+ *             and standard deviation.  A Report collects the summaries
+ *             together with key/value metadata about the host and device
+ *             and writes them as a table, CSV or JSON.
+ *
+ *             Given the flops and bytes of global memory traffic of a run
+ *             and the measured peaks of the device (see Roofline), each
+ *             result is placed on the roofline: its arithmetic intensity,
+ *             the roof at that intensity, min(peak flops, intensity *
+ *             peak bandwidth), the percentage of the roof reached, and
+ *             whether the kernel is bound by memory or by compute.
+ *
+ * Note:       See Bench/Cpp/benchmark.cpp for usage
+ *
+ * HISTORY:    Written for the unified benchmark harness
+ */
+
+#ifndef __BENCH_HDR
+#define __BENCH_HDR
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+//------------------------------------------------------------------------------
+//
+//  Summary of a list of samples (in seconds)
+//
+//------------------------------------------------------------------------------
+struct Stats
+{
+    size_t n;
+    double min, median, mean, stddev;
+};
+
+inline Stats summarize(std::vector<double> samples)
+{
+    Stats s = {samples.size(), 0.0, 0.0, 0.0, 0.0};
+    if (samples.empty())
+        return s;
+
+    std::sort(samples.begin(), samples.end());
+    s.min = samples[0];
+    s.median = (s.n % 2) ? samples[s.n/2]
+                         : 0.5 * (samples[s.n/2 - 1] + samples[s.n/2]);
+
+    for (size_t i = 0; i < s.n; i++)
+        s.mean += samples[i];
+    s.mean /= s.n;
+
+    // Sample standard deviation
+    if (s.n > 1)
+    {
+        for (size_t i = 0; i < s.n; i++)
+            s.stddev += (samples[i] - s.mean) * (samples[i] - s.mean);
+        s.stddev = std::sqrt(s.stddev / (s.n - 1));
+    }
+    return s;
+}
+
+//------------------------------------------------------------------------------
+//
+//  One benchmark result: a kernel variant at one problem size.  work is the
+//  amount done by one run in the units of the rate (e.g. bytes for GB/s,
+//  flops for GFLOPS), so the rate is work / median / 1e9.
+//
+//------------------------------------------------------------------------------
+struct Record
+{
+    std::string suite;      // the driver the kernel comes from
+    std::string variant;    // the kernel variant
+    std::string size;       // problem size, e.g. "1024x1024x1024"
+    double      work;       // work per run
+    std::string unit;       // unit of the rate, e.g. "GFLOPS"
+    double      flops;      // floating point operations per run (0 if none)
+    double      bytes;      // global memory traffic per run in bytes
+    Stats       stats;      // kernel times in seconds
+};
+
+//------------------------------------------------------------------------------
+//
+//  The measured peaks of the device: the ceilings of the roofline.  A
+//  kernel of arithmetic intensity I (flops per byte) can reach at most
+//  min(gflops, I * gbs) GFLOPS; below the ridge point gflops / gbs it is
+//  bound by memory bandwidth, above it by compute.
+//
+//------------------------------------------------------------------------------
+struct Roofline
+{
+    double gflops;          // peak GFLOPS (0 if not measured)
+    double gbs;             // peak global memory bandwidth in GB/s
+
+    bool known() const { return gflops > 0.0 && gbs > 0.0; }
+
+    double intensity(const Record& r) const
+    {
+        return r.bytes > 0.0 ? r.flops / r.bytes : 0.0;
+    }
+
+    //! Attainable GFLOPS at the record's intensity
+    double roof(const Record& r) const
+    {
+        if (r.bytes <= 0.0)
+            return gflops;
+        return std::min(gflops, intensity(r) * gbs);
+    }
+
+    //! Achieved GFLOPS as a percentage of the roof
+    double percent(const Record& r) const
+    {
+        if (!known() || r.flops <= 0.0 || r.stats.median <= 0.0)
+            return 0.0;
+        return 100.0 * r.flops / r.stats.median / 1.0e9 / roof(r);
+    }
+
+    const char *bound(const Record& r) const
+    {
+        if (!known() || r.flops <= 0.0)
+            return "-";
+        return r.bytes > 0.0 && intensity(r) < gflops / gbs ? "memory" : "compute";
+    }
+};
+
+//------------------------------------------------------------------------------
+//
+//  Helpers for the output formats
+//
+//------------------------------------------------------------------------------
+inline std::string json_string(const std::string& s)
+{
+    std::string out = "\"";
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        const unsigned char c = s[i];
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (c < 0x20)
+        {
+            char esc[8];
+            sprintf(esc, "\\u%04x", c);
+            out += esc;
+        }
+        else
+            out += c;
+    }
+    return out + "\"";
+}
+
+inline std::string csv_field(const std::string& s)
+{
+    if (s.find_first_of(",\"\n") == std::string::npos)
+        return s;
+    std::string out = "\"";
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        if (s[i] == '"')
+            out += '"';
+        out += s[i];
+    }
+    return out + "\"";
+}
+
+inline std::string number(double x)
+{
+    char buf[32];
+    sprintf(buf, "%.9g", x);
+    return buf;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Metadata about the host the benchmark ran on
+//
+//------------------------------------------------------------------------------
+inline std::string host_name()
+{
+#if !defined(_WIN32)
+    char name[256] = "";
+    if (gethostname(name, sizeof(name) - 1) == 0)
+        return name;
+#endif
+    const char *env = getenv("COMPUTERNAME");
+    return env ? env : "unknown";
+}
+
+inline std::string utc_time()
+{
+    char buf[32];
+    time_t now = time(NULL);
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    return buf;
+}
+
+inline std::string compiler()
+{
+#if defined(__VERSION__)
+    return __VERSION__;
+#elif defined(_MSC_VER)
+    return "MSVC " + number(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+//------------------------------------------------------------------------------
+//
+//  A collection of results and metadata
+//
+//------------------------------------------------------------------------------
+class Report
+{
+public:
+    Report() : roofline_()
+    {
+        meta("host", host_name());
+        meta("compiler", compiler());
+        meta("date", utc_time());
+    }
+
+    void meta(const std::string& key, const std::string& value)
+    {
+        meta_.push_back(std::make_pair(key, value));
+    }
+
+    //! Sets the peaks the records are placed against, and records them
+    void set_roofline(const Roofline& roofline)
+    {
+        roofline_ = roofline;
+        meta("peak_gflops", number(roofline.gflops));
+        meta("peak_gbs", number(roofline.gbs));
+    }
+
+    //! Summarise the samples, print a row of the table and keep the record.
+    //! flops and bytes are per run, for the roofline (0 flops: not placed)
+    void add(const std::string& suite, const std::string& variant, const std::string& size,
+        double work, const std::string& unit, const std::vector<double>& samples,
+        double flops = 0.0, double bytes = 0.0)
+    {
+        Record r;
+        r.suite   = suite;
+        r.variant = variant;
+        r.size    = size;
+        r.work    = work;
+        r.unit    = unit;
+        r.flops   = flops;
+        r.bytes   = bytes;
+        r.stats   = summarize(samples);
+        records_.push_back(r);
+
+        printf(" %-10s %-18s %-16s %10.4f %10.4f %9.4f %10.3f %-8s",
+            suite.c_str(), variant.c_str(), size.c_str(),
+            r.stats.min * 1.0e3, r.stats.median * 1.0e3, r.stats.stddev * 1.0e3,
+            rate(r), unit.c_str());
+        if (roofline_.known() && flops > 0.0)
+            printf(" %8.3f %6.1f%% %s\n", roofline_.intensity(r), roofline_.percent(r),
+                roofline_.bound(r));
+        else
+            printf("\n");
+    }
+
+    static void print_header()
+    {
+        printf(" %-10s %-18s %-16s %10s %10s %9s %10s %-8s %8s %7s %s\n",
+            "suite", "variant", "size", "min ms", "median ms", "stddev", "rate", "",
+            "flop/B", "%roof", "bound");
+    }
+
+    static double rate(const Record& r)
+    {
+        return r.stats.median > 0.0 ? r.work / r.stats.median / 1.0e9 : 0.0;
+    }
+
+    bool write_csv(const std::string& path) const
+    {
+        std::ofstream out(path.c_str());
+        if (!out.is_open())
+            return false;
+
+        // Metadata as comment lines, then one row per record
+        for (size_t i = 0; i < meta_.size(); i++)
+            out << "# " << meta_[i].first << ": " << meta_[i].second << "\n";
+        out << "suite,variant,size,samples,min_s,median_s,mean_s,stddev_s,work,rate,unit,"
+               "flops,bytes,intensity,roof_gflops,pct_of_roof,bound\n";
+        for (size_t i = 0; i < records_.size(); i++)
+        {
+            const Record& r = records_[i];
+            out << csv_field(r.suite) << ',' << csv_field(r.variant) << ','
+                << csv_field(r.size) << ',' << r.stats.n << ','
+                << number(r.stats.min) << ',' << number(r.stats.median) << ','
+                << number(r.stats.mean) << ',' << number(r.stats.stddev) << ','
+                << number(r.work) << ',' << number(rate(r)) << ','
+                << csv_field(r.unit) << ',' << number(r.flops) << ','
+                << number(r.bytes) << ',' << number(roofline_.intensity(r)) << ','
+                << number(roofline_.known() ? roofline_.roof(r) : 0.0) << ','
+                << number(roofline_.percent(r)) << ',' << roofline_.bound(r) << "\n";
+        }
+        return out.good();
+    }
+
+    bool write_json(const std::string& path) const
+    {
+        std::ofstream out(path.c_str());
+        if (!out.is_open())
+            return false;
+
+        out << "{\n  \"metadata\": {";
+        for (size_t i = 0; i < meta_.size(); i++)
+            out << (i ? ",\n" : "\n") << "    " << json_string(meta_[i].first)
+                << ": " << json_string(meta_[i].second);
+        out << "\n  },\n  \"results\": [";
+        for (size_t i = 0; i < records_.size(); i++)
+        {
+            const Record& r = records_[i];
+            out << (i ? ",\n" : "\n")
+                << "    {\"suite\": " << json_string(r.suite)
+                << ", \"variant\": " << json_string(r.variant)
+                << ", \"size\": " << json_string(r.size)
+                << ", \"samples\": " << r.stats.n
+                << ", \"min_s\": " << number(r.stats.min)
+                << ", \"median_s\": " << number(r.stats.median)
+                << ", \"mean_s\": " << number(r.stats.mean)
+                << ", \"stddev_s\": " << number(r.stats.stddev)
+                << ", \"work\": " << number(r.work)
+                << ", \"rate\": " << number(rate(r))
+                << ", \"unit\": " << json_string(r.unit)
+                << ", \"flops\": " << number(r.flops)
+                << ", \"bytes\": " << number(r.bytes)
+                << ", \"intensity\": " << number(roofline_.intensity(r))
+                << ", \"roof_gflops\": " << number(roofline_.known() ? roofline_.roof(r) : 0.0)
+                << ", \"pct_of_roof\": " << number(roofline_.percent(r))
+                << ", \"bound\": " << json_string(roofline_.bound(r)) << "}";
+        }
+        out << "\n  ]\n}\n";
+        return out.good();
+    }
+
+private:
+    std::vector<std::pair<std::string, std::string> > meta_;
+    std::vector<Record> records_;
+    Roofline roofline_;
+};
+
+} // namespace bench
+
+#endif // __BENCH_HDR
@@ -0,0 +1,292 @@
+/*------------------------------------------------------------------------------
+ *
+ * Name:       host_buffer.hpp
+ *
+ * Purpose:    Arrays shared by the host and a device, in one of four
+ *             buffer modes:
+ *
+ *               copy        host array and device buffer are separate;
+ *                           data is copied with read/write commands.
+ *               use_host    CL_MEM_USE_HOST_PTR on a page aligned host
+ *                           array; the host gets it back by mapping.
+ *               alloc_host  CL_MEM_ALLOC_HOST_PTR, the runtime allocates
+ *                           host visible memory; the host maps it.
+ *               svm         coarse grained shared virtual memory
+ *                           (OpenCL 2.0); the host maps it with
+ *                           clEnqueueSVMMap.
+ *
+ *             On a device that shares DRAM with the host (CPU devices,
+ *             integrated GPUs) the last three avoid copies: mapping only
+ *             hands the same pages back and forth.  On a discrete GPU
+ *             the runtime still copies, so every mode should be timed.
+ *
+ *             A HostBuffer starts on the host.  Fill it through data(),
+ *             call toDevice() before the kernels and toHost() before
+ *             reading the results; the time spent in both is recorded.
+ *
+ *                 util::HostBuffer<float> a(context, queue, util::BUFFER_SVM,
+ *                     LENGTH, CL_MEM_READ_ONLY);
+ *                 ...
+ *                 a.toDevice();
+ *                 a.setArg(kernel, 0);
+ *
+ * Note:       Must be included AFTER cl.hpp, with __CL_ENABLE_EXCEPTIONS
+ *
+ * HISTORY:    Written for the zero copy buffer modes
+ */
+
+#ifndef __HOST_BUFFER_HDR
+#define __HOST_BUFFER_HDR
+
+#include <cstring>
+#include <string>
+
+#include "aligned_allocator.hpp"
+#include "util.hpp"
+
+namespace util {
+
+enum BufferMode
+{
+    BUFFER_COPY,
+    BUFFER_USE_HOST_PTR,
+    BUFFER_ALLOC_HOST_PTR,
+    BUFFER_SVM,
+    BUFFER_MODES                // number of modes
+};
+
+inline const char *bufferModeName(BufferMode mode)
+{
+    switch (mode)
+    {
+        case BUFFER_COPY:           return "copy";
+        case BUFFER_USE_HOST_PTR:   return "use_host";
+        case BUFFER_ALLOC_HOST_PTR: return "alloc_host";
+        case BUFFER_SVM:            return "svm";
+        default:                    return "unknown";
+    }
+}
+
+//! Sets mode from its name, returning false for an unknown name
+inline bool parseBufferMode(const std::string& name, BufferMode& mode)
+{
+    for (int m = 0; m < BUFFER_MODES; m++)
+    {
+        if (name == bufferModeName((BufferMode)m))
+        {
+            mode = (BufferMode)m;
+            return true;
+        }
+    }
+    return false;
+}
+
+//! true if the device supports coarse grained SVM buffers
+inline bool svmSupported(const cl::Device& device)
+{
+#if defined(CL_VERSION_2_0)
+    cl_bitfield caps = 0;      // cl_device_svm_capabilities
+    if (clGetDeviceInfo(device(), CL_DEVICE_SVM_CAPABILITIES, sizeof(caps), &caps, NULL) != CL_SUCCESS)
+        return false;
+    return (caps & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER) != 0;
+#else
+    (void)device;
+    return false;
+#endif
+}
+
+//! true if the device can run buffers of this mode
+inline bool bufferModeSupported(const cl::Device& device, BufferMode mode)
+{
+    return mode != BUFFER_SVM || svmSupported(device);
+}
+
+template <typename T>
+class HostBuffer
+{
+public:
+    //! access is the device's: CL_MEM_READ_ONLY, WRITE_ONLY or READ_WRITE
+    HostBuffer(const cl::Context& context, const cl::CommandQueue& queue,
+        BufferMode mode, size_t n, cl_mem_flags access = CL_MEM_READ_WRITE)
+        : context_(context), queue_(queue), mode_(mode), n_(n),
+          access_(access), host_(NULL), svm_(NULL), seconds_(0.0), bytes_(0)
+    {
+        const size_t size = sizeof(T) * n;
+        switch (mode)
+        {
+            case BUFFER_COPY:
+                storage_.resize(n);
+                buffer_ = cl::Buffer(context, access, size);
+                host_ = &storage_[0];
+                break;
+
+            case BUFFER_USE_HOST_PTR:
+                storage_.resize(n);
+                buffer_ = cl::Buffer(context, access | CL_MEM_USE_HOST_PTR, size, &storage_[0]);
+                map();
+                break;
+
+            case BUFFER_ALLOC_HOST_PTR:
+                buffer_ = cl::Buffer(context, access | CL_MEM_ALLOC_HOST_PTR, size);
+                map();
+                break;
+
+            case BUFFER_SVM:
+#if defined(CL_VERSION_2_0)
+                svm_ = clSVMAlloc(context(), access, size, 0);
+                if (!svm_)
+                    throw cl::Error(CL_MEM_OBJECT_ALLOCATION_FAILURE, "clSVMAlloc");
+                map();
+                break;
+#else
+                throw cl::Error(CL_INVALID_OPERATION, "clSVMAlloc");
+#endif
+
+            default:
+                throw cl::Error(CL_INVALID_VALUE, "HostBuffer");
+        }
+        seconds_ = 0.0;     // the first map is part of the allocation
+    }
+
+    ~HostBuffer()
+    {
+        try
+        {
+            if (mode_ != BUFFER_COPY && host_)
+                unmap();
+            queue_.finish();
+        }
+        catch (cl::Error)
+        {
+        }
+#if defined(CL_VERSION_2_0)
+        if (svm_)
+            clSVMFree(context_(), svm_);
+#endif
+    }
+
+    //! The host's view of the array, valid until toDevice()
+    T *data() { return host_; }
+    T& operator[](size_t i) { return host_[i]; }
+    size_t size() const { return n_; }
+    BufferMode mode() const { return mode_; }
+
+    //! Hands the array to the device: copies it unless the device only
+    //! writes it or its contents are not needed, or unmaps it
+    void toDevice(bool contents = true)
+    {
+        if (!host_)
+            return;
+        Timer timer;
+        if (mode_ == BUFFER_COPY)
+        {
+            if (contents && access_ != CL_MEM_WRITE_ONLY)
+            {
+                queue_.enqueueWriteBuffer(buffer_, CL_TRUE, 0, sizeof(T) * n_, host_);
+                bytes_ += sizeof(T) * n_;
+            }
+            host_ = NULL;
+        }
+        else
+        {
+            unmap();
+            queue_.finish();
+        }
+        seconds_ += timer.getTimeMicroseconds() * 1.0e-6;
+    }
+
+    //! Brings the array back to the host (waits for the device): copies it
+    //! unless the device only read it, or maps it
+    void toHost()
+    {
+        if (host_)
+            return;
+        Timer timer;
+        if (mode_ == BUFFER_COPY)
+        {
+            host_ = &storage_[0];
+            if (access_ != CL_MEM_READ_ONLY)
+            {
+                queue_.enqueueReadBuffer(buffer_, CL_TRUE, 0, sizeof(T) * n_, host_);
+                bytes_ += sizeof(T) * n_;
+            }
+            else
+                queue_.finish();
+        }
+        else
+            map();
+        seconds_ += timer.getTimeMicroseconds() * 1.0e-6;
+    }
+
+    //! Sets kernel argument index to this array (must be on the device)
+    void setArg(cl::Kernel& kernel, cl_uint index)
+    {
+#if defined(CL_VERSION_2_0)
+        if (svm_)
+        {
+            cl_int err = clSetKernelArgSVMPointer(kernel(), index, svm_);
+            if (err != CL_SUCCESS)
+                throw cl::Error(err, "clSetKernelArgSVMPointer");
+            return;
+        }
+#endif
+        kernel.setArg(index, buffer_);
+    }
+
+    //! Time spent in toDevice and toHost, and the bytes they copied
+    double transferSeconds() const { return seconds_; }
+    size_t transferBytes() const { return bytes_; }
+
+private:
+    HostBuffer(const HostBuffer&);
+    HostBuffer& operator=(const HostBuffer&);
+
+    void map()
+    {
+        const size_t size = sizeof(T) * n_;
+        const cl_map_flags flags = CL_MAP_READ | CL_MAP_WRITE;
+#if defined(CL_VERSION_2_0)
+        if (svm_)
+        {
+            cl_int err = clEnqueueSVMMap(queue_(), CL_TRUE, flags, svm_, size, 0, NULL, NULL);
+            if (err != CL_SUCCESS)
+                throw cl::Error(err, "clEnqueueSVMMap");
+            host_ = static_cast<T*>(svm_);
+            return;
+        }
+#endif
+        host_ = static_cast<T*>(queue_.enqueueMapBuffer(buffer_, CL_TRUE, flags, 0, size));
+    }
+
+    void unmap()
+    {
+#if defined(CL_VERSION_2_0)
+        if (svm_)
+        {
+            cl_int err = clEnqueueSVMUnmap(queue_(), svm_, 0, NULL, NULL);
+            if (err != CL_SUCCESS)
+                throw cl::Error(err, "clEnqueueSVMUnmap");
+            host_ = NULL;
+            return;
+        }
+#endif
+        queue_.enqueueUnmapMemObject(buffer_, host_);
+        host_ = NULL;
+    }
+
+    cl::Context      context_;
+    cl::CommandQueue queue_;
+    BufferMode       mode_;
+    size_t           n_;
+    cl_mem_flags     access_;
+    aligned_vector<T> storage_;     // host array of the copy and use_host modes
+    cl::Buffer       buffer_;
+    T               *host_;         // host view, NULL while on the device
+    void            *svm_;
+    double           seconds_;
+    size_t           bytes_;
+};
+
+} // namespace util
+
+#endif // __HOST_BUFFER_HDR
@@ -0,0 +1,78 @@
+/*------------------------------------------------------------------------------
+ *
+ * Name:       kernel_registry.hpp
+ *
+ * Purpose:    Look up kernel sources that were embedded in the program at
+ *             build time, so a driver needs no .cl files at run time and
+ *             can be started from any directory.
+ *
+ *             The table is generated by Tools/embed_opencl, which the
+ *             Makefiles run over the kernels of each driver, e.g.
+ *
+ *                 kernels.cpp: ../C_elem.cl ../C_row.cl
+ *                     ../../../Tools/embed_opencl $@ $^
+ *
+ *             and is looked up by file name:
+ *
+ *                 cl::Program program = util::buildProgram(context, util::kernelSource("C_elem.cl"));
+ *
+ *             To try out an edited kernel without rebuilding, set
+ *             CL_KERNEL_DIR to the directory holding it; files found there
+ *             are used in place of the embedded copies.
+ *
+ * HISTORY:    Written to replace loading kernels from relative paths
+ */
+
+#ifndef __KERNEL_REGISTRY_HDR
+#define __KERNEL_REGISTRY_HDR
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+namespace util {
+
+/*!
+ * \brief A kernel source embedded by Tools/embed_opencl
+ */
+struct EmbeddedKernel
+{
+    const char *name;       //!< file name of the kernel, e.g. "C_elem.cl"
+    const char *source;     //!< its contents
+};
+
+//! The embedded kernels, ending with { 0, 0 } (generated kernels.cpp)
+extern const EmbeddedKernel embedded_kernels[];
+
+/*!
+ * \brief Returns the source of an embedded kernel.  Exits if there is no
+ * kernel of that name, as util::loadProgram does for a missing file.
+ */
+inline std::string kernelSource(const std::string& name)
+{
+    const char *dir = getenv("CL_KERNEL_DIR");
+    if (dir)
+    {
+        std::ifstream stream((std::string(dir) + "/" + name).c_str());
+        if (stream.is_open())
+            return std::string(
+                std::istreambuf_iterator<char>(stream),
+                (std::istreambuf_iterator<char>()));
+    }
+
+    for (const EmbeddedKernel *k = embedded_kernels; k->name; k++)
+    {
+        if (name == k->name)
+            return k->source;
+    }
+
+    std::cout << "No embedded kernel: " << name << std::endl;
+    exit(1);
+}
+
+} // namespace util
+
+#endif // __KERNEL_REGISTRY_HDR
@@ -0,0 +1,352 @@
+/*------------------------------------------------------------------------------
+ *
+ * Name:       matrix_file.hpp
+ *
+ * Purpose:    A binary matrix file format, read and written through a
+ *             memory mapping so large matrices load with no parsing and
+ *             no copy into a host array.  A file is a 64 byte header:
+ *
+ *               offset  size  field
+ *                0       8    magic "CLMATRIX"
+ *                8       4    version (1)
+ *               12       4    element type: 0 float, 1 double
+ *               16       4    layout: 0 row major, 1 column major
+ *               20       4    reserved (0)
+ *               24       8    rows
+ *               32       8    columns
+ *               40       8    offset of the elements from the start
+ *               48      16    reserved (0)
+ *
+ *             in little endian byte order, then zeros up to the offset (a
+ *             multiple of the element size), then the elements with no
+ *             gaps.  Files written here put the elements at
+ *             MATRIX_FILE_ALIGN bytes, a page, so the mapped elements are
+ *             page aligned and can back a CL_MEM_USE_HOST_PTR buffer
+ *             directly.
+ *
+ *                 util::MatrixFile a;
+ *                 if (!a.open("A.mat"))
+ *                     std::cout << a.error() << "\n";
+ *                 float *p = a.as<float>();   // NULL unless float
+ *
+ *             A file opened for reading is mapped copy on write, so a
+ *             runtime writing to the host pointer never changes the file.
+ *             A created file is mapped shared; call sync() (or close())
+ *             to write it back.  Mapping reads nothing: the pages fault in
+ *             on first use unless prefault() brings them in first.
+ *
+ * HISTORY:    Written for loading real inputs into the matmul driver
+ */
+
+#ifndef __MATRIX_FILE_HDR
+#define __MATRIX_FILE_HDR
+
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "util.hpp"
+
+namespace util {
+
+//! Offset of the elements in files written by MatrixFile::create()
+const size_t MATRIX_FILE_ALIGN = 4096;
+
+enum MatrixType
+{
+    MATRIX_FLOAT  = 0,
+    MATRIX_DOUBLE = 1
+};
+
+enum MatrixLayout
+{
+    MATRIX_ROW_MAJOR = 0,
+    MATRIX_COL_MAJOR = 1
+};
+
+//! The header at the start of every file
+struct MatrixHeader
+{
+    char               magic[8];
+    unsigned int       version;
+    unsigned int       type;
+    unsigned int       layout;
+    unsigned int       reserved0;
+    unsigned long long rows;
+    unsigned long long cols;
+    unsigned long long offset;
+    unsigned long long reserved1[2];
+};
+
+class MatrixFile
+{
+public:
+    MatrixFile() : base_(NULL), size_(0), writable_(false), seconds_(0.0)
+    {
+        memset(&header_, 0, sizeof(header_));
+#if defined(_WIN32)
+        file_ = INVALID_HANDLE_VALUE;
+        mapping_ = NULL;
+#else
+        fd_ = -1;
+#endif
+    }
+
+    ~MatrixFile() { close(); }
+
+    //! Maps an existing file; false (see error()) if it is not a matrix file
+    bool open(const std::string& path)
+    {
+        close();
+        Timer timer;
+        if (!map(path, false, 0))
+            return false;
+
+        if (size_ < sizeof(MatrixHeader))
+            return fail(path + ": too short for a matrix header");
+        memcpy(&header_, base_, sizeof(header_));
+        if (memcmp(header_.magic, "CLMATRIX", 8) != 0 || header_.version != 1)
+            return fail(path + ": not a matrix file");
+        if (header_.type > MATRIX_DOUBLE || header_.layout > MATRIX_COL_MAJOR)
+            return fail(path + ": unknown element type or layout");
+        if (header_.rows == 0 || header_.cols == 0)
+            return fail(path + ": the matrix is empty");
+        // Misaligned elements could not be read through as<T>()
+        if (header_.offset % elementSize() != 0)
+            return fail(path + ": elements are not aligned to their size");
+        if (header_.offset < sizeof(MatrixHeader) || header_.offset > size_
+            || (header_.cols && header_.rows > (size_ - header_.offset) / elementSize() / header_.cols))
+            return fail(path + ": elements are truncated");
+
+        seconds_ = timer.getTimeMicroseconds() * 1.0e-6;
+        return true;
+    }
+
+    //! Creates (or replaces) a file for a rows x cols matrix and maps it
+    //! for writing; the elements start as zeros
+    bool create(const std::string& path, size_t rows, size_t cols,
+        MatrixType type = MATRIX_FLOAT, MatrixLayout layout = MATRIX_ROW_MAJOR)
+    {
+        close();
+        Timer timer;
+        memcpy(header_.magic, "CLMATRIX", 8);
+        header_.version = 1;
+        header_.type    = type;
+        header_.layout  = layout;
+        header_.rows    = rows;
+        header_.cols    = cols;
+        header_.offset  = MATRIX_FILE_ALIGN;
+
+        if (cols && rows > ((size_t)-1 - MATRIX_FILE_ALIGN) / elementSize() / cols)
+            return fail(path + ": matrix too large");
+        if (!map(path, true, MATRIX_FILE_ALIGN + rows * cols * elementSize()))
+            return false;
+        memcpy(base_, &header_, sizeof(header_));
+        seconds_ = timer.getTimeMicroseconds() * 1.0e-6;
+        return true;
+    }
+
+    //! Writes the elements of a created file back to it
+    bool sync()
+    {
+        if (!base_ || !writable_)
+            return true;
+        Timer timer;
+#if defined(_WIN32)
+        bool ok = FlushViewOfFile(base_, 0) && FlushFileBuffers(file_);
+#else
+        bool ok = msync(base_, size_, MS_SYNC) == 0;
+#endif
+        seconds_ += timer.getTimeMicroseconds() * 1.0e-6;
+        if (!ok)
+            error_ = "cannot write the matrix file";
+        return ok;
+    }
+
+    void close()
+    {
+        sync();
+#if defined(_WIN32)
+        if (base_)
+            UnmapViewOfFile(base_);
+        if (mapping_)
+            CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE)
+            CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+        mapping_ = NULL;
+#else
+        if (base_)
+            munmap(base_, size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+#endif
+        base_ = NULL;
+        size_ = 0;
+    }
+
+    size_t rows() const { return (size_t)header_.rows; }
+    size_t cols() const { return (size_t)header_.cols; }
+    MatrixType type() const { return (MatrixType)header_.type; }
+    MatrixLayout layout() const { return (MatrixLayout)header_.layout; }
+    size_t elementSize() const { return header_.type == MATRIX_DOUBLE ? sizeof(double) : sizeof(float); }
+
+    //! Bytes of elements
+    size_t bytes() const { return rows() * cols() * elementSize(); }
+
+    //! The mapped elements, or NULL if the file is not open
+    void *data() { return base_ ? base_ + header_.offset : NULL; }
+
+    //! The mapped elements as T, or NULL if they are not of type T
+    template <typename T>
+    T *as()
+    {
+        if (sizeof(T) != elementSize())
+            return NULL;
+        return static_cast<T*>(data());
+    }
+
+    //! true if the elements are page aligned (CL_MEM_USE_HOST_PTR need not copy)
+    bool aligned() const { return base_ && header_.offset % MATRIX_FILE_ALIGN == 0; }
+
+    //! Faults in every page of the elements now, so their first use (by
+    //! the host, or a CPU device through CL_MEM_USE_HOST_PTR) does not
+    //! stall on the file; a created file's pages are written, so a later
+    //! store does not fault either.  Returns the seconds it took
+    double prefault()
+    {
+        if (!base_)
+            return 0.0;
+        Timer timer;
+        volatile char *p = base_ + header_.offset;
+        size_t n = bytes();
+#if defined(_WIN32)
+        size_t page = MATRIX_FILE_ALIGN;
+#else
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        // madvise needs a page aligned start; the mapping itself is one
+        size_t start = (size_t)header_.offset / page * page;
+        madvise(base_ + start, size_ - start, MADV_WILLNEED);
+#endif
+        char sink = 0;
+        for (size_t at = 0; at < n; at += page)
+        {
+            if (writable_)
+                p[at] = p[at];
+            else
+                sink ^= p[at];
+        }
+        if (n)
+        {
+            if (writable_)
+                p[n - 1] = p[n - 1];
+            else
+                sink ^= p[n - 1];
+        }
+        (void)sink;
+        double seconds = timer.getTimeMicroseconds() * 1.0e-6;
+        seconds_ += seconds;
+        return seconds;
+    }
+
+    //! Time spent mapping, faulting in and syncing the file
+    double seconds() const { return seconds_; }
+
+    const std::string& error() const { return error_; }
+
+private:
+    MatrixFile(const MatrixFile&);
+    MatrixFile& operator=(const MatrixFile&);
+
+    bool fail(const std::string& message)
+    {
+        error_ = message;
+        close();
+        return false;
+    }
+
+    // Maps the whole file; size is the size to create it with if writable
+    bool map(const std::string& path, bool writable, size_t size)
+    {
+        writable_ = writable;
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+            FILE_SHARE_READ, NULL, writable ? CREATE_ALWAYS : OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_ == INVALID_HANDLE_VALUE)
+            return fail("cannot open " + path);
+        if (!writable)
+        {
+            LARGE_INTEGER length;
+            if (!GetFileSizeEx(file_, &length))
+                return fail("cannot read the size of " + path);
+            size = (size_t)length.QuadPart;
+        }
+        if (size == 0)
+            return fail(path + ": empty file");
+        mapping_ = CreateFileMappingA(file_, NULL, writable ? PAGE_READWRITE : PAGE_WRITECOPY,
+            (DWORD)((unsigned long long)size >> 32), (DWORD)size, NULL);
+        if (!mapping_)
+            return fail("cannot map " + path);
+        base_ = static_cast<char*>(MapViewOfFile(mapping_,
+            writable ? FILE_MAP_WRITE : FILE_MAP_COPY, 0, 0, size));
+        if (!base_)
+            return fail("cannot map " + path);
+#else
+        fd_ = ::open(path.c_str(), writable ? O_RDWR | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+        if (fd_ < 0)
+            return fail("cannot open " + path);
+        if (writable)
+        {
+            if (ftruncate(fd_, (off_t)size) != 0)
+                return fail("cannot size " + path);
+        }
+        else
+        {
+            struct stat st;
+            if (fstat(fd_, &st) != 0)
+                return fail("cannot read the size of " + path);
+            size = (size_t)st.st_size;
+        }
+        if (size == 0)
+            return fail(path + ": empty file");
+
+        // Read only files are mapped private and writable: the pages come
+        // from the page cache and a write only ever changes a private copy
+        void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            writable ? MAP_SHARED : MAP_PRIVATE, fd_, 0);
+        if (p == MAP_FAILED)
+            return fail("cannot map " + path);
+        base_ = static_cast<char*>(p);
+        madvise(p, size, MADV_SEQUENTIAL);
+#endif
+        size_ = size;
+        return true;
+    }
+
+    MatrixHeader header_;
+    char        *base_;         // start of the mapping (the header)
+    size_t       size_;         // bytes mapped
+    bool         writable_;
+    double       seconds_;
+    std::string  error_;
+#if defined(_WIN32)
+    HANDLE       file_;
+    HANDLE       mapping_;
+#else
+    int          fd_;
+#endif
+};
+
+} // namespace util
+
+#endif // __MATRIX_FILE_HDR
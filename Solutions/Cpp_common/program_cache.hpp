@@ -0,0 +1,261 @@
+/*------------------------------------------------------------------------------
+ *
+ * Name:       program_cache.hpp
+ *
+ * Purpose:    Build OpenCL programs through an on-disk cache of program
+ *             binaries.  The first build of a program (cold) compiles the
+ *             source and saves CL_PROGRAM_BINARIES; later builds (warm)
+ *             load the binaries with clCreateProgramWithBinary and only
+ *             link them, which skips the vendor compiler.
+ *
+ *             Entries are keyed by a hash of the source, the build options
+ *             and the platform, name, version and driver version of every
+ *             device in the context, so a driver update or an edited
+ *             kernel gets a new entry.  A binary that the runtime refuses
+ *             (stale, corrupt or truncated) is rebuilt from source and
+ *             replaced, so the cache can always be deleted safely.
+ *
+ *             The cache lives in the directory named by CL_CACHE_DIR
+ *             (default .clcache in the working directory).  Set
+ *             CL_CACHE_DIR=off to always build from source.
+ *
+ * Note:       Must be included AFTER cl.hpp
+ *
+ * HISTORY:    Written to cut the start up time of the drivers
+ */
+
+#ifndef __PROGRAM_CACHE_HDR
+#define __PROGRAM_CACHE_HDR
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "util.hpp"
+
+namespace util {
+
+/*!
+ * \brief How a program was built by buildProgram
+ */
+struct BuildInfo
+{
+    bool        cached;     //!< true if loaded from a cached binary
+    double      ms;         //!< time to create and build the program
+    std::string path;       //!< cache file ("" if the cache is off)
+};
+
+namespace detail {
+
+// 64 bit FNV-1a hash, continued from h
+inline unsigned long long fnv1a(const std::string& s,
+    unsigned long long h = 14695981039346656037ULL)
+{
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    // Separate the fields so "ab"+"c" and "a"+"bc" differ
+    h ^= 0xff;
+    return h * 1099511628211ULL;
+}
+
+inline std::string cacheDir()
+{
+    const char *env = getenv("CL_CACHE_DIR");
+    return env ? env : ".clcache";
+}
+
+inline std::string cachePath(const std::vector<cl::Device>& devices,
+    const std::string& source, const std::string& options)
+{
+    std::string dir = cacheDir();
+    if (dir.empty() || dir == "off")
+        return "";
+
+    unsigned long long h = fnv1a(source);
+    h = fnv1a(options, h);
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        cl::Platform platform(devices[i].getInfo<CL_DEVICE_PLATFORM>());
+        h = fnv1a(platform.getInfo<CL_PLATFORM_NAME>(), h);
+        h = fnv1a(devices[i].getInfo<CL_DEVICE_NAME>(), h);
+        h = fnv1a(devices[i].getInfo<CL_DEVICE_VERSION>(), h);
+        h = fnv1a(devices[i].getInfo<CL_DRIVER_VERSION>(), h);
+    }
+
+#if defined(_WIN32)
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+
+    char name[32];
+    sprintf(name, "/%016llx.bin", h);
+    return dir + name;
+}
+
+// File layout: "CLBIN1", the number of binaries, then the size and bytes of
+// each (one per device, in context order)
+inline bool readBinaries(const std::string& path, size_t count,
+    std::vector<std::string>& binaries)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    char magic[6];
+    unsigned long long n = 0;
+    if (!in.read(magic, 6) || std::string(magic, 6) != "CLBIN1"
+        || !in.read((char *)&n, sizeof(n)) || n != count)
+        return false;
+
+    binaries.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned long long size = 0;
+        if (!in.read((char *)&size, sizeof(size)) || size == 0 || size > (1ULL << 31))
+            return false;
+        binaries[i].resize((size_t)size);
+        if (!in.read(&binaries[i][0], (std::streamsize)size))
+            return false;
+    }
+    return true;
+}
+
+inline void writeBinaries(const std::string& path, cl::Program& program)
+{
+    std::vector< ::size_t> sizes = program.getInfo<CL_PROGRAM_BINARY_SIZES>();
+    std::vector<std::string> binaries(sizes.size());
+    std::vector<unsigned char *> pointers(sizes.size());
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        if (sizes[i] == 0)
+            return;     // no binary for a device, nothing worth caching
+        binaries[i].resize(sizes[i]);
+        pointers[i] = (unsigned char *)&binaries[i][0];
+    }
+    if (clGetProgramInfo(program(), CL_PROGRAM_BINARIES,
+            sizeof(unsigned char *) * pointers.size(), &pointers[0], NULL) != CL_SUCCESS)
+        return;
+
+    // Write to a temporary file and rename it, so a reader never sees a
+    // partly written entry
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp.c_str(), std::ios::binary);
+        unsigned long long n = binaries.size();
+        out.write("CLBIN1", 6);
+        out.write((const char *)&n, sizeof(n));
+        for (size_t i = 0; i < binaries.size(); i++)
+        {
+            unsigned long long size = binaries[i].size();
+            out.write((const char *)&size, sizeof(size));
+            out.write(binaries[i].data(), (std::streamsize)size);
+        }
+        if (!out.good())
+        {
+            out.close();
+            remove(tmp.c_str());
+            return;
+        }
+    }
+    remove(path.c_str());
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+        remove(tmp.c_str());
+}
+
+} // namespace detail
+
+/*!
+ * \brief Builds a program for every device in the context, from the binary
+ * cache when possible.  Throws cl::Error as cl::Program::build does if the
+ * source does not build, after printing the build log to stderr.
+ */
+inline cl::Program buildProgram(const cl::Context& context, const std::string& source,
+    const std::string& options = "", BuildInfo *info = NULL)
+{
+    Timer timer;
+    std::vector<cl::Device> devices = context.getInfo<CL_CONTEXT_DEVICES>();
+    const std::string path = detail::cachePath(devices, source, options);
+
+    // Warm: link the cached binaries.  Any failure falls through to a build
+    // from source, which replaces the entry.
+    std::vector<std::string> binaries;
+    if (!path.empty() && detail::readBinaries(path, devices.size(), binaries))
+    {
+        try
+        {
+            cl::Program::Binaries bins;
+            for (size_t i = 0; i < binaries.size(); i++)
+                bins.push_back(std::make_pair((const void *)binaries[i].data(), binaries[i].size()));
+
+            std::vector<cl_int> status;
+            cl::Program program(context, devices, bins, &status);
+            program.build(devices, options.c_str());
+
+            if (info)
+            {
+                info->cached = true;
+                info->ms = timer.getTimeMicroseconds() / 1000.0;
+                info->path = path;
+            }
+            return program;
+        }
+        catch (cl::Error)
+        {
+        }
+    }
+
+    // Cold: build from source and save the binaries.  The build log is
+    // shown on a build failure, as the drivers did before the cache.
+    cl::Program program(context, source);
+    try
+    {
+        program.build(devices, options.c_str());
+    }
+    catch (cl::Error error)
+    {
+        if (error.err() == CL_BUILD_PROGRAM_FAILURE)
+        {
+            for (size_t i = 0; i < devices.size(); i++)
+                std::cerr << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(devices[i]) << "\n";
+        }
+        throw error;
+    }
+    const double ms = timer.getTimeMicroseconds() / 1000.0;
+
+    if (!path.empty())
+        detail::writeBinaries(path, program);
+
+    if (info)
+    {
+        info->cached = false;
+        info->ms = ms;
+        info->path = path;
+    }
+    return program;
+}
+
+/*!
+ * \brief Prints how a program was built, e.g.
+ *   "Built C_elem.cl from source in 412.3 ms" or
+ *   "Built C_elem.cl from cache in 3.1 ms"
+ */
+inline void printBuildInfo(const std::string& name, const BuildInfo& info)
+{
+    printf(" Built %s from %s in %.1f ms\n", name.c_str(),
+        info.cached ? "cache" : "source", info.ms);
+}
+
+} // namespace util
+
+#endif // __PROGRAM_CACHE_HDR
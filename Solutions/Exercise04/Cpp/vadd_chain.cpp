@@ -18,10 +18,14 @@
 #include "cl.hpp"
 
 #include "util.hpp" // utility library
+#include "kernel_registry.hpp"
+#include "program_cache.hpp"
+#include "host_buffer.hpp"
 
 #include <vector>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 
 #include <iostream>
@@ -39,23 +43,33 @@
 #define TOL    (0.001)   // tolerance used in floating point comparisons
 #define LENGTH (1024)    // length of vectors a, b, and c
 
-int main(void)
+//------------------------------------------------------------------------------
+//
+// Usage: vadd_chain [copy|use_host|alloc_host|svm]
+//
+// Runs the chain once in each buffer mode (see host_buffer.hpp), or only
+// in the mode named, and reports the time spent moving the vectors between
+// host and device.  The intermediate results c and d never leave the device.
+//
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
 {
-    std::vector<float> h_a(LENGTH);                // a vector 
-    std::vector<float> h_b(LENGTH);                // b vector 	
-    std::vector<float> h_c (LENGTH, 0xdeadbeef);   // c vector (result)
-    std::vector<float> h_d (LENGTH, 0xdeadbeef);   // d vector (result)
-    std::vector<float> h_e (LENGTH);               // e vector
-    std::vector<float> h_f (LENGTH, 0xdeadbeef);   // f vector (result)
-    std::vector<float> h_g (LENGTH);               // g vector
-
-    cl::Buffer d_a;                       // device memory used for the input  a vector
-    cl::Buffer d_b;                       // device memory used for the input  b vector
-    cl::Buffer d_c;                       // device memory used for the output c vector
-    cl::Buffer d_d;                       // device memory used for the output d vector
-    cl::Buffer d_e;                       // device memory used for the input e vector
-    cl::Buffer d_f;                       // device memory used for the output f vector
-    cl::Buffer d_g;                       // device memory used for the input g vector
+    util::aligned_vector<float> h_a(LENGTH);       // a vector
+    util::aligned_vector<float> h_b(LENGTH);       // b vector
+    util::aligned_vector<float> h_e(LENGTH);       // e vector
+    util::aligned_vector<float> h_g(LENGTH);       // g vector
+
+    int first = 0, last = util::BUFFER_MODES - 1;
+    if (argc > 1)
+    {
+        util::BufferMode mode;
+        if (!util::parseBufferMode(argv[1], mode))
+        {
+            std::cerr << "Usage: " << argv[0] << " [copy|use_host|alloc_host|svm]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        first = last = mode;
+    }
 
     // Fill vectors a and b with random float values
     int count = LENGTH;
@@ -71,73 +85,99 @@ int main(void)
     {
     	// Create a context
         cl::Context context(DEVICE);
+        cl::Device device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
 
         // Load in kernel source, creating a program object for the context
+        // (from the binary cache if it has been built before)
 
-        cl::Program program(context, util::loadProgram("vadd_chain.cl"), true);
+        cl::Program program = util::buildProgram(context, util::kernelSource("vadd_chain.cl"));
 
         // Get the command queue
         cl::CommandQueue queue(context);
 
-        // Create the kernel functor
+        // Create the kernel; its arguments are set by the buffers, as SVM
+        // pointers can not be passed through a kernel functor
  
-        cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, int> vadd(program, "vadd");
-
-        d_a   = cl::Buffer(context, h_a.begin(), h_a.end(), true);
-        d_b   = cl::Buffer(context, h_b.begin(), h_b.end(), true);
-        d_e   = cl::Buffer(context, h_e.begin(), h_e.end(), true);
-        d_g   = cl::Buffer(context, h_g.begin(), h_g.end(), true);
-
-        d_c  = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(float) * LENGTH);
-        d_d  = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(float) * LENGTH);
-        d_f  = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * LENGTH);
-
-        vadd(
-            cl::EnqueueArgs(
-                queue,
-                cl::NDRange(count)), 
-            d_a,
-            d_b,
-            d_c,
-            count);
-
-        vadd(
-            cl::EnqueueArgs(
-                queue,
-                cl::NDRange(count)), 
-            d_e,
-            d_c,
-            d_d,
-            count);
-
-        vadd(
-            cl::EnqueueArgs(
-                queue,
-                cl::NDRange(count)), 
-            d_g,
-            d_d,
-            d_f,
-            count);
-
-        cl::copy(queue, d_f, h_f.begin(), h_f.end());
-
-        // Test the results
-        int correct = 0;
-        float tmp;
-        for(int i = 0; i < count; i++)
+        cl::Kernel vadd(program, "vadd");
+
+        for (int m = first; m <= last; m++)
         {
-            tmp = h_a[i] + h_b[i] + h_e[i] + h_g[i];     // assign element i of a+b+e+g to tmp
-            tmp -= h_f[i];                               // compute deviation of expected and output result
-            if(tmp*tmp < TOL*TOL)                        // correct if square deviation is less than tolerance squared
-                correct++;
-            else {
-                printf(" tmp %f h_a %f h_b %f h_e %f h_g %f h_f %f\n",tmp, h_a[i], h_b[i], h_e[i], h_g[i], h_f[i]);
+            util::BufferMode mode = (util::BufferMode)m;
+            if (!util::bufferModeSupported(device, mode))
+            {
+                printf("%-10s  not supported by the device\n", util::bufferModeName(mode));
+                continue;
+            }
+
+            util::HostBuffer<float> a(context, queue, mode, LENGTH, CL_MEM_READ_ONLY);
+            util::HostBuffer<float> b(context, queue, mode, LENGTH, CL_MEM_READ_ONLY);
+            util::HostBuffer<float> e(context, queue, mode, LENGTH, CL_MEM_READ_ONLY);
+            util::HostBuffer<float> g(context, queue, mode, LENGTH, CL_MEM_READ_ONLY);
+
+            util::HostBuffer<float> c(context, queue, mode, LENGTH, CL_MEM_READ_WRITE);
+            util::HostBuffer<float> d(context, queue, mode, LENGTH, CL_MEM_READ_WRITE);
+            util::HostBuffer<float> f(context, queue, mode, LENGTH, CL_MEM_WRITE_ONLY);
+
+            memcpy(a.data(), &h_a[0], sizeof(float) * LENGTH);
+            memcpy(b.data(), &h_b[0], sizeof(float) * LENGTH);
+            memcpy(e.data(), &h_e[0], sizeof(float) * LENGTH);
+            memcpy(g.data(), &h_g[0], sizeof(float) * LENGTH);
+
+            // c and d hold intermediate results, so nothing is copied up
+            a.toDevice();
+            b.toDevice();
+            e.toDevice();
+            g.toDevice();
+            c.toDevice(false);
+            d.toDevice(false);
+            f.toDevice();
+
+            a.setArg(vadd, 0);
+            b.setArg(vadd, 1);
+            c.setArg(vadd, 2);
+            vadd.setArg(3, count);
+            queue.enqueueNDRangeKernel(vadd, cl::NullRange, cl::NDRange(count));
+
+            e.setArg(vadd, 0);
+            c.setArg(vadd, 1);
+            d.setArg(vadd, 2);
+            queue.enqueueNDRangeKernel(vadd, cl::NullRange, cl::NDRange(count));
+
+            g.setArg(vadd, 0);
+            d.setArg(vadd, 1);
+            f.setArg(vadd, 2);
+            queue.enqueueNDRangeKernel(vadd, cl::NullRange, cl::NDRange(count));
+
+            f.toHost();
+
+            // Test the results
+            int correct = 0;
+            float tmp;
+            for(int i = 0; i < count; i++)
+            {
+                tmp = h_a[i] + h_b[i] + h_e[i] + h_g[i];     // assign element i of a+b+e+g to tmp
+                tmp -= f[i];                                 // compute deviation of expected and output result
+                if(tmp*tmp < TOL*TOL)                        // correct if square deviation is less than tolerance squared
+                    correct++;
+                else {
+                    printf(" tmp %f h_a %f h_b %f h_e %f h_g %f h_f %f\n",tmp, h_a[i], h_b[i], h_e[i], h_g[i], f[i]);
+                }
             }
+
+            util::HostBuffer<float> *all[] = {&a, &b, &e, &g, &c, &d, &f};
+            double seconds = 0.0;
+            size_t bytes = 0;
+            for (int i = 0; i < 7; i++)
+            {
+                seconds += all[i]->transferSeconds();
+                bytes   += all[i]->transferBytes();
+            }
+
+            // summarize results
+            printf("%-10s  C = A+B+E+G:  %d out of %d results were correct.  transfers %.3f ms, %.1f KB copied\n",
+                util::bufferModeName(mode), correct, count, seconds * 1.0e3, bytes / 1024.0);
         }
         
-        // summarize results
-        printf("C = A+B+E+G:  %d out of %d results were correct.\n", correct, count);
-        
     }
     catch (cl::Error err) {
         std::cout << "Exception\n";
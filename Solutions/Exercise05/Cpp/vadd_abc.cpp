@@ -19,10 +19,14 @@
 #include "cl.hpp"
 
 #include "util.hpp" // utility library
+#include "kernel_registry.hpp"
+#include "program_cache.hpp"
+#include "host_buffer.hpp"
 
 #include <vector>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 
 #include <iostream>
@@ -40,17 +44,33 @@
 #define TOL    (0.001)   // tolerance used in floating point comparisons
 #define LENGTH (1024)    // length of vectors a, b, and c
 
-int main(void)
+//------------------------------------------------------------------------------
+//
+// Usage: vadd_abc [copy|use_host|alloc_host|svm]
+//
+// Runs the addition once in each buffer mode (see host_buffer.hpp), or
+// only in the mode named, and reports the time spent moving the vectors
+// between host and device.  On a device sharing memory with the host the
+// mapped modes should need next to no time.
+//
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
 {
-    std::vector<float> h_a(LENGTH);                // a vector
-    std::vector<float> h_b(LENGTH);                // b vector
-    std::vector<float> h_c(LENGTH);                // c vector
-    std::vector<float> h_d (LENGTH, 0xdeadbeef);   // d vector (result)
+    util::aligned_vector<float> h_a(LENGTH);       // a vector
+    util::aligned_vector<float> h_b(LENGTH);       // b vector
+    util::aligned_vector<float> h_c(LENGTH);       // c vector
 
-    cl::Buffer d_a;                       // device memory used for the input  a vector
-    cl::Buffer d_b;                       // device memory used for the input  b vector
-    cl::Buffer d_c;                       // device memory used for the input c vector
-    cl::Buffer d_d;                       // device memory used for the output d vector
+    int first = 0, last = util::BUFFER_MODES - 1;
+    if (argc > 1)
+    {
+        util::BufferMode mode;
+        if (!util::parseBufferMode(argv[1], mode))
+        {
+            std::cerr << "Usage: " << argv[0] << " [copy|use_host|alloc_host|svm]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        first = last = mode;
+    }
 
     // Fill vectors a and b with random float values
     int count = LENGTH;
@@ -65,52 +85,74 @@ int main(void)
     {
     	// Create a context
         cl::Context context(DEVICE);
+        cl::Device device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
 
         // Load in kernel source, creating a program object for the context
+        // (from the binary cache if it has been built before)
 
-        cl::Program program(context, util::loadProgram("vadd_abc.cl"), true);
+        cl::Program program = util::buildProgram(context, util::kernelSource("vadd_abc.cl"));
 
         // Get the command queue
         cl::CommandQueue queue(context);
 
-        // Create the kernel functor
+        // Create the kernel; its arguments are set by the buffers, as SVM
+        // pointers can not be passed through a kernel functor
 
-        cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, int> vadd(program, "vadd");
+        cl::Kernel vadd(program, "vadd");
 
-        d_a   = cl::Buffer(context, h_a.begin(), h_a.end(), true);
-        d_b   = cl::Buffer(context, h_b.begin(), h_b.end(), true);
-        d_c   = cl::Buffer(context, h_c.begin(), h_c.end(), true);
-
-        d_d  = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * LENGTH);
-
-        vadd(
-            cl::EnqueueArgs(
-                queue,
-                cl::NDRange(count)),
-            d_a,
-            d_b,
-            d_c,
-            d_d,
-            count);
-
-        cl::copy(queue, d_d, h_d.begin(), h_d.end());
-
-        // Test the results
-        int correct = 0;
-        float tmp;
-        for(int i = 0; i < count; i++)
+        for (int m = first; m <= last; m++)
         {
-            tmp = h_a[i] + h_b[i] + h_c[i];              // assign element i of a+b+c to tmp
-            tmp -= h_d[i];                               // compute deviation of expected and output result
-            if(tmp*tmp < TOL*TOL)                        // correct if square deviation is less than tolerance squared
-                correct++;
-            else {
-                printf(" tmp %f h_a %f h_b %f h_c %f h_d %f\n",tmp, h_a[i], h_b[i], h_c[i], h_d[i]);
+            util::BufferMode mode = (util::BufferMode)m;
+            if (!util::bufferModeSupported(device, mode))
+            {
+                printf("%-10s  not supported by the device\n", util::bufferModeName(mode));
+                continue;
+            }
+
+            util::HostBuffer<float> a(context, queue, mode, LENGTH, CL_MEM_READ_ONLY);
+            util::HostBuffer<float> b(context, queue, mode, LENGTH, CL_MEM_READ_ONLY);
+            util::HostBuffer<float> c(context, queue, mode, LENGTH, CL_MEM_READ_ONLY);
+            util::HostBuffer<float> d(context, queue, mode, LENGTH, CL_MEM_WRITE_ONLY);
+
+            memcpy(a.data(), &h_a[0], sizeof(float) * LENGTH);
+            memcpy(b.data(), &h_b[0], sizeof(float) * LENGTH);
+            memcpy(c.data(), &h_c[0], sizeof(float) * LENGTH);
+
+            a.toDevice();
+            b.toDevice();
+            c.toDevice();
+            d.toDevice();
+
+            a.setArg(vadd, 0);
+            b.setArg(vadd, 1);
+            c.setArg(vadd, 2);
+            d.setArg(vadd, 3);
+            vadd.setArg(4, count);
+
+            queue.enqueueNDRangeKernel(vadd, cl::NullRange, cl::NDRange(count));
+
+            d.toHost();
+
+            // Test the results
+            int correct = 0;
+            float tmp;
+            for(int i = 0; i < count; i++)
+            {
+                tmp = h_a[i] + h_b[i] + h_c[i];              // assign element i of a+b+c to tmp
+                tmp -= d[i];                                 // compute deviation of expected and output result
+                if(tmp*tmp < TOL*TOL)                        // correct if square deviation is less than tolerance squared
+                    correct++;
+                else {
+                    printf(" tmp %f h_a %f h_b %f h_c %f h_d %f\n",tmp, h_a[i], h_b[i], h_c[i], d[i]);
+                }
             }
-        }
 
-        // summarize results
-        printf("D = A+B+C:  %d out of %d results were correct.\n", correct, count);
+            // summarize results
+            printf("%-10s  D = A+B+C:  %d out of %d results were correct.  transfers %.3f ms, %.1f KB copied\n",
+                util::bufferModeName(mode), correct, count,
+                (a.transferSeconds() + b.transferSeconds() + c.transferSeconds() + d.transferSeconds()) * 1.0e3,
+                (a.transferBytes() + b.transferBytes() + c.transferBytes() + d.transferBytes()) / 1024.0);
+        }
 
     }
     catch (cl::Error err) {
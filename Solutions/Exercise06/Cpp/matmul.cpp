@@ -24,6 +24,7 @@
 #include "matmul.hpp"
 #include "matrix_lib.hpp"
 #include "util.hpp"
+#include "program_cache.hpp"
 #include "err_code.h"
 #include "device_picker.hpp"
 
@@ -139,8 +140,9 @@ int main(int argc, char *argv[])
 // OpenCL matrix multiplication ... Naive
 //--------------------------------------------------------------------------------
 
-        // Create the compute program from the source buffer
-        cl::Program program(context, kernelsource, true);
+        // Create the compute program from the source buffer, or from the
+        // binary cache if it has been built before (see program_cache.hpp)
+        cl::Program program = util::buildProgram(context, kernelsource);
 
         // Create the compute kernel from the program
         cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer> naive_mmul(program, "mmul");
@@ -24,10 +24,10 @@
 
 #include "matmul.h"
 #include "matrix_lib.h"
+#include "kernel_registry.h"
 #include "err_code.h"
 #include "device_picker.h"
 
-char * getKernelSource(char *filename);
 
 int main(int argc, char *argv[])
 {
@@ -131,7 +131,7 @@ int main(int argc, char *argv[])
 // OpenCL matrix multiplication ... Naive
 //--------------------------------------------------------------------------------
 
-    kernelsource = getKernelSource("../C_elem.cl");
+    kernelsource = kernelSource("C_elem.cl");
     // Create the comput program from the source buffer
     program = clCreateProgramWithSource(context, 1, (const char **) & kernelsource, NULL, &err);
     checkError(err, "Creating program with C_elem.cl");
@@ -199,7 +199,7 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 // OpenCL matrix multiplication ... C row per work item
 //--------------------------------------------------------------------------------
-    kernelsource = getKernelSource("../C_row.cl");
+    kernelsource = kernelSource("C_row.cl");
     // Create the comput program from the source buffer
     program = clCreateProgramWithSource(context, 1, (const char **) & kernelsource, NULL, &err);
     checkError(err, "Creating program with C_row.cl");
@@ -266,7 +266,7 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 // OpenCL matrix multiplication ... C row per work item, A row in pivate memory
 //--------------------------------------------------------------------------------
-    kernelsource = getKernelSource("../C_row_priv.cl");
+    kernelsource = kernelSource("C_row_priv.cl");
     // Create the comput program from the source buffer
     program = clCreateProgramWithSource(context, 1, (const char **) & kernelsource, NULL, &err);
     checkError(err, "Creating program from C_row_priv.cl");
@@ -348,27 +348,3 @@ int main(int argc, char *argv[])
 
     return EXIT_SUCCESS;
 }
-
-
-char * getKernelSource(char *filename)
-{
-    FILE *file = fopen(filename, "r");
-    if (!file)
-    {
-        fprintf(stderr, "Error: Could not open kernel source file\n");
-        exit(EXIT_FAILURE);
-    }
-    fseek(file, 0, SEEK_END);
-    int len = ftell(file) + 1;
-    rewind(file);
-
-    char *source = (char *)calloc(sizeof(char), len);
-    if (!source)
-    {
-        fprintf(stderr, "Error: Could not allocate memory for source string\n");
-        exit(EXIT_FAILURE);
-    }
-    fread(source, sizeof(char), len, file);
-    fclose(file);
-    return source;
-}
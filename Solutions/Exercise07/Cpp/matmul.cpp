@@ -22,6 +22,8 @@
 //------------------------------------------------------------------------------
 
 #include "matmul.hpp"
+#include "kernel_registry.hpp"
+#include "program_cache.hpp"
 #include "matrix_lib.hpp"
 #include "err_code.h"
 #include "device_picker.hpp"
@@ -115,8 +117,9 @@ int main(int argc, char *argv[])
 // OpenCL matrix multiplication ... Naive
 //--------------------------------------------------------------------------------
 
-        // Create the compute program from the source buffer
-        cl::Program program(context, util::loadProgram("../C_elem.cl"), true);
+        // Create the compute program from the source buffer, or from the
+        // binary cache if it has been built before (see program_cache.hpp)
+        cl::Program program = util::buildProgram(context, util::kernelSource("C_elem.cl"));
 
         // Create the compute kernel from the program
         cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer> naive_mmul(program, "mmul");
@@ -152,8 +155,9 @@ int main(int argc, char *argv[])
 // OpenCL matrix multiplication ... C row per work item
 //--------------------------------------------------------------------------------
 
-        // Create the compute program from the source buffer
-        program = cl::Program(context, util::loadProgram("../C_row.cl"), true);
+        // Create the compute program from the source buffer, or from the
+        // binary cache if it has been built before (see program_cache.hpp)
+        program = util::buildProgram(context, util::kernelSource("C_row.cl"));
 
         // Create the compute kernel from the program
         cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer> crow_mmul(program, "mmul");
@@ -185,8 +189,9 @@ int main(int argc, char *argv[])
 // OpenCL matrix multiplication ... C row per work item, A row in pivate memory
 //--------------------------------------------------------------------------------
 
-        // Create the compute program from the source buffer
-        program = cl::Program(context, util::loadProgram("../C_row_priv.cl"), true);
+        // Create the compute program from the source buffer, or from the
+        // binary cache if it has been built before (see program_cache.hpp)
+        program = util::buildProgram(context, util::kernelSource("C_row_priv.cl"));
 
         // Create the compute kernel from the program
         cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer> arowpriv_mmul(program, "mmul");
@@ -24,10 +24,10 @@
 
 #include "matmul.h"
 #include "matrix_lib.h"
+#include "kernel_registry.h"
 #include "err_code.h"
 #include "device_picker.h"
 
-char * getKernelSource(char *filename);
 
 int main(int argc, char *argv[])
 {
@@ -133,7 +133,7 @@ int main(int argc, char *argv[])
 // OpenCL matrix multiplication ... Naive
 //--------------------------------------------------------------------------------
 
-    kernelsource = getKernelSource("../C_elem.cl");
+    kernelsource = kernelSource("C_elem.cl");
     // Create the comput program from the source buffer
     program = clCreateProgramWithSource(context, 1, (const char **) & kernelsource, NULL, &err);
     checkError(err, "Creating program with C_elem.cl");
@@ -163,9 +163,11 @@ int main(int argc, char *argv[])
         zero_mat(N, h_C);
 
         err =  clSetKernelArg(kernel, 0, sizeof(int),    &N);
-        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &d_a);
-        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &d_b);
-        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_c);
+        err |= clSetKernelArg(kernel, 1, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 2, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_a);
+        err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), &d_b);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_mem), &d_c);
 
         checkError(err, "Setting kernel args");
 
@@ -202,7 +204,7 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 // OpenCL matrix multiplication ... C row per work item
 //--------------------------------------------------------------------------------
-    kernelsource = getKernelSource("../C_row.cl");
+    kernelsource = kernelSource("C_row.cl");
     // Create the comput program from the source buffer
     program = clCreateProgramWithSource(context, 1, (const char **) & kernelsource, NULL, &err);
     checkError(err, "Creating program with C_row.cl");
@@ -232,9 +234,11 @@ int main(int argc, char *argv[])
         zero_mat(N, h_C);
 
         err =  clSetKernelArg(kernel, 0, sizeof(int),    &N);
-        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &d_a);
-        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &d_b);
-        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_c);
+        err |= clSetKernelArg(kernel, 1, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 2, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_a);
+        err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), &d_b);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_mem), &d_c);
 
         checkError(err, "Setting kernel args");
 
@@ -270,7 +274,7 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 // OpenCL matrix multiplication ... C row per work item, A row in pivate memory
 //--------------------------------------------------------------------------------
-    kernelsource = getKernelSource("../C_row_priv.cl");
+    kernelsource = kernelSource("C_row_priv.cl");
     // Create the comput program from the source buffer
     program = clCreateProgramWithSource(context, 1, (const char **) & kernelsource, NULL, &err);
     checkError(err, "Creating program with C_row_priv.cl");
@@ -300,9 +304,11 @@ int main(int argc, char *argv[])
         zero_mat(N, h_C);
 
         err =  clSetKernelArg(kernel, 0, sizeof(int),    &N);
-        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &d_a);
-        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &d_b);
-        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_c);
+        err |= clSetKernelArg(kernel, 1, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 2, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_a);
+        err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), &d_b);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_mem), &d_c);
 
         checkError(err, "Setting kernel args");
 
@@ -338,7 +344,7 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 // OpenCL matrix multiplication ... C row per work item, A row pivate, B col local
 //--------------------------------------------------------------------------------
-    kernelsource = getKernelSource("../C_row_priv_bloc.cl");
+    kernelsource = kernelSource("C_row_priv_bloc.cl");
     // Create the comput program from the source buffer
     program = clCreateProgramWithSource(context, 1, (const char **) & kernelsource, NULL, &err);
     checkError(err, "Creating program with C_row_priv_bloc.cl");
@@ -369,10 +375,12 @@ int main(int argc, char *argv[])
         zero_mat(N, h_C);
 
         err =  clSetKernelArg(kernel, 0, sizeof(int),    &N);
-        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &d_a);
-        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &d_b);
-        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_c);
-        err |= clSetKernelArg(kernel, 4, sizeof(float) * N, NULL);
+        err |= clSetKernelArg(kernel, 1, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 2, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_a);
+        err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), &d_b);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_mem), &d_c);
+        err |= clSetKernelArg(kernel, 6, sizeof(float) * N, NULL);
 
         checkError(err, "Setting kernel args");
 
@@ -409,7 +417,7 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 // OpenCL matrix multiplication ... blocked
 //--------------------------------------------------------------------------------
-    kernelsource = getKernelSource("../C_block_form.cl");
+    kernelsource = kernelSource("C_block_form.cl");
     // Create the comput program from the source buffer
     program = clCreateProgramWithSource(context, 1, (const char **) & kernelsource, NULL, &err);
     checkError(err, "Creating program with C_block_form.cl");
@@ -445,11 +453,13 @@ int main(int argc, char *argv[])
         const unsigned int blocksize = 16;
 
         err =  clSetKernelArg(kernel, 0, sizeof(int),    &N);
-        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &d_a);
-        err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &d_b);
-        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_c);
-        err |= clSetKernelArg(kernel, 4, sizeof(float) * blocksize * blocksize, NULL);
-        err |= clSetKernelArg(kernel, 5, sizeof(float) * blocksize * blocksize, NULL);
+        err |= clSetKernelArg(kernel, 1, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 2, sizeof(int),    &N);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_a);
+        err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), &d_b);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_mem), &d_c);
+        err |= clSetKernelArg(kernel, 6, sizeof(float) * blocksize * blocksize, NULL);
+        err |= clSetKernelArg(kernel, 7, sizeof(float) * blocksize * blocksize, NULL);
 
         checkError(err, "Setting kernel args");
 
@@ -499,27 +509,3 @@ int main(int argc, char *argv[])
 
     return EXIT_SUCCESS;
 }
-
-
-char * getKernelSource(char *filename)
-{
-    FILE *file = fopen(filename, "r");
-    if (!file)
-    {
-        fprintf(stderr, "Error: Could not open kernel source file\n");
-        exit(EXIT_FAILURE);
-    }
-    fseek(file, 0, SEEK_END);
-    int len = ftell(file) + 1;
-    rewind(file);
-
-    char *source = (char *)calloc(sizeof(char), len);
-    if (!source)
-    {
-        fprintf(stderr, "Error: Could not allocate memory for source string\n");
-        exit(EXIT_FAILURE);
-    }
-    fread(source, sizeof(char), len, file);
-    fclose(file);
-    return source;
-}
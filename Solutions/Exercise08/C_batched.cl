@@ -0,0 +1,148 @@
+//-------------------------------------------------------------
+//
+//  PROGRAM: Batched Matrix Multipliplication kernel
+//
+//  PURPOSE: Computes a batch of small, independent products
+//
+//              C[b] = A[b] * B[b]      b = 0 .. batch-1
+//
+//           in a single launch.  Launching one of the mmul
+//           kernels per matrix pays the enqueue overhead for
+//           every product and a small matrix only fills a
+//           fraction of the device, so instead each work-group
+//           computes MPG whole matrices of the batch.
+//
+//           A[b] is M x K, B[b] is K x N and C[b] is M x N, all
+//           row-major.  Matrix b of each batch starts at
+//           b*strideA, b*strideB and b*strideC floats, so the
+//           batch can be contiguous (stride = matrix size),
+//           padded (stride > matrix size) or share one operand
+//           between all products (stride = 0).
+//
+//           The work-group walks down K in steps of BK.  For
+//           each step it copies the BK wide slices of A[b] and
+//           B[b] for all its matrices into local memory and
+//           then each work-item adds their contribution to the
+//           EPT elements of C it owns, held in registers.  The
+//           elements of the MPG products are dealt out to the
+//           work-items round robin, so any M, N and work-group
+//           size can be used.
+//
+//           We use the following conventions:
+//
+//             first            ... first matrix of this work-group
+//             nmat             ... matrices in this work-group
+//             idx              ... element index over all nmat
+//                                  matrices (matrix, row, col)
+//
+//  HISTORY: Written for the Exercise 8 solutions
+//
+//  LICENSE: This work is licensed under the Creative Commons
+//           Attribution 4.0 International License.
+//           To view a copy of this license, visit
+//           http://creativecommons.org/licenses/by/4.0/
+//           or send a letter to:
+//              Creative Commons,
+//              444 Castro Street, Suite 900,
+//              Mountain View, California, 94041, USA.
+//
+//-------------------------------------------------------------
+
+// The host passes these with -D so that they agree with the
+// NDRange and local memory sizes it uses (see batched.cpp).
+// EPT must be at least MPG*M*N divided by the work-group size.
+#ifndef MPG
+#define MPG 1          // matrices per work-group
+#endif
+#ifndef EPT
+#define EPT 1          // elements of C per work-item
+#endif
+#ifndef BK
+#define BK  16         // depth of the A and B slices in local memory
+#endif
+
+__kernel void mmul_batched(
+                const int                      M,
+                const int                      N,
+                const int                      K,
+                const int                      batch,
+                __global const float* restrict A,
+                const int                      strideA,
+                __global const float* restrict B,
+                const int                      strideB,
+                __global       float* restrict C,
+                const int                      strideC,
+                __local        float* restrict Awrk,    // MPG*M*BK
+                __local        float* restrict Bwrk)    // MPG*BK*N
+{
+    int e, k, kBase, idx;
+
+    const int lid   = get_local_id(0);
+    const int lsz   = get_local_size(0);
+    const int first = get_group_id(0)*MPG;
+    const int nmat  = min(MPG, batch - first);
+    const int MN    = M*N;
+
+    float acc[EPT];
+    for (e = 0; e < EPT; e++)
+        acc[e] = 0.0f;
+
+    for (kBase = 0; kBase < K; kBase += BK)
+    {
+        const int kn = min(BK, K - kBase);
+
+        // Copy A[b](:, kBase:kBase+kn) for each matrix into Awrk
+        for (idx = lid; idx < nmat*M*kn; idx += lsz)
+        {
+            const int b   = idx / (M*kn);
+            const int r   = idx % (M*kn);
+            const int row = r / kn;
+            const int kk  = r % kn;
+            Awrk[(b*M + row)*BK + kk] =
+                A[(first+b)*strideA + row*K + kBase + kk];
+        }
+
+        // Copy B[b](kBase:kBase+kn, :) for each matrix into Bwrk
+        for (idx = lid; idx < nmat*kn*N; idx += lsz)
+        {
+            const int b   = idx / (kn*N);
+            const int r   = idx % (kn*N);
+            const int kk  = r / N;
+            const int col = r % N;
+            Bwrk[(b*BK + kk)*N + col] =
+                B[(first+b)*strideB + (kBase+kk)*N + col];
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for (e = 0; e < EPT; e++)
+        {
+            idx = e*lsz + lid;
+            if (idx < nmat*MN)
+            {
+                const int b   = idx / MN;
+                const int row = (idx % MN) / N;
+                const int col = idx % N;
+                __local const float* a = Awrk + (b*M + row)*BK;
+                __local const float* p = Bwrk + b*BK*N + col;
+                float tmp = acc[e];
+                for (k = 0; k < kn; k++)
+                    tmp += a[k] * p[k*N];
+                acc[e] = tmp;
+            }
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    // update the C matrices of this work-group
+    for (e = 0; e < EPT; e++)
+    {
+        idx = e*lsz + lid;
+        if (idx < nmat*MN)
+        {
+            const int b = idx / MN;
+            C[(first+b)*strideC + idx % MN] = acc[e];
+        }
+    }
+}
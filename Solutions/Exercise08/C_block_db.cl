@@ -0,0 +1,143 @@
+//-------------------------------------------------------------
+//
+//  PROGRAM: Blocked Matrix Multipliplication kernel, double
+//           buffered
+//
+//  PURPOSE: Computes an element of the product matrix
+//
+//              C = A * B
+//
+//           with the blocked algorithm of C_block_form.cl, but
+//           without waiting for each pair of blocks to arrive.
+//
+//           In C_block_form.cl every step over K loads a block
+//           of A and of B into local memory, waits at a barrier,
+//           computes, and waits at a second barrier before the
+//           next load may overwrite the blocks.  The work-group
+//           sits idle for the whole latency of the global loads
+//           every step.
+//
+//           Here local memory holds two blocks of each operand.
+//           While the work-group computes on one pair, the
+//           elements of the next pair are already being fetched
+//           into registers: the loads are issued before the
+//           multiply-adds and only stored to the other pair of
+//           blocks after them, so their latency is hidden behind
+//           the arithmetic.  As a block being filled is never the
+//           one being read, one barrier per step is enough.
+//
+//           Indices follow C_block_form.cl:
+//
+//             i,j,k            ... indices of full, global matrices
+//             Iblk, Jblk, Kblk ... indices of matrix blocks
+//             iloc, jloc, kloc ... indices inside blocks
+//
+//           The host passes -Dblksz and, when M, N or K is not a
+//           multiple of blksz, -DEDGES as for C_block_form.cl.
+//           Awrk and Bwrk hold 2*blksz*blksz floats each.
+//
+//  HISTORY: Written for the Exercise 8 solutions, based on the
+//           blocked kernel by Tim Mattson and Simon McIntosh-Smith
+//
+//  LICENSE: This work is licensed under the Creative Commons
+//           Attribution 4.0 International License.
+//           To view a copy of this license, visit
+//           http://creativecommons.org/licenses/by/4.0/
+//           or send a letter to:
+//              Creative Commons,
+//              444 Castro Street, Suite 900,
+//              Mountain View, California, 94041, USA.
+//
+//-------------------------------------------------------------
+
+#ifndef blksz
+#define blksz 16
+#endif
+
+#ifdef EDGES
+#define LOAD(cond, val) ((cond) ? (val) : 0.0f)
+#else
+#define LOAD(cond, val) (val)
+#endif
+
+__kernel void mmul(
+                const int                      M,
+                const int                      N,
+                const int                      K,
+                __global const float* restrict A,
+                __global const float* restrict B,
+                __global       float* restrict C,
+                __local        float* restrict Awrk,
+                __local        float* restrict Bwrk)
+{
+    int kloc, Kblk;
+    float Ctmp = 0.0f;
+
+    //  This work-item will compute element C(j,i)
+    const int i = get_global_id(0);
+    const int j = get_global_id(1);
+
+    const int Iblk = get_group_id(0);
+    const int Jblk = get_group_id(1);
+
+    const int iloc = get_local_id(0);
+    const int jloc = get_local_id(1);
+
+    const int Num_BLK = (K+blksz-1)/blksz;
+
+    // The elements this work-item loads: A(j, Kblk*blksz+iloc)
+    // and B(Kblk*blksz+jloc, i)
+          int Abase = Jblk*K*blksz + jloc*K + iloc;
+    const int Ainc  = blksz;
+
+          int Bbase = Iblk*blksz + jloc*N + iloc;
+    const int Binc  = blksz*N;
+
+    const int loc = jloc*blksz + iloc;
+
+    // Load the first pair of blocks into buffer 0
+    Awrk[loc] = LOAD(j < M && iloc < K, A[Abase]);
+    Bwrk[loc] = LOAD(jloc < K && i < N, B[Bbase]);
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (Kblk = 0; Kblk < Num_BLK; Kblk++)
+    {
+       // cur is the pair of blocks holding block Kblk, nxt the
+       // pair the next blocks go into
+       const int cur = (Kblk & 1) * blksz*blksz;
+       const int nxt = blksz*blksz - cur;
+
+       // Start fetching the next blocks
+       float Anext = 0.0f, Bnext = 0.0f;
+       const int more = Kblk+1 < Num_BLK;
+       if (more)
+       {
+          Abase += Ainc;
+          Bbase += Binc;
+          const int kA = (Kblk+1)*blksz + iloc;
+          const int kB = (Kblk+1)*blksz + jloc;
+          Anext = LOAD(j < M && kA < K, A[Abase]);
+          Bnext = LOAD(kB < K && i < N, B[Bbase]);
+       }
+
+       // Compute on the current blocks while they arrive
+       #pragma unroll
+       for (kloc=0; kloc<blksz; kloc++)
+          Ctmp += Awrk[cur + jloc*blksz+kloc] * Bwrk[cur + kloc*blksz+iloc];
+
+       // The other pair was last read before the previous
+       // barrier, so it can be filled now
+       if (more)
+       {
+          Awrk[nxt + loc] = Anext;
+          Bwrk[nxt + loc] = Bnext;
+       }
+       barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    // update global C matrix
+#ifdef EDGES
+    if (j < M && i < N)
+#endif
+       C[j*N+i] = Ctmp;
+}
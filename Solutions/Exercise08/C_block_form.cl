@@ -44,21 +44,116 @@
 
 // It turns out that the compiler generates much better code if
 // we "hardwire" this block size.  16 works well for an NVIDIA 
-// GPU, 32 works well for a CPU
+// GPU, 32 works well for a CPU.  The host can override it with
+// -Dblksz=... when it builds the program (see the autotuner)
+#ifndef blksz
 #define blksz 16
+#endif
+
+// Element types.  Everything is float unless the host passes one
+// of these build options (see precision.hpp on the host):
+//
+//   -DPREC_HALF    A, B and C stored as half, float arithmetic.
+//                  vload_half/vstore_half are core OpenCL, so this
+//                  needs no extension.
+//   -DPREC_DOUBLE  double throughout (needs cl_khr_fp64)
+//   -DPREC_INT8    A and B stored as char, int arithmetic, int C
+//
+// elem_t is the storage type of A and B, acc_t the type used for
+// the blocks in local memory and the dot products, out_t the
+// storage type of C.
+#if defined(PREC_HALF)
+typedef half   elem_t;
+typedef float  acc_t;
+typedef half   out_t;
+#define READ(p, n)      vload_half((n), (p))
+#define WRITE(p, n, v)  vstore_half((v), (n), (p))
+#elif defined(PREC_DOUBLE)
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+typedef double elem_t;
+typedef double acc_t;
+typedef double out_t;
+#define READ(p, n)      ((p)[n])
+#define WRITE(p, n, v)  ((p)[n] = (v))
+#elif defined(PREC_INT8)
+typedef char   elem_t;
+typedef int    acc_t;
+typedef int    out_t;
+#define READ(p, n)      ((int)(p)[n])
+#define WRITE(p, n, v)  ((p)[n] = (v))
+#else
+typedef float  elem_t;
+typedef float  acc_t;
+typedef float  out_t;
+#define READ(p, n)      ((p)[n])
+#define WRITE(p, n, v)  ((p)[n] = (v))
+#endif
+
+// When M, N or K is not a multiple of blksz the host also passes
+// -DEDGES.  The blocks that hang over the edge of a matrix are then
+// padded with zeros as they are loaded.  Without EDGES the loads
+// are exactly as before, so aligned sizes lose nothing.
+#ifdef EDGES
+#define LOAD(cond, val) ((cond) ? (val) : (acc_t)0)
+#else
+#define LOAD(cond, val) (val)
+#endif
+
+// Epilogue.  Element-wise operations on C are applied to Ctmp
+// before the single store, instead of by separate passes that
+// each read and write all of C again.  The host picks them with
+// build options (see epilogue.hpp) and they run in this order:
+//
+//   -DEPI_SCALE     x = scale * x
+//   -DEPI_BIAS      x = x + bias[col]          bias has N elements
+//   -DEPI_RELU      x = max(x, 0)
+//   -DEPI_GELU      x = gelu(x), tanh approximation
+//   -DEPI_RESIDUAL  x = x + R[row*N + col]     R is M x N
+//
+// Each operation with an operand adds an argument after the local
+// blocks, in the order above.
+#ifdef EPI_SCALE
+#define EPI_SCALE_ARG , const float epi_scale
+#else
+#define EPI_SCALE_ARG
+#endif
+#ifdef EPI_BIAS
+#define EPI_BIAS_ARG , __global const out_t* restrict epi_bias
+#else
+#define EPI_BIAS_ARG
+#endif
+#ifdef EPI_RESIDUAL
+#define EPI_RES_ARG , __global const out_t* restrict epi_res
+#else
+#define EPI_RES_ARG
+#endif
+
+#ifdef EPI_GELU
+#ifdef PREC_INT8
+#error "EPI_GELU needs real valued C"
+#endif
+acc_t gelu(acc_t x)
+{
+    return 0.5f * x * (1.0f + tanh(0.7978845608f * (x + 0.044715f * x*x*x)));
+}
+#endif
 
 __kernel void mmul(
-                const unsigned int             N,
-                __global const float* restrict A,
-                __global const float* restrict B,
-                __global       float* restrict C,
-                __local        float* restrict Awrk,
-                __local        float* restrict Bwrk)
+                const int                      M,
+                const int                      N,
+                const int                      K,
+                __global const elem_t* restrict A,
+                __global const elem_t* restrict B,
+                __global       out_t*  restrict C,
+                __local        acc_t*  restrict Awrk,
+                __local        acc_t*  restrict Bwrk
+                EPI_SCALE_ARG EPI_BIAS_ARG EPI_RES_ARG)
 {
     int kloc, Kblk;
-    float Ctmp=0.0f;
+    acc_t Ctmp=0;
 
-    //  This work-item will compute element C(i,j)
+    //  This work-item will compute element C(j,i), i.e. row j
+    //  and column i of the M x N matrix C
     const int i = get_global_id(0);
     const int j = get_global_id(1);
 
@@ -70,13 +165,14 @@ __kernel void mmul(
     const int iloc = get_local_id(0);
     const int jloc = get_local_id(1);
 
-    // The number of blocks are the same in each dimension
-    const int Num_BLK = N/blksz;
+    // The number of blocks along K (a partial block at the end
+    // is only possible with EDGES)
+    const int Num_BLK = (K+blksz-1)/blksz;
 
     // Setup the upper-left-corner (base address) for the A and
     // B blocks plus the increments to advance base addresses as
     // we loop over blocks
-          int Abase = Jblk*N*blksz;    
+          int Abase = Jblk*K*blksz;
     const int Ainc  = blksz;
 
           int Bbase = Iblk*blksz;
@@ -90,8 +186,10 @@ __kernel void mmul(
        // Each work-item loads a single element of the two blocks
        // which are shared with the entire work-group.
 
-       Awrk[jloc*blksz+iloc] = A[Abase+jloc*N+iloc];
-       Bwrk[jloc*blksz+iloc] = B[Bbase+jloc*N+iloc];
+       Awrk[jloc*blksz+iloc] = LOAD(j < M && Kblk*blksz+iloc < K,
+                                    READ(A, Abase+jloc*K+iloc));
+       Bwrk[jloc*blksz+iloc] = LOAD(Kblk*blksz+jloc < K && i < N,
+                                    READ(B, Bbase+jloc*N+iloc));
 
        barrier(CLK_LOCAL_MEM_FENCE);
 
@@ -106,7 +204,27 @@ __kernel void mmul(
        Bbase += Binc;
     }
  
-    // update global C matrix 
-    C[j*N+i] = Ctmp;
+    // apply the epilogue and update global C matrix
+#ifdef EDGES
+    if (j < M && i < N)
+#endif
+    {
+#ifdef EPI_SCALE
+       Ctmp *= epi_scale;
+#endif
+#ifdef EPI_BIAS
+       Ctmp += READ(epi_bias, i);
+#endif
+#ifdef EPI_RELU
+       Ctmp = max(Ctmp, (acc_t)0);
+#endif
+#ifdef EPI_GELU
+       Ctmp = gelu(Ctmp);
+#endif
+#ifdef EPI_RESIDUAL
+       Ctmp += READ(epi_res, j*N+i);
+#endif
+       WRITE(C, j*N+i, Ctmp);
+    }
 
 }
@@ -0,0 +1,267 @@
+//-------------------------------------------------------------
+//
+//  PROGRAM: Register tiled Matrix Multipliplication kernel
+//
+//  PURPOSE: Computes a WPTM x WPTN micro-tile of the product
+//           matrix per work-item
+//
+//              C = A * B
+//
+//           This builds on the blocked algorithm in
+//           C_block_form.cl.  In that kernel every work-item
+//           computes a single element of C, so each multiply-add
+//           needs two scalar loads from local memory and the
+//           kernel is limited by local memory bandwidth.
+//
+//           Here a work-group computes a TSM x TSN block of C
+//           and each work-item keeps a WPTM x WPTN micro-tile of
+//           that block in registers.  For each k inside a block
+//           a work-item loads WPTM values of A and WPTN values
+//           of B from local memory as float4 vectors and reuses
+//           them for WPTM*WPTN multiply-adds.
+//
+//           The A block is stored transposed in local memory
+//           (k-major) so that the WPTM values of A needed for a
+//           given k are contiguous and can be read with vload4,
+//           just like the WPTN values of B.
+//
+//           We use the following conventions:
+//
+//             row, col         ... indices of full, global matrices
+//             kBase            ... first k index of the current block
+//             tidm, tidn       ... micro-tile indices inside the block
+//             wm, wn           ... indices inside a micro-tile
+//
+//           A is M x K, B is K x N and C is M x N.  When M is
+//           not a multiple of TSM, N of TSN or K of TSK the host
+//           also passes -DEDGES, and the loads and stores at the
+//           edges of the matrices are checked one element at a
+//           time (missing elements are loaded as zero).
+//
+//  HISTORY: Written for the Exercise 8 solutions, based on the
+//           blocked kernel by Tim Mattson and Simon McIntosh-Smith
+//
+//  LICENSE: This work is licensed under the Creative Commons
+//           Attribution 4.0 International License.
+//           To view a copy of this license, visit
+//           http://creativecommons.org/licenses/by/4.0/
+//           or send a letter to:
+//              Creative Commons,
+//              444 Castro Street, Suite 900,
+//              Mountain View, California, 94041, USA.
+//
+//-------------------------------------------------------------
+
+// Block and micro-tile sizes.  The host passes these with -D
+// when it builds the program so that the NDRange and local
+// memory sizes it uses always agree with the kernel.  WPTM and
+// WPTN must be multiples of 4 (the float4 width) and TSK must
+// be a multiple of 4 too.
+#ifndef TSM
+#define TSM  64        // rows of C per work-group
+#endif
+#ifndef TSN
+#define TSN  64        // columns of C per work-group
+#endif
+#ifndef TSK
+#define TSK  16        // depth of each A and B block
+#endif
+#ifndef WPTM
+#define WPTM 4         // rows of C per work-item
+#endif
+#ifndef WPTN
+#define WPTN 4         // columns of C per work-item
+#endif
+
+#define RTSM (TSM/WPTM)                      // work-items per group along M
+#define RTSN (TSN/WPTN)                      // work-items per group along N
+#define LPTA ((TSK*TSM)/(4*RTSM*RTSN))       // float4 loads of A per work-item
+#define LPTB ((TSK*TSN)/(4*RTSM*RTSN))       // float4 loads of B per work-item
+
+// Load four consecutive elements p[0..3], of which only the first
+// n are inside the matrix, padding the rest with zeros
+#ifdef EDGES
+float4 load4(__global const float* p, const int n)
+{
+    float4 v = (float4)(0.0f);
+    if (n > 0) v.x = p[0];
+    if (n > 1) v.y = p[1];
+    if (n > 2) v.z = p[2];
+    if (n > 3) v.w = p[3];
+    return v;
+}
+#define LOAD4(p, n) load4((p), (n))
+#else
+#define LOAD4(p, n) vload4(0, (p))
+#endif
+
+// Epilogue applied to the micro-tile in registers before it is
+// stored, as in C_block_form.cl (see epilogue.hpp on the host):
+//
+//   -DEPI_SCALE     x = scale * x
+//   -DEPI_BIAS      x = x + bias[col]          bias has N elements
+//   -DEPI_RELU      x = max(x, 0)
+//   -DEPI_GELU      x = gelu(x), tanh approximation
+//   -DEPI_RESIDUAL  x = x + R[row*N + col]     R is M x N
+//
+// in that order, each with an operand adding an argument after the
+// local blocks.
+#ifdef EPI_SCALE
+#define EPI_SCALE_ARG , const float epi_scale
+#else
+#define EPI_SCALE_ARG
+#endif
+#ifdef EPI_BIAS
+#define EPI_BIAS_ARG , __global const float* restrict epi_bias
+#else
+#define EPI_BIAS_ARG
+#endif
+#ifdef EPI_RESIDUAL
+#define EPI_RES_ARG , __global const float* restrict epi_res
+#else
+#define EPI_RES_ARG
+#endif
+
+#ifdef EPI_GELU
+float4 gelu(float4 x)
+{
+    return 0.5f * x * (1.0f + tanh(0.7978845608f * (x + 0.044715f * x*x*x)));
+}
+#endif
+
+__kernel void mmul(
+                const int                      M,
+                const int                      N,
+                const int                      K,
+                __global const float* restrict A,
+                __global const float* restrict B,
+                __global       float* restrict C,
+                __local        float* restrict Awrk,
+                __local        float* restrict Bwrk
+                EPI_SCALE_ARG EPI_BIAS_ARG EPI_RES_ARG)
+{
+    int k, kBase, l, wm, wn;
+
+    // This work-item computes the micro-tile at (tidm, tidn)
+    // of the block C(get_group_id(1), get_group_id(0))
+    const int tidn = get_local_id(0);
+    const int tidm = get_local_id(1);
+    const int tid  = tidm*RTSN + tidn;
+
+    const int rowBase = get_group_id(1)*TSM;
+    const int colBase = get_group_id(0)*TSN;
+
+    // The micro-tile of C lives in registers; each row of it
+    // is held as WPTN/4 float4 vectors
+    float4 Cacc[WPTM][WPTN/4];
+    for (wm = 0; wm < WPTM; wm++)
+        for (wn = 0; wn < WPTN/4; wn++)
+            Cacc[wm][wn] = (float4)(0.0f);
+
+    // C(block) = (sum over kBase) A(rowBase, kBase) * B(kBase, colBase)
+    for (kBase = 0; kBase < K; kBase += TSK)
+    {
+        // Load A(rowBase:rowBase+TSM, kBase:kBase+TSK) with float4
+        // reads along k and store it transposed in Awrk
+        for (l = 0; l < LPTA; l++)
+        {
+            const int id  = l*RTSM*RTSN + tid;
+            const int row = id / (TSK/4);
+            const int kq  = (id % (TSK/4)) * 4;
+#ifdef EDGES
+            const float4 a = (rowBase+row < M)
+                ? load4(A + (rowBase+row)*K + kBase + kq, K - kBase - kq)
+                : (float4)(0.0f);
+#else
+            const float4 a = vload4(0, A + (rowBase+row)*K + kBase + kq);
+#endif
+            Awrk[(kq+0)*TSM + row] = a.x;
+            Awrk[(kq+1)*TSM + row] = a.y;
+            Awrk[(kq+2)*TSM + row] = a.z;
+            Awrk[(kq+3)*TSM + row] = a.w;
+        }
+
+        // Load B(kBase:kBase+TSK, colBase:colBase+TSN) with float4
+        // reads along the rows of B
+        for (l = 0; l < LPTB; l++)
+        {
+            const int id  = l*RTSM*RTSN + tid;
+            const int kk  = id / (TSN/4);
+            const int col = (id % (TSN/4)) * 4;
+#ifdef EDGES
+            const float4 b = (kBase+kk < K)
+                ? load4(B + (kBase+kk)*N + colBase + col, N - colBase - col)
+                : (float4)(0.0f);
+#else
+            const float4 b = vload4(0, B + (kBase+kk)*N + colBase + col);
+#endif
+            vstore4(b, 0, Bwrk + kk*TSN + col);
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        // Accumulate the contribution of this block into the
+        // micro-tile.  Every value read from local memory is
+        // used WPTM or WPTN times.
+        #pragma unroll
+        for (k = 0; k < TSK; k++)
+        {
+            float4 Breg[WPTN/4];
+            for (wn = 0; wn < WPTN/4; wn++)
+                Breg[wn] = vload4(0, Bwrk + k*TSN + tidn*WPTN + 4*wn);
+
+            for (wm = 0; wm < WPTM; wm += 4)
+            {
+                const float4 Areg = vload4(0, Awrk + k*TSM + tidm*WPTM + wm);
+                for (wn = 0; wn < WPTN/4; wn++)
+                {
+                    Cacc[wm+0][wn] = mad((float4)(Areg.x), Breg[wn], Cacc[wm+0][wn]);
+                    Cacc[wm+1][wn] = mad((float4)(Areg.y), Breg[wn], Cacc[wm+1][wn]);
+                    Cacc[wm+2][wn] = mad((float4)(Areg.z), Breg[wn], Cacc[wm+2][wn]);
+                    Cacc[wm+3][wn] = mad((float4)(Areg.w), Breg[wn], Cacc[wm+3][wn]);
+                }
+            }
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    // apply the epilogue and update global C matrix, one float4
+    // store per vector
+    for (wm = 0; wm < WPTM; wm++)
+    {
+        const int row = rowBase + tidm*WPTM + wm;
+#ifdef EDGES
+        if (row >= M)
+            break;
+#endif
+        for (wn = 0; wn < WPTN/4; wn++)
+        {
+            const int col = colBase + tidn*WPTN + 4*wn;
+            float4 c = Cacc[wm][wn];
+#ifdef EPI_SCALE
+            c *= epi_scale;
+#endif
+#ifdef EPI_BIAS
+            c += LOAD4(epi_bias + col, N - col);
+#endif
+#ifdef EPI_RELU
+            c = fmax(c, 0.0f);
+#endif
+#ifdef EPI_GELU
+            c = gelu(c);
+#endif
+#ifdef EPI_RESIDUAL
+            c += LOAD4(epi_res + row*N + col, N - col);
+#endif
+#ifdef EDGES
+            if (col+0 < N) C[row*N + col+0] = c.x;
+            if (col+1 < N) C[row*N + col+1] = c.y;
+            if (col+2 < N) C[row*N + col+2] = c.z;
+            if (col+3 < N) C[row*N + col+3] = c.w;
+#else
+            vstore4(c, 0, C + row*N + col);
+#endif
+        }
+    }
+}
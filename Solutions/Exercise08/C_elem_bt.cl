@@ -0,0 +1,27 @@
+// C(i,j) per work-item with B transposed: Bt is N x K, so
+// C(i,j) is the dot product of row i of A and row j of Bt and
+// both are read contiguously, four elements at a time.
+__kernel void mmul(
+    const int M,
+    const int N,
+    const int K,
+    __global float* A,
+    __global float* Bt,
+    __global float* C)
+{
+    int k;
+    int i = get_global_id(0);
+    int j = get_global_id(1);
+    float4 acc;
+    float tmp;
+    if ((i < M) && (j < N))
+    {
+        acc = (float4)(0.0f);
+        for (k = 0; k + 4 <= K; k += 4)
+            acc += vload4(0, A + i*K+k) * vload4(0, Bt + j*K+k);
+        tmp = acc.x + acc.y + acc.z + acc.w;
+        for (; k < K; k++)
+            tmp += A[i*K+k] * Bt[j*K+k];
+        C[i*N+j] = tmp;
+    }
+}
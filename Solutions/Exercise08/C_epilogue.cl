@@ -0,0 +1,61 @@
+//------------------------------------------------------------------------------
+//
+// kernels: scale_pass, bias_pass, relu_pass, gelu_pass, residual_pass
+//
+// Purpose: The element-wise operations of the fused epilogues (see
+//          C_block_form.cl) as separate passes over an M x N matrix C,
+//          one work-item per element, like the vadd kernels of
+//          Exercises 4 and 5.  Each pass reads and writes all of C, which
+//          is the traffic a fused epilogue saves.
+//
+
+__kernel void scale_pass(
+   const int count,
+   const float s,
+   __global float* C)
+{
+   int i = get_global_id(0);
+   if (i < count)
+      C[i] = s * C[i];
+}
+
+__kernel void bias_pass(
+   const int count,
+   const int N,
+   __global const float* bias,
+   __global float* C)
+{
+   int i = get_global_id(0);
+   if (i < count)
+      C[i] = C[i] + bias[i % N];
+}
+
+__kernel void relu_pass(
+   const int count,
+   __global float* C)
+{
+   int i = get_global_id(0);
+   if (i < count)
+      C[i] = fmax(C[i], 0.0f);
+}
+
+__kernel void gelu_pass(
+   const int count,
+   __global float* C)
+{
+   int i = get_global_id(0);
+   if (i < count) {
+      const float x = C[i];
+      C[i] = 0.5f * x * (1.0f + tanh(0.7978845608f * (x + 0.044715f * x*x*x)));
+   }
+}
+
+__kernel void residual_pass(
+   const int count,
+   __global const float* R,
+   __global float* C)
+{
+   int i = get_global_id(0);
+   if (i < count)
+      C[i] = C[i] + R[i];
+}
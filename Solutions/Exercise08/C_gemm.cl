@@ -0,0 +1,152 @@
+//-------------------------------------------------------------
+//
+//  PROGRAM: General matrix multiplication kernel (BLAS GEMM)
+//
+//  PURPOSE: Computes
+//
+//              C = alpha * op(A) * op(B) + beta * C
+//
+//           where op(X) is X or its transpose, for row major
+//           matrices with leading dimensions and offsets into
+//           their buffers.  This is the kernel behind sgemm and
+//           dgemm (see gemm.cpp); column major calls are turned
+//           into row major ones by the host.
+//
+//           op(A) is M x K, op(B) is K x N and C is M x N.
+//           Element (i,j) of a stored matrix X is at
+//           X[offX + i*ldX + j], so a transposed operand is
+//           stored K x M (A) or N x K (B).
+//
+//           A work-group computes a TS x TS block of C with
+//           TS x TS/WPT work-items, each computing WPT elements
+//           of one column of the block spaced TS/WPT rows apart.
+//           The blocks of op(A) and op(B) are staged in local
+//           memory.  They are always read from global memory
+//           with consecutive work-items on consecutive addresses:
+//           a transposed operand is read along its stored rows
+//           and written into the local block transposed.
+//
+//           As in BLAS, C is not read when beta is zero, and A
+//           and B are not read when alpha is zero (the host
+//           passes K = 0).
+//
+//  HISTORY: Written for the Exercise 8 solutions, based on the
+//           blocked kernel by Tim Mattson and Simon McIntosh-Smith
+//
+//  LICENSE: This work is licensed under the Creative Commons
+//           Attribution 4.0 International License.
+//           To view a copy of this license, visit
+//           http://creativecommons.org/licenses/by/4.0/
+//           or send a letter to:
+//              Creative Commons,
+//              444 Castro Street, Suite 900,
+//              Mountain View, California, 94041, USA.
+//
+//-------------------------------------------------------------
+
+// Block size and elements of C per work-item, passed by the
+// host with -D.  WPT must divide TS.
+#ifndef TS
+#define TS  32
+#endif
+#ifndef WPT
+#define WPT 4
+#endif
+
+#define RTS (TS/WPT)        // work-items per group along M
+
+// -DPREC_DOUBLE for dgemm (needs cl_khr_fp64), float otherwise
+#ifdef PREC_DOUBLE
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+typedef double real_t;
+#else
+typedef float  real_t;
+#endif
+
+// -DTRANS_A and -DTRANS_B select op(A) = A' and op(B) = B'
+__kernel void gemm(
+                const int                      M,
+                const int                      N,
+                const int                      K,
+                const real_t                   alpha,
+                __global const real_t* restrict A,
+                const int                      offA,
+                const int                      lda,
+                __global const real_t* restrict B,
+                const int                      offB,
+                const int                      ldb,
+                const real_t                   beta,
+                __global       real_t* restrict C,
+                const int                      offC,
+                const int                      ldc,
+                __local        real_t* restrict Awrk,
+                __local        real_t* restrict Bwrk)
+{
+    int k, kBase, w;
+
+    const int tx = get_local_id(0);     // column of C in the block
+    const int ty = get_local_id(1);     // first row of C in the block
+
+    const int rowBase = get_group_id(1)*TS;
+    const int colBase = get_group_id(0)*TS;
+    const int col     = colBase + tx;
+
+    A += offA;
+    B += offB;
+    C += offC;
+
+    real_t acc[WPT];
+    for (w = 0; w < WPT; w++)
+        acc[w] = 0;
+
+    // Awrk holds op(A)(rowBase.., kBase..) and Bwrk holds
+    // op(B)(kBase.., colBase..), both row major TS x TS
+    for (kBase = 0; kBase < K; kBase += TS)
+    {
+        for (w = 0; w < WPT; w++)
+        {
+            const int r = ty + w*RTS;
+#ifdef TRANS_A
+            // A' element (rowBase+tx, kBase+r) is A(kBase+r, rowBase+tx)
+            Awrk[tx*TS + r] = (kBase+r < K && rowBase+tx < M)
+                ? A[(kBase+r)*lda + rowBase+tx] : 0;
+#else
+            Awrk[r*TS + tx] = (rowBase+r < M && kBase+tx < K)
+                ? A[(rowBase+r)*lda + kBase+tx] : 0;
+#endif
+#ifdef TRANS_B
+            // B' element (kBase+tx, colBase+r) is B(colBase+r, kBase+tx)
+            Bwrk[tx*TS + r] = (colBase+r < N && kBase+tx < K)
+                ? B[(colBase+r)*ldb + kBase+tx] : 0;
+#else
+            Bwrk[r*TS + tx] = (kBase+r < K && col < N)
+                ? B[(kBase+r)*ldb + col] : 0;
+#endif
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        #pragma unroll
+        for (k = 0; k < TS; k++)
+        {
+            const real_t b = Bwrk[k*TS + tx];
+            for (w = 0; w < WPT; w++)
+                acc[w] = mad(Awrk[(ty + w*RTS)*TS + k], b, acc[w]);
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (col < N)
+    {
+        for (w = 0; w < WPT; w++)
+        {
+            const int row = rowBase + ty + w*RTS;
+            if (row < M)
+            {
+                __global real_t* c = C + row*ldc + col;
+                *c = (beta == 0) ? alpha*acc[w] : alpha*acc[w] + beta*(*c);
+            }
+        }
+    }
+}
@@ -0,0 +1,174 @@
+//------------------------------------------------------------------------------
+//
+// kernels: gemv_rows, gemv_cols
+//
+// Purpose: Matrix-vector products
+//
+//             y = alpha * A * x + beta * y
+//
+//          for a batch of independent A (M x N), x and y, the batch being
+//          the third dimension of the NDRange.  Each product reads A once
+//          and does two flops per element, so they are bound by memory
+//          bandwidth: the kernels read A with float4 loads, in the order
+//          it is stored.
+//
+//          gemv_rows is for an A stored as M rows of N elements (row major
+//          A, or a column major A transposed).  A work-group takes a block
+//          of GEMV_ROWS rows, GEMV_LANES work-items to a row striding along
+//          it, and adds up each row's partial sums in local memory, like
+//          the reduction of the pi kernels of Exercise 9.
+//
+//          gemv_cols is for an A stored as N columns of M elements (column
+//          major A, or a row major A transposed), where a dot product per
+//          work-item would read A across its storage.  A work-item
+//          instead computes 4 consecutive elements of y from a float4 of
+//          each column, so neighbouring work-items read neighbouring
+//          float4s.  The columns are shared among GEMV_CY work-items per
+//          element, whose sums are added in local memory.
+//
+//          The offsets are those of the first matrix and vectors in
+//          their buffers, lda is the distance between the stored rows
+//          (gemv_rows) or columns (gemv_cols), and the strides are the
+//          distances between the matrices and vectors of a batch, all in
+//          elements.  y is not read when beta is zero.  GEMV_LANES and
+//          GEMV_CY are powers of two.
+//
+// NDRange: gemv_rows  (GEMV_LANES, M rounded up to GEMV_ROWS, batch),
+//                     local (GEMV_LANES, GEMV_ROWS, 1)
+//          gemv_cols  (M/4 rounded up to GEMV_CX, GEMV_CY, batch),
+//                     local (GEMV_CX, GEMV_CY, 1)
+//
+
+#ifndef GEMV_LANES
+#define GEMV_LANES 32
+#endif
+#ifndef GEMV_ROWS
+#define GEMV_ROWS 4
+#endif
+#ifndef GEMV_CX
+#define GEMV_CX 32
+#endif
+#ifndef GEMV_CY
+#define GEMV_CY 4
+#endif
+
+__kernel void gemv_rows(
+   const int M,
+   const int N,
+   const float alpha,
+   __global const float* restrict A,
+   const int offA,
+   const int lda,
+   const int strideA,
+   __global const float* restrict x,
+   const int offX,
+   const int strideX,
+   const float beta,
+   __global float* restrict y,
+   const int offY,
+   const int strideY,
+   __local float* restrict part)        // GEMV_ROWS * GEMV_LANES
+{
+   const int lane = get_local_id(0);
+   const int r    = get_local_id(1);
+   const int i    = get_group_id(1)*GEMV_ROWS + r;
+   const int b    = get_global_id(2);
+
+   A += offA + b*strideA;
+   x += offX + b*strideX;
+   y += offY + b*strideY;
+
+   // This work-item's share of row i: every GEMV_LANES-th float4,
+   // then the elements after the last whole float4
+   float sum = 0.0f;
+   if (i < M) {
+      __global const float* row = A + i*lda;
+      const int N4 = N/4;
+      float4 acc = (float4)(0.0f);
+      for (int c = lane; c < N4; c += GEMV_LANES)
+         acc += vload4(c, row) * vload4(c, x);
+      sum = (acc.x + acc.y) + (acc.z + acc.w);
+      for (int j = 4*N4 + lane; j < N; j += GEMV_LANES)
+         sum += row[j] * x[j];
+   }
+
+   // Add up the shares of each row
+   __local float* p = part + r*GEMV_LANES;
+   p[lane] = sum;
+   barrier(CLK_LOCAL_MEM_FENCE);
+   for (int s = GEMV_LANES/2; s > 0; s /= 2) {
+      if (lane < s)
+         p[lane] += p[lane + s];
+      barrier(CLK_LOCAL_MEM_FENCE);
+   }
+
+   if (lane == 0 && i < M)
+      y[i] = alpha * p[0] + (beta == 0.0f ? 0.0f : beta * y[i]);
+}
+
+__kernel void gemv_cols(
+   const int M,
+   const int N,
+   const float alpha,
+   __global const float* restrict A,
+   const int offA,
+   const int lda,
+   const int strideA,
+   __global const float* restrict x,
+   const int offX,
+   const int strideX,
+   const float beta,
+   __global float* restrict y,
+   const int offY,
+   const int strideY,
+   __local float4* restrict part)       // GEMV_CY * GEMV_CX
+{
+   const int lx = get_local_id(0);
+   const int ly = get_local_id(1);
+   const int i  = 4*get_global_id(0);   // first of the 4 elements of y
+   const int b  = get_global_id(2);
+
+   A += offA + b*strideA;
+   x += offX + b*strideX;
+   y += offY + b*strideY;
+
+   // Every GEMV_CY-th column, from this work-item's first one
+   float4 acc = (float4)(0.0f);
+   if (i + 4 <= M) {
+      for (int j = ly; j < N; j += GEMV_CY)
+         acc += vload4(0, A + j*lda + i) * x[j];
+   }
+   else if (i < M) {
+      // The last, partial float4 of each column
+      for (int j = ly; j < N; j += GEMV_CY) {
+         __global const float* col = A + j*lda + i;
+         acc.x += col[0] * x[j];
+         if (i + 1 < M) acc.y += col[1] * x[j];
+         if (i + 2 < M) acc.z += col[2] * x[j];
+      }
+   }
+
+   // Add up the sums over the slices of the columns
+   part[ly*GEMV_CX + lx] = acc;
+   barrier(CLK_LOCAL_MEM_FENCE);
+   for (int s = GEMV_CY/2; s > 0; s /= 2) {
+      if (ly < s)
+         part[ly*GEMV_CX + lx] += part[(ly + s)*GEMV_CX + lx];
+      barrier(CLK_LOCAL_MEM_FENCE);
+   }
+
+   if (ly == 0) {
+      const float4 sum = part[lx];
+      if (i + 4 <= M) {
+         const float4 old = (beta == 0.0f) ? (float4)(0.0f) : beta * vload4(0, y + i);
+         vstore4(alpha * sum + old, 0, y + i);
+      }
+      else if (i < M) {
+         y[i] = alpha * sum.x + (beta == 0.0f ? 0.0f : beta * y[i]);
+         if (i + 1 < M)
+            y[i+1] = alpha * sum.y + (beta == 0.0f ? 0.0f : beta * y[i+1]);
+         if (i + 2 < M)
+            y[i+2] = alpha * sum.z + (beta == 0.0f ? 0.0f : beta * y[i+2]);
+      }
+   }
+}
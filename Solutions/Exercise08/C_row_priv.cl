@@ -1,23 +1,35 @@
 
+// The row of A is copied into private memory PRIV_K elements at a
+// time.  If K is larger than that, the rows of C are accumulated
+// over several chunks of A.
+#ifndef PRIV_K
+#define PRIV_K 1024
+#endif
+
 __kernel void mmul(
+    const int M,
     const int N,
+    const int K,
     __global float* A,
     __global float* B,
     __global float* C)
 {
-    int k, j;
+    int k, j, kb, kn;
     int i = get_global_id(0);
-    float Awrk[1024];
+    float Awrk[PRIV_K];
     float tmp;
-    if (i < N) {
-        for (k = 0; k < N; k++)
-            Awrk[k] = A[i*N+k];
+    if (i < M) {
+        for (kb = 0; kb < K; kb += PRIV_K) {
+            kn = min(PRIV_K, K - kb);
+            for (k = 0; k < kn; k++)
+                Awrk[k] = A[i*K+kb+k];
 
-        for (j = 0; j < N; j++) {
-            tmp = 0.0f;
-            for (k = 0; k < N; k++)
-                tmp += Awrk[k] * B[k*N+j];
-            C[i*N+j] = tmp;
+            for (j = 0; j < N; j++) {
+                tmp = (kb == 0) ? 0.0f : C[i*N+j];
+                for (k = 0; k < kn; k++)
+                    tmp += Awrk[k] * B[(kb+k)*N+j];
+                C[i*N+j] = tmp;
+            }
         }
     }
 }
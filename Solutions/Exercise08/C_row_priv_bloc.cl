@@ -1,30 +1,46 @@
 
+// The row of A is copied into private memory, and each column of
+// B into local memory, PRIV_K elements at a time.  If K is larger
+// than that, the rows of C are accumulated over several chunks.
+#ifndef PRIV_K
+#define PRIV_K 1024
+#endif
+
 __kernel void mmul(
+    const int M,
     const int N,
+    const int K,
     __global float* A,
     __global float* B,
     __global float* C,
     __local float* Bwrk)
 {
-    int k, j;
+    int k, j, kb, kn;
     int i    = get_global_id(0);
     int iloc = get_local_id(0);
     int nloc = get_local_size(0);
-    float Awrk[1024];
+    float Awrk[PRIV_K];
     float tmp;
-    if (i < N) {
-        for (k = 0; k < N; k++)
-            Awrk[k] = A[i*N+k];
+
+    // Every work-item must reach the barriers, so work-items past
+    // the last row of C help load B but skip the rest
+    for (kb = 0; kb < K; kb += PRIV_K) {
+        kn = min(PRIV_K, K - kb);
+        if (i < M)
+            for (k = 0; k < kn; k++)
+                Awrk[k] = A[i*K+kb+k];
 
         for (j = 0; j < N; j++) {
             barrier(CLK_LOCAL_MEM_FENCE);
-            for (k = iloc; k < N; k += nloc)
-                Bwrk[k] = B[k*N+j];
+            for (k = iloc; k < kn; k += nloc)
+                Bwrk[k] = B[(kb+k)*N+j];
             barrier(CLK_LOCAL_MEM_FENCE);
-            tmp = 0.0f;
-            for (k = 0; k < N; k++)
-                tmp += Awrk[k] * Bwrk[k];
-            C[i*N+j] = tmp;
+            if (i < M) {
+                tmp = (kb == 0) ? 0.0f : C[i*N+j];
+                for (k = 0; k < kn; k++)
+                    tmp += Awrk[k] * Bwrk[k];
+                C[i*N+j] = tmp;
+            }
             barrier(CLK_LOCAL_MEM_FENCE);
         }
     }
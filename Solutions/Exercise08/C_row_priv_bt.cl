@@ -0,0 +1,36 @@
+// C row per work-item, A row in private memory, with B
+// transposed: Bt is N x K, so C(i,j) reads row j of Bt
+// contiguously instead of a column of B with a stride of N.
+// The row of A is copied into private memory PRIV_K elements
+// at a time, as in C_row_priv.cl.
+#ifndef PRIV_K
+#define PRIV_K 1024
+#endif
+
+__kernel void mmul(
+    const int M,
+    const int N,
+    const int K,
+    __global float* A,
+    __global float* Bt,
+    __global float* C)
+{
+    int k, j, kb, kn;
+    int i = get_global_id(0);
+    float Awrk[PRIV_K];
+    float tmp;
+    if (i < M) {
+        for (kb = 0; kb < K; kb += PRIV_K) {
+            kn = min(PRIV_K, K - kb);
+            for (k = 0; k < kn; k++)
+                Awrk[k] = A[i*K+kb+k];
+
+            for (j = 0; j < N; j++) {
+                tmp = (kb == 0) ? 0.0f : C[i*N+j];
+                for (k = 0; k < kn; k++)
+                    tmp += Awrk[k] * Bt[j*K+kb+k];
+                C[i*N+j] = tmp;
+            }
+        }
+    }
+}
@@ -0,0 +1,139 @@
+//-------------------------------------------------------------
+//
+//  PROGRAM: Split-K Matrix Multipliplication kernels
+//
+//  PURPOSE: Computes the product matrix
+//
+//              C = A * B
+//
+//           for shapes where C is too small to keep the device
+//           busy, such as a 64 x 64 C with K in the millions.
+//           The blocked kernel (C_block_form.cl) gives each
+//           work-group one block of C, so such a C is only a
+//           handful of work-groups however large K is.
+//
+//           Here K is also cut into slices of kchunk (a multiple
+//           of blksz).  mmul_partial runs the blocked algorithm of
+//           C_block_form.cl over one slice of K per work-group,
+//           with the slice as the third dimension of the NDRange,
+//           and writes its partial block to P:
+//
+//              P[s] = A(:, slice s) * B(slice s, :)
+//
+//           reduce_partial then adds the partial products of
+//           every slice into C, one work-item per element.  The
+//           sum is in the same order every run, unlike adding
+//           the partials to C with atomics.
+//
+//           Indices follow C_block_form.cl:
+//
+//             i,j,k            ... indices of full, global matrices
+//             Iblk, Jblk, Kblk ... indices of matrix blocks
+//             iloc, jloc, kloc ... indices inside blocks
+//
+//           The host passes -Dblksz and, when M, N or K is not a
+//           multiple of blksz, -DEDGES as for C_block_form.cl.
+//           P holds slices * M * N floats.
+//
+//  HISTORY: Written for the Exercise 8 solutions, based on the
+//           blocked kernel by Tim Mattson and Simon McIntosh-Smith
+//
+//  LICENSE: This work is licensed under the Creative Commons
+//           Attribution 4.0 International License.
+//           To view a copy of this license, visit
+//           http://creativecommons.org/licenses/by/4.0/
+//           or send a letter to:
+//              Creative Commons,
+//              444 Castro Street, Suite 900,
+//              Mountain View, California, 94041, USA.
+//
+//-------------------------------------------------------------
+
+#ifndef blksz
+#define blksz 16
+#endif
+
+#ifdef EDGES
+#define LOAD(cond, val) ((cond) ? (val) : 0.0f)
+#else
+#define LOAD(cond, val) (val)
+#endif
+
+__kernel void mmul_partial(
+                const int                      M,
+                const int                      N,
+                const int                      K,
+                const int                      kchunk,
+                __global const float* restrict A,
+                __global const float* restrict B,
+                __global       float* restrict P,
+                __local        float* restrict Awrk,
+                __local        float* restrict Bwrk)
+{
+    int kloc, Kblk;
+    float Ctmp = 0.0f;
+
+    //  This work-item will compute slice s of element C(j,i)
+    const int i = get_global_id(0);
+    const int j = get_global_id(1);
+    const int s = get_global_id(2);
+
+    const int Iblk = get_group_id(0);
+    const int Jblk = get_group_id(1);
+
+    const int iloc = get_local_id(0);
+    const int jloc = get_local_id(1);
+
+    // The blocks along K in this slice (a partial block at the
+    // end of K is only possible with EDGES)
+    const int kstart = s*kchunk;
+    const int First  = kstart/blksz;
+    const int Last   = (min(K, kstart+kchunk)+blksz-1)/blksz;
+
+    // Base addresses of the first A and B blocks of the slice
+          int Abase = Jblk*K*blksz + kstart;
+    const int Ainc  = blksz;
+
+          int Bbase = kstart*N + Iblk*blksz;
+    const int Binc  = blksz*N;
+
+    for (Kblk = First; Kblk < Last; Kblk++)
+    {
+       Awrk[jloc*blksz+iloc] = LOAD(j < M && Kblk*blksz+iloc < K,
+                                    A[Abase+jloc*K+iloc]);
+       Bwrk[jloc*blksz+iloc] = LOAD(Kblk*blksz+jloc < K && i < N,
+                                    B[Bbase+jloc*N+iloc]);
+
+       barrier(CLK_LOCAL_MEM_FENCE);
+
+       #pragma unroll
+       for (kloc=0; kloc<blksz; kloc++)
+          Ctmp += Awrk[jloc*blksz+kloc] * Bwrk[kloc*blksz+iloc];
+
+       barrier(CLK_LOCAL_MEM_FENCE);
+       Abase += Ainc;
+       Bbase += Binc;
+    }
+
+    // the partial product of this slice
+#ifdef EDGES
+    if (j < M && i < N)
+#endif
+       P[(s*M + j)*N + i] = Ctmp;
+}
+
+__kernel void reduce_partial(
+                const int                      count,
+                const int                      slices,
+                __global const float* restrict P,
+                __global       float* restrict C)
+{
+    const int i = get_global_id(0);
+    if (i < count)
+    {
+       float sum = 0.0f;
+       for (int s = 0; s < slices; s++)
+          sum += P[s*count + i];
+       C[i] = sum;
+    }
+}
@@ -0,0 +1,23 @@
+// Sparse times dense product C = A * B, A (M x K) in CSR form
+// (see C_spmv_csr.cl) and B (K x N) and C (M x N) dense and row
+// major.  Work-item (j, i) computes C[i][j] from the nonzeros of
+// row i of A.  Work-items of a row of C share those nonzeros and
+// read consecutive elements of each row of B they select.
+__kernel void spmm_csr(
+    const int M,
+    const int N,
+    __global const int* row_ptr,
+    __global const int* col,
+    __global const float* val,
+    __global const float* B,
+    __global float* C)
+{
+    int j = get_global_id(0);
+    int i = get_global_id(1);
+    if (i < M && j < N) {
+        float sum = 0.0f;
+        for (int k = row_ptr[i]; k < row_ptr[i+1]; k++)
+            sum += val[k] * B[col[k]*N + j];
+        C[i*N + j] = sum;
+    }
+}
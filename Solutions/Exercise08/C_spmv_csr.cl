@@ -0,0 +1,66 @@
+// Sparse matrix-vector products y = A * x with A in CSR form:
+// the nonzeros of row i are val[row_ptr[i] .. row_ptr[i+1]-1],
+// in the columns col[...] of the same range.
+//
+// spmv_csr_scalar gives each row to one work-item.  It is the
+// simplest and suits short rows, but neighbouring work-items
+// read far apart parts of val and col.
+//
+// spmv_csr_vector gives each row to VEC consecutive work-items,
+// which read consecutive nonzeros of the row and then add their
+// partial sums in local memory.  It suits rows with at least a
+// few dozen nonzeros.  The work-group size must be a multiple of
+// VEC (the host picks VEC from the mean row length).
+#ifndef VEC
+#define VEC 8
+#endif
+
+__kernel void spmv_csr_scalar(
+    const int rows,
+    __global const int* row_ptr,
+    __global const int* col,
+    __global const float* val,
+    __global const float* x,
+    __global float* y)
+{
+    int i = get_global_id(0);
+    if (i < rows) {
+        float sum = 0.0f;
+        for (int k = row_ptr[i]; k < row_ptr[i+1]; k++)
+            sum += val[k] * x[col[k]];
+        y[i] = sum;
+    }
+}
+
+__kernel void spmv_csr_vector(
+    const int rows,
+    __global const int* row_ptr,
+    __global const int* col,
+    __global const float* val,
+    __global const float* x,
+    __global float* y,
+    __local float* partial)
+{
+    int lid  = get_local_id(0);
+    int row  = get_global_id(0) / VEC;
+    int lane = lid % VEC;
+
+    float sum = 0.0f;
+    if (row < rows) {
+        for (int k = row_ptr[row] + lane; k < row_ptr[row+1]; k += VEC)
+            sum += val[k] * x[col[k]];
+    }
+    partial[lid] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // Tree reduction within each group of VEC work-items; every
+    // work-item takes part so all of them reach the barriers
+    for (int s = VEC/2; s > 0; s >>= 1) {
+        if (lane < s)
+            partial[lid] += partial[lid + s];
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (row < rows && lane == 0)
+        y[row] = partial[lid];
+}
@@ -0,0 +1,33 @@
+// Sparse matrix-vector product y = A * x with A in SELL-C-sigma
+// form.  The rows are sorted by length within windows of sigma
+// rows and cut into slices of c rows.  Each slice is padded to
+// its longest row and stored column by column, so work-item r
+// (row r of the sorted order) reads element j of its row at
+//
+//     slice_ptr[s] + j*c + r%c          s = r/c
+//
+// and consecutive work-items read consecutive addresses.  Padding
+// has val 0 and col 0.  perm[r] is the original row.  ELLPACK is
+// the case c = rows, sigma = 1: one slice padded to the longest
+// row of the matrix.
+__kernel void spmv_sell(
+    const int rows,
+    const int c,
+    __global const int* slice_ptr,
+    __global const int* slice_len,
+    __global const int* col,
+    __global const float* val,
+    __global const int* perm,
+    __global const float* x,
+    __global float* y)
+{
+    int r = get_global_id(0);
+    if (r < rows) {
+        int s = r / c;
+        int k = slice_ptr[s] + r % c;
+        float sum = 0.0f;
+        for (int j = 0; j < slice_len[s]; j++, k += c)
+            sum += val[k] * x[col[k]];
+        y[perm[r]] = sum;
+    }
+}
@@ -0,0 +1,22 @@
+//------------------------------------------------------------------------------
+//
+// kernel:  stream_scale
+//
+// Purpose: Measure the sustained global memory bandwidth of the device
+//          with the STREAM scale kernel, b = s * a, on float4s so every
+//          work-item moves 32 bytes.  stream_bandwidth() (gemv.hpp) runs
+//          it for the roof of sgemv and of the Bench harness's roofline.
+//
+// bytes:   2 * 16 * count
+//
+
+__kernel void stream_scale(
+   __global const float4* a,
+   __global float4* b,
+   const float s,
+   const unsigned int count)
+{
+   int i = get_global_id(0);
+   if (i < count)
+      b[i] = s * a[i];
+}
@@ -0,0 +1,34 @@
+// Transpose in(rows, cols) into out(cols, rows) a TILE x TILE
+// tile per work-group.  The tile is read with consecutive
+// work-items on consecutive columns of in, and written back
+// with consecutive work-items on consecutive columns of out,
+// so both the reads and the writes are contiguous.  The tile
+// has a padding column (TILE+1 floats per row) so the column
+// reads from local memory do not hit the same bank.
+#ifndef TILE
+#define TILE 16
+#endif
+
+__kernel void transpose(
+    const int rows,
+    const int cols,
+    __global const float* in,
+    __global float* out,
+    __local float* tile)
+{
+    int tx = get_local_id(0);
+    int ty = get_local_id(1);
+
+    int col = get_group_id(0)*TILE + tx;
+    int row = get_group_id(1)*TILE + ty;
+    if (row < rows && col < cols)
+        tile[ty*(TILE+1) + tx] = in[row*cols + col];
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // The tile (group 1, group 0) of out
+    col = get_group_id(1)*TILE + tx;
+    row = get_group_id(0)*TILE + ty;
+    if (row < cols && col < rows)
+        out[row*rows + col] = tile[tx*(TILE+1) + ty];
+}
@@ -0,0 +1,257 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Batched matrix multiplication benchmark
+//
+//  PURPOSE: Compare two ways of computing a batch of small products
+//
+//                C[b] = A[b] * B[b]      b = 0 .. batch-1
+//
+//           on the device: looping over the batch and launching the naive
+//           kernel (C_elem.cl) once per matrix, and a single launch of the
+//           batched kernel (C_batched.cl).  Both are reported in matrices
+//           per second.
+//
+//           The matrices of each batch are padded to the device base
+//           address alignment so the naive kernel can be given one
+//           sub-buffer per matrix.  The batched kernel reads the same
+//           buffers using the padded size as its stride.
+//
+//  USAGE:   ./batch [--batch n] [--size M N K] [--device n]
+//
+//           Without --size the square sizes 8, 16, 32 and 64 are run.
+//
+//  HISTORY: Written for the Exercise 8 solutions
+//
+//------------------------------------------------------------------------------
+
+#include <cstring>
+#include <algorithm>
+
+#include "matmul.hpp"
+#include "batched.hpp"
+#include "util.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+#include "err_code.h"
+#include "device_picker.hpp"
+
+#define BATCH 4096       // default number of matrices in a batch
+
+//------------------------------------------------------------------------------
+//
+//  Function to fill a batch of matrices with small integers (so the products
+//  are exact) that differ from one matrix to the next
+//
+//------------------------------------------------------------------------------
+static void batch_init(int rows, int cols, int batch, int stride, int seed, util::aligned_vector<float>& X)
+{
+    for (int b = 0; b < batch; b++)
+        for (int i = 0; i < rows*cols; i++)
+            X[b*stride + i] = (float)((b*seed + i*(seed+2)) % 7 - 3);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the largest difference from the host product
+//
+//------------------------------------------------------------------------------
+static float batch_error(int M, int N, int K, int batch,
+    util::aligned_vector<float>& A, int strideA, util::aligned_vector<float>& B, int strideB,
+    util::aligned_vector<float>& C, int strideC)
+{
+    float err = 0.0f;
+    for (int b = 0; b < batch; b++)
+        for (int i = 0; i < M; i++)
+            for (int j = 0; j < N; j++)
+            {
+                float tmp = 0.0f;
+                for (int k = 0; k < K; k++)
+                    tmp += A[b*strideA + i*K + k] * B[b*strideB + k*N + j];
+                err = std::max(err, std::fabs(tmp - C[b*strideC + i*N + j]));
+            }
+    return err;
+}
+
+static void batch_results(const char *label, int M, int N, int K, int batch, double run_time, float err)
+{
+    printf(" %-28s %9.0f matrices/s  %8.1f MFLOPS  (%.4f seconds)\n",
+        label, batch / run_time, 2.0 * M * N * K * batch / (1000000.0 * run_time), run_time);
+    if (err > TOL)
+        printf("  Errors in multiplication: %f\n", err);
+}
+
+int main(int argc, char *argv[])
+{
+    int batch = BATCH;
+    std::vector<int> sizes;     // M, N, K of each run
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--batch"))
+        {
+            if (++i >= argc || (batch = atoi(argv[i])) < 1)
+            {
+                std::cout << "Invalid batch size\n";
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!strcmp(argv[i], "--size"))
+        {
+            int M, N, K;
+            if (i + 3 >= argc
+                || (M = atoi(argv[i+1])) < 1
+                || (N = atoi(argv[i+2])) < 1
+                || (K = atoi(argv[i+3])) < 1)
+            {
+                std::cout << "Invalid matrix sizes (try '--size M N K')\n";
+                return EXIT_FAILURE;
+            }
+            sizes.push_back(M);
+            sizes.push_back(N);
+            sizes.push_back(K);
+            i += 3;
+        }
+    }
+    if (sizes.empty())
+    {
+        for (int n = 8; n <= 64; n *= 2)
+        {
+            sizes.push_back(n);
+            sizes.push_back(n);
+            sizes.push_back(n);
+        }
+    }
+
+    util::Timer timer;
+
+    try
+    {
+        cl_uint deviceIndex = 0;
+        parseArguments(argc, argv, &deviceIndex);
+
+        // Get list of devices
+        std::vector<cl::Device> devices;
+        unsigned numDevices = getDeviceList(devices);
+
+        // Check device index in range
+        if (deviceIndex >= numDevices)
+        {
+          std::cout << "Invalid device index (try '--list')\n";
+          return EXIT_FAILURE;
+        }
+
+        cl::Device device = devices[deviceIndex];
+
+        std::string name;
+        getDeviceName(device, name);
+        std::cout << "\nUsing OpenCL device: " << name << "\n";
+
+        std::vector<cl::Device> chosen_device;
+        chosen_device.push_back(device);
+        cl::Context context(chosen_device);
+        cl::CommandQueue queue(context, device);
+
+        // The naive kernel, launched once per matrix
+        cl::Program program = util::buildProgram(context, util::kernelSource("C_elem.cl"));
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer> naive_mmul(program, "mmul");
+
+        // Sub-buffers must start on this boundary (in floats)
+        const int align = std::max(1, (int)(device.getInfo<CL_DEVICE_MEM_BASE_ADDR_ALIGN>() / (8 * sizeof(float))));
+
+        for (size_t s = 0; s < sizes.size(); s += 3)
+        {
+            const int M = sizes[s], N = sizes[s+1], K = sizes[s+2];
+            const int strideA = ROUND_UP(M*K, align);
+            const int strideB = ROUND_UP(K*N, align);
+            const int strideC = ROUND_UP(M*N, align);
+
+            printf("\n===== Batch of %d matrices, %d x %d x %d ======\n", batch, M, N, K);
+
+            util::aligned_vector<float> h_A(strideA * batch);
+            util::aligned_vector<float> h_B(strideB * batch);
+            util::aligned_vector<float> h_C(strideC * batch);
+            batch_init(M, K, batch, strideA, 3, h_A);
+            batch_init(K, N, batch, strideB, 5, h_B);
+
+            cl::Buffer d_a(context, h_A.begin(), h_A.end(), true);
+            cl::Buffer d_b(context, h_B.begin(), h_B.end(), true);
+            cl::Buffer d_c(context, h_C.begin(), h_C.end(), false);
+
+            std::vector<cl::Buffer> sub_a(batch), sub_b(batch), sub_c(batch);
+            for (int b = 0; b < batch; b++)
+            {
+                cl_buffer_region region;
+                region.size   = sizeof(float) * M*K;
+                region.origin = sizeof(float) * b*strideA;
+                sub_a[b] = d_a.createSubBuffer(CL_MEM_READ_ONLY, CL_BUFFER_CREATE_TYPE_REGION, &region);
+                region.size   = sizeof(float) * K*N;
+                region.origin = sizeof(float) * b*strideB;
+                sub_b[b] = d_b.createSubBuffer(CL_MEM_READ_ONLY, CL_BUFFER_CREATE_TYPE_REGION, &region);
+                region.size   = sizeof(float) * M*N;
+                region.origin = sizeof(float) * b*strideC;
+                sub_c[b] = d_c.createSubBuffer(CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region);
+            }
+
+            // Loop over the batch with the naive kernel (after a warm up run)
+            naive_mmul(cl::EnqueueArgs(queue, cl::NDRange(M, N)),
+                M, N, K, sub_a[0], sub_b[0], sub_c[0]);
+            queue.finish();
+
+            uint64_t start = timer.getTimeMicroseconds();
+            for (int b = 0; b < batch; b++)
+                naive_mmul(cl::EnqueueArgs(queue, cl::NDRange(M, N)),
+                    M, N, K, sub_a[b], sub_b[b], sub_c[b]);
+            queue.finish();
+            double naive_time = (timer.getTimeMicroseconds() - start) / 1.0e6;
+
+            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            batch_results("naive_mmul, one per matrix", M, N, K, batch, naive_time,
+                batch_error(M, N, K, batch, h_A, strideA, h_B, strideB, h_C, strideC));
+
+            // One launch of the batched kernel (after a warm up run, and
+            // clearing C so the naive results cannot hide any errors)
+            BatchedGemm gemm;
+            try
+            {
+                gemm = batched_build(context, device, M, N, K);
+            }
+            catch (cl::Error err)
+            {
+                if (err.err() != CL_INVALID_VALUE)
+                    throw;
+                printf(" Matrices are too big for the batched kernel\n");
+                continue;
+            }
+
+            batched_mmul(queue, gemm, batch, d_a, strideA, d_b, strideB, d_c, strideC);
+            queue.finish();
+
+            std::fill(h_C.begin(), h_C.end(), 0.0f);
+            cl::copy(queue, h_C.begin(), h_C.end(), d_c);
+
+            start = timer.getTimeMicroseconds();
+            batched_mmul(queue, gemm, batch, d_a, strideA, d_b, strideB, d_c, strideC);
+            queue.finish();
+            double batched_time = (timer.getTimeMicroseconds() - start) / 1.0e6;
+
+            char label[64];
+            sprintf(label, "batched, %d per work-group", gemm.mpg);
+            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            batch_results(label, M, N, K, batch, batched_time,
+                batch_error(M, N, K, batch, h_A, strideA, h_B, strideB, h_C, strideC));
+
+            printf(" Speedup of the batched kernel: %.1fx\n", naive_time / batched_time);
+        }
+    } catch (cl::Error err)
+    {
+        std::cout << "Exception\n";
+        std::cerr << "ERROR: "
+                  << err.what()
+                  << "("
+                  << err_code(err.err())
+                  << ")"
+                  << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Batched small-matrix multiplication
+//
+//  PURPOSE: Build and enqueue C_batched.cl for a batch of products.
+//
+//           Each work-group computes mpg whole matrices.  mpg is chosen so
+//           that a work-group has about BATCH_ELEMS elements of C to compute
+//           (so 8x8 matrices are packed 16 to a group while a 64x64 matrix
+//           gets a group of its own) and so that the slices of A and B for
+//           all of them fit comfortably in local memory.  The elements are
+//           dealt out to at most BATCH_WG work-items, each holding ept of
+//           them in registers.
+//
+//------------------------------------------------------------------------------
+
+#include <sstream>
+#include <algorithm>
+
+#include "matmul.hpp"
+#include "batched.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  Function to choose the work split for the sizes and build the kernel
+//
+//------------------------------------------------------------------------------
+BatchedGemm batched_build(cl::Context& context, cl::Device& device, int M, int N, int K)
+{
+    BatchedGemm gemm;
+    gemm.M = M;
+    gemm.N = N;
+    gemm.K = K;
+
+    const int max_wg = (int)device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const cl_ulong max_loc = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+
+    // Matrices per work-group: enough for BATCH_ELEMS elements of C, but
+    // leave at least half of local memory free so several groups fit on
+    // a compute unit
+    gemm.mpg = std::max(1, BATCH_ELEMS / (M*N));
+    while (gemm.mpg > 1 &&
+           sizeof(float) * gemm.mpg * BATCH_BK * (M + N) > max_loc / 2)
+        gemm.mpg--;
+
+    const int elems = gemm.mpg * M * N;
+    gemm.wgsize = std::min(std::min(BATCH_WG, max_wg), ROUND_UP(elems, 32));
+
+    const std::string source = util::kernelSource("C_batched.cl");
+    for (;;)
+    {
+        gemm.ept = (elems + gemm.wgsize - 1) / gemm.wgsize;
+        if (gemm.ept > BATCH_MAX_EPT ||
+            sizeof(float) * BATCH_BK * (M + N) > max_loc)
+            throw cl::Error(CL_INVALID_VALUE, "batched_build: matrices too big to batch");
+
+        std::ostringstream options;
+        options << "-DMPG=" << gemm.mpg
+                << " -DEPT=" << gemm.ept
+                << " -DBK="  << BATCH_BK;
+
+        cl::Program program = util::buildProgram(context, source, options.str());
+        gemm.kernel = cl::Kernel(program, "mmul_batched");
+
+        // A kernel holding many elements of C per work-item may not run
+        // with the work-group size we asked for; if so use smaller groups
+        const int kernel_wg = (int)gemm.kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+        if (gemm.wgsize <= kernel_wg)
+            return gemm;
+        gemm.wgsize = kernel_wg;
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue C[b] = A[b] * B[b] for b = 0 .. batch-1
+//
+//------------------------------------------------------------------------------
+void batched_mmul(cl::CommandQueue& queue, BatchedGemm& gemm, int batch,
+    cl::Buffer& A, int strideA, cl::Buffer& B, int strideB, cl::Buffer& C, int strideC)
+{
+    const int groups = (batch + gemm.mpg - 1) / gemm.mpg;
+
+    gemm.kernel.setArg(0, gemm.M);
+    gemm.kernel.setArg(1, gemm.N);
+    gemm.kernel.setArg(2, gemm.K);
+    gemm.kernel.setArg(3, batch);
+    gemm.kernel.setArg(4, A);
+    gemm.kernel.setArg(5, strideA);
+    gemm.kernel.setArg(6, B);
+    gemm.kernel.setArg(7, strideB);
+    gemm.kernel.setArg(8, C);
+    gemm.kernel.setArg(9, strideC);
+    gemm.kernel.setArg(10, cl::Local(sizeof(float) * gemm.mpg * gemm.M * BATCH_BK));
+    gemm.kernel.setArg(11, cl::Local(sizeof(float) * gemm.mpg * BATCH_BK * gemm.N));
+
+    queue.enqueueNDRangeKernel(gemm.kernel, cl::NullRange,
+        cl::NDRange(groups * gemm.wgsize), cl::NDRange(gemm.wgsize));
+}
+
+void batched_mmul(cl::CommandQueue& queue, BatchedGemm& gemm, int batch,
+    cl::Buffer& A, cl::Buffer& B, cl::Buffer& C)
+{
+    batched_mmul(queue, gemm, batch,
+        A, gemm.M * gemm.K, B, gemm.K * gemm.N, C, gemm.M * gemm.N);
+}
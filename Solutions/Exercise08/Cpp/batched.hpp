@@ -0,0 +1,55 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Batched small-matrix multiplication (function prototypes)
+//
+//  PURPOSE: Many small products C[b] = A[b] * B[b] of the same sizes are
+//           computed with a single launch of C_batched.cl instead of one
+//           launch per matrix.  batched_build picks how many matrices each
+//           work-group computes for the sizes and device, builds the kernel
+//           to match, and batched_mmul enqueues it for a batch.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __BATCHED_HDR
+#define __BATCHED_HDR
+
+//------------------------------------------------------------------------------
+//
+//  A batched kernel built for one set of matrix sizes
+//
+//------------------------------------------------------------------------------
+struct BatchedGemm
+{
+    int M, N, K;        // A[b] is M x K, B[b] is K x N and C[b] is M x N
+
+    int mpg;            // matrices per work-group
+    int ept;            // elements of C per work-item
+    int wgsize;         // work-items per work-group
+
+    cl::Kernel kernel;
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to choose the work split for the sizes and build the kernel.
+//  Throws cl::Error(CL_INVALID_VALUE) if the matrices are too big to batch
+//  (use the mmul kernels for those).
+//
+//------------------------------------------------------------------------------
+BatchedGemm batched_build(cl::Context& context, cl::Device& device, int M, int N, int K);
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue C[b] = A[b] * B[b] for b = 0 .. batch-1.  Matrix b
+//  of each buffer starts b*stride floats from the start of the buffer; a
+//  stride of 0 uses the same matrix for every product.  The version without
+//  strides is for contiguous batches.
+//
+//------------------------------------------------------------------------------
+void batched_mmul(cl::CommandQueue& queue, BatchedGemm& gemm, int batch,
+    cl::Buffer& A, int strideA, cl::Buffer& B, int strideB, cl::Buffer& C, int strideC);
+
+void batched_mmul(cl::CommandQueue& queue, BatchedGemm& gemm, int batch,
+    cl::Buffer& A, cl::Buffer& B, cl::Buffer& C);
+
+#endif
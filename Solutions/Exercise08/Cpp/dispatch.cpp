@@ -0,0 +1,628 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Matrix multiplication dispatcher
+//
+//  PURPOSE: Pick the kernel for C = A * B from a cost model of each one on
+//           the device (see dispatch.hpp) and run it.
+//
+//           The benchmark harness (Bench/Cpp) writes its results as CSV:
+//
+//             # device: <name>
+//             ...
+//             suite,variant,size,samples,min_s,median_s,...,flops,...
+//             mult,block_reg,512x512x512,10,...
+//
+//           The mult rows of a file whose device matches are the measured
+//           rates.  Kernels missing from the file keep the estimate,
+//           scaled by the lowest ratio of measured to estimated rate of
+//           the kernels that were measured.  Being pessimistic about the
+//           guesses means a measured kernel is only passed over for one
+//           that the model expects to be faster however far off it is.
+//
+//           To add a kernel: add it to the table below with its source
+//           and the fraction of peak it reaches, and give it a case in
+//           shape_factor(), feasible() and run_variant().  The benchmark
+//           reports it under the same name.
+//
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "matmul.hpp"
+#include "dispatch.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+
+enum { ELEM, ROW, ROW_PRIV, ROW_PRIV_BLOC, BLOCK, BLOCK_REG, SPLIT_K, VARIANTS };
+
+struct DispatchVariant
+{
+    const char *name;       // as reported by the benchmark
+    const char *source;
+    double cpu_eff;         // fraction of peak reached on a CPU and on a
+    double gpu_eff;         // GPU, when there are no benchmark results
+    bool   local;           // uses local memory
+};
+
+static const DispatchVariant variants[VARIANTS] =
+{
+    { "elem",          "C_elem.cl",          0.02, 0.02, false },
+    { "row",           "C_row.cl",           0.04, 0.01, false },
+    { "row_priv",      "C_row_priv.cl",      0.10, 0.03, false },
+    { "row_priv_bloc", "C_row_priv_bloc.cl", 0.08, 0.06, true  },
+    { "block",         "C_block_form.cl",    0.06, 0.20, true  },
+    { "block_reg",     "C_block_reg.cl",     0.12, 0.45, true  },
+    { "split_k",       "C_splitk.cl",        0.06, 0.20, true  },
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to strip the padding some platforms leave on device strings
+//
+//------------------------------------------------------------------------------
+static std::string trim(std::string s)
+{
+    s = s.c_str();
+    while (!s.empty() && (s[s.size()-1] == ' ' || s[s.size()-1] == '\r'))
+        s.erase(s.size()-1);
+    while (!s.empty() && s[0] == ' ')
+        s.erase(0, 1);
+    return s;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to interpolate a rate from measured ones, linearly in the log
+//  of the order, holding the end values outside the measured range
+//
+//------------------------------------------------------------------------------
+static double interpolate(const std::map<int, double>& rates, double n)
+{
+    std::map<int, double>::const_iterator hi = rates.lower_bound((int)std::ceil(n));
+    if (hi == rates.begin())
+        return hi->second;
+    if (hi == rates.end())
+        return rates.rbegin()->second;
+
+    std::map<int, double>::const_iterator lo = hi;
+    --lo;
+    const double t = std::log(n / lo->first) / std::log((double)hi->first / lo->first);
+    return lo->second + t * (hi->second - lo->second);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the block sizes the blocked kernels use for a shape
+//
+//------------------------------------------------------------------------------
+static TuneParams params_for(cl::Device& device, int M, int N, int K)
+{
+    TuneParams params = default_tune_params();
+    load_tuning(TUNE_DB, device, M, N, K, params);
+    return params;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Dispatcher
+//
+//------------------------------------------------------------------------------
+MatmulDispatcher::MatmulDispatcher(cl::Context& context, cl::Device& device,
+    const std::string& db)
+    : context_(context), device_(device), scale_(1.0), partial_size_(0)
+{
+    gpu_          = device.getInfo<CL_DEVICE_TYPE>() != CL_DEVICE_TYPE_CPU;
+    local_global_ = device.getInfo<CL_DEVICE_LOCAL_MEM_TYPE>() == CL_GLOBAL;
+    units_        = std::max(1, (int)device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>());
+    max_group_    = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    local_mem_    = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+
+    // A rough peak: a multiply-add per lane per cycle, with 64 lanes per
+    // GPU compute unit and the native float vector width (two units) per
+    // CPU core.  Only its ratio to the measured rates matters once the
+    // model is calibrated.
+    const int vec = std::max(1, (int)device.getInfo<CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT>());
+    const double lanes = gpu_ ? 64.0 : 2.0 * vec;
+    peak_ = units_ * device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>() * 1.0e-3 * 2.0 * lanes;
+    if (peak_ <= 0.0)
+        peak_ = 1.0;
+
+    calibrate(db);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Number of slices of K for split_k, and their depth in kchunk: enough
+//  for the blocks of C of every slice to fill the compute units the way
+//  shape_factor() counts it, but at most SPLITK_MAX slices and none of
+//  less than SPLITK_MIN_K
+//
+//------------------------------------------------------------------------------
+int MatmulDispatcher::split(const TuneParams& params, int M, int N, int K, int *kchunk) const
+{
+    const int b = params.blksz;
+    const double blocks = (double)((M + b - 1) / b) * ((N + b - 1) / b);
+    const double want = std::max(units_ / blocks, units_ * (gpu_ ? 256.0 : 1.0) / (blocks * b * b));
+
+    int slices = std::min(SPLITK_MAX, K / SPLITK_MIN_K);
+    slices = std::max(1, (int)std::min((double)slices, std::ceil(want)));
+
+    // Slices of whole blocks; rounding up may leave fewer of them
+    *kchunk = ROUND_UP((K + slices - 1) / slices, b);
+    return (K + *kchunk - 1) / *kchunk;
+}
+
+int MatmulDispatcher::slices(int M, int N, int K)
+{
+    int kchunk;
+    return split(params_for(device_, M, N, K), M, N, K, &kchunk);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Fraction of the kernel's full rate it reaches for a shape: the fill of
+//  the compute units times the useful part of the padded work
+//
+//------------------------------------------------------------------------------
+double MatmulDispatcher::shape_factor(int v, const TuneParams& params, int M, int N, int K) const
+{
+    double items, group, useful = 1.0;
+    switch (v)
+    {
+        case ELEM:
+            items = (double)M * N;
+            group = gpu_ ? 64.0 : 1.0;     // the runtime picks the work-group
+            break;
+        case ROW:
+            items = M;
+            group = gpu_ ? 64.0 : 1.0;
+            break;
+        case ROW_PRIV:
+        case ROW_PRIV_BLOC:
+            items = ROUND_UP(M, ROW_LOCAL);
+            group = ROW_LOCAL;
+            useful = M / items;
+            break;
+        case BLOCK:
+        {
+            const int b = params.blksz;
+            items = (double)ROUND_UP(M, b) * ROUND_UP(N, b);
+            group = b * b;
+            useful = (double)M * N * K / (items * ROUND_UP(K, b));
+            break;
+        }
+        case SPLIT_K:
+        {
+            const int b = params.blksz;
+            int kchunk;
+            const int s = split(params, M, N, K, &kchunk);
+            items = (double)ROUND_UP(M, b) * ROUND_UP(N, b) * s;
+            group = b * b;
+            useful = (double)M * N * K / (items * kchunk);
+            break;
+        }
+        default:
+        {
+            const double padded = (double)ROUND_UP(M, params.tsm) * ROUND_UP(N, params.tsn);
+            items = padded / (params.wptm * params.wptn);
+            group = (params.tsm / params.wptm) * (params.tsn / params.wptn);
+            useful = (double)M * N * K / (padded * ROUND_UP(K, params.tsk));
+            break;
+        }
+    }
+
+    // A GPU needs a few hundred work-items per compute unit to hide its
+    // memory latency, a CPU one work-group per core
+    const double groups = items / group;
+    const double fill = std::min(1.0, groups / units_)
+                      * std::min(1.0, items / (units_ * (gpu_ ? 256.0 : 1.0)));
+    return fill * useful;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Whether the device has the local memory and work-group size the kernel
+//  needs for a shape.  split_k is only offered when it splits K; with one
+//  slice it is the blocked kernel plus a copy.
+//
+//------------------------------------------------------------------------------
+bool MatmulDispatcher::feasible(int v, const TuneParams& params, int M, int N, int K) const
+{
+    size_t group = 1, local = 0;
+    switch (v)
+    {
+        case ROW_PRIV:
+            group = ROW_LOCAL;
+            break;
+        case ROW_PRIV_BLOC:
+            group = ROW_LOCAL;
+            local = sizeof(float) * std::min(K, PRIV_K);
+            break;
+        case SPLIT_K:
+        {
+            int kchunk;
+            if (split(params, M, N, K, &kchunk) < 2)
+                return false;
+        }
+        // The slices are run by the blocked kernel's work-groups
+        // fall through
+        case BLOCK:
+            group = params.blksz * params.blksz;
+            local = 2 * sizeof(float) * params.blksz * params.blksz;
+            break;
+        case BLOCK_REG:
+            group = (params.tsm / params.wptm) * (params.tsn / params.wptn);
+            local = sizeof(float) * params.tsk * (params.tsm + params.tsn);
+            break;
+    }
+    return group <= max_group_ && local <= local_mem_;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Estimated rate of a kernel in GFLOPS at its full rate, before the shape
+//
+//------------------------------------------------------------------------------
+double MatmulDispatcher::estimate(int v) const
+{
+    double eff = gpu_ ? variants[v].gpu_eff : variants[v].cpu_eff;
+    if (variants[v].local && local_global_)
+        eff *= 0.5;     // the copies into "local" memory gain nothing
+    return peak_ * eff;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Predicted seconds for kernel v on a shape
+//
+//------------------------------------------------------------------------------
+double MatmulDispatcher::predict(int v, const TuneParams& params, int M, int N, int K,
+    bool *calibrated) const
+{
+    const double flops = 2.0 * M * N * K;
+    const double shape = shape_factor(v, params, M, N, K);
+    double gflops;
+
+    std::map<int, std::map<int, double> >::const_iterator it = rates_.find(v);
+    *calibrated = it != rates_.end();
+    if (*calibrated)
+    {
+        // The measured runs were square: move from their shape to this one
+        const double n = std::cbrt((double)M * N * K);
+        const int order = std::max(1, (int)(n + 0.5));
+        gflops = interpolate(it->second, n) * shape
+               / shape_factor(v, params, order, order, order);
+    }
+    else
+        gflops = estimate(v) * scale_ * shape;
+
+    if (gflops <= 0.0)
+        return 1.0e30;
+    double seconds = DISPATCH_LAUNCH + flops / (gflops * 1.0e9);
+
+    // The reduction of split_k: a second launch, and the partial products
+    // written by the first kernel and read by the second
+    if (v == SPLIT_K)
+    {
+        int kchunk;
+        const int s = split(params, M, N, K, &kchunk);
+        seconds += DISPATCH_LAUNCH
+                 + sizeof(float) * (2.0 * s + 1.0) * M * N / (DISPATCH_BW * 1.0e9);
+    }
+    return seconds;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to read the measured rates of this device's kernels
+//
+//------------------------------------------------------------------------------
+void MatmulDispatcher::calibrate(const std::string& db)
+{
+    std::ifstream in(db.c_str());
+    if (!in.is_open())
+        return;
+
+    const std::string name = trim(device_.getInfo<CL_DEVICE_NAME>());
+    bool ours = false;
+    int col_suite = -1, col_variant = -1, col_size = -1, col_median = -1, col_flops = -1;
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.compare(0, 2, "# ") == 0)
+        {
+            const size_t colon = line.find(':');
+            if (colon != std::string::npos && trim(line.substr(2, colon - 2)) == "device")
+                ours = trim(line.substr(colon + 1)) == name;
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::istringstream row(line);
+        std::string field;
+        while (std::getline(row, field, ','))
+            fields.push_back(trim(field));
+
+        if (!fields.empty() && fields[0] == "suite")
+        {
+            for (int c = 0; c < (int)fields.size(); c++)
+            {
+                if (fields[c] == "suite")         col_suite = c;
+                else if (fields[c] == "variant")  col_variant = c;
+                else if (fields[c] == "size")     col_size = c;
+                else if (fields[c] == "median_s") col_median = c;
+                else if (fields[c] == "flops")    col_flops = c;
+            }
+            continue;
+        }
+
+        const int cols = std::max(std::max(col_suite, col_variant),
+            std::max(col_size, std::max(col_median, col_flops)));
+        if (!ours || col_suite < 0 || col_variant < 0 || col_size < 0 || col_median < 0
+            || col_flops < 0 || (int)fields.size() <= cols || fields[col_suite] != "mult")
+            continue;
+
+        int v = 0;
+        while (v < VARIANTS && fields[col_variant] != variants[v].name)
+            v++;
+        int m, n, k;
+        const double median = atof(fields[col_median].c_str());
+        const double flops  = atof(fields[col_flops].c_str());
+        if (v == VARIANTS || sscanf(fields[col_size].c_str(), "%dx%dx%d", &m, &n, &k) != 3
+            || median <= 0.0 || flops <= 0.0)
+            continue;
+
+        const int order = std::max(1, (int)(std::cbrt((double)m * n * k) + 0.5));
+        rates_[v][order] = flops / median / 1.0e9;
+    }
+
+    // The lowest ratio of measured to estimated rate
+    const TuneParams params = default_tune_params();
+    bool first = true;
+    std::map<int, std::map<int, double> >::const_iterator it;
+    for (it = rates_.begin(); it != rates_.end(); ++it)
+    {
+        std::map<int, double>::const_iterator r;
+        for (r = it->second.begin(); r != it->second.end(); ++r)
+        {
+            const double estimated = estimate(it->first)
+                * shape_factor(it->first, params, r->first, r->first, r->first);
+            if (estimated > 0.0 && (first || r->second / estimated < scale_))
+            {
+                scale_ = r->second / estimated;
+                first = false;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  The kernels the device can run for a shape, fastest first
+//
+//------------------------------------------------------------------------------
+std::vector<DispatchChoice> MatmulDispatcher::rank(int M, int N, int K)
+{
+    const TuneParams params = params_for(device_, M, N, K);
+
+    std::vector<DispatchChoice> choices;
+    for (int v = 0; v < VARIANTS; v++)
+    {
+        if (!feasible(v, params, M, N, K))
+            continue;
+        DispatchChoice choice;
+        choice.variant = variants[v].name;
+        choice.seconds = predict(v, params, M, N, K, &choice.calibrated);
+        choices.push_back(choice);
+    }
+
+    std::stable_sort(choices.begin(), choices.end(),
+        [](const DispatchChoice& a, const DispatchChoice& b) { return a.seconds < b.seconds; });
+    return choices;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to build (once for each set of options) a kernel
+//
+//------------------------------------------------------------------------------
+cl::Kernel& MatmulDispatcher::build(const char *source, const std::string& options,
+    const char *name)
+{
+    const std::string key = std::string(source) + " " + name + " " + options;
+    std::map<std::string, cl::Kernel>::iterator it = kernels_.find(key);
+    if (it == kernels_.end())
+    {
+        cl::Program program = util::buildProgram(context_, util::kernelSource(source), options);
+        it = kernels_.insert(std::make_pair(key, cl::Kernel(program, name))).first;
+    }
+    return it->second;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run the fastest kernel on device buffers
+//
+//------------------------------------------------------------------------------
+cl::Event MatmulDispatcher::run(cl::CommandQueue& queue, int M, int N, int K,
+    cl::Buffer& d_a, cl::Buffer& d_b, cl::Buffer& d_c, std::string *variant, cl::Event *first)
+{
+    const std::vector<DispatchChoice> choices = rank(M, N, K);
+    if (variant)
+        *variant = choices[0].variant;
+    return run_variant(choices[0].variant, queue, M, N, K, d_a, d_b, d_c, first);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run a kernel by name on device buffers
+//
+//------------------------------------------------------------------------------
+cl::Event MatmulDispatcher::run_variant(const std::string& name, cl::CommandQueue& queue,
+    int M, int N, int K, cl::Buffer& d_a, cl::Buffer& d_b, cl::Buffer& d_c, cl::Event *first)
+{
+    const TuneParams params = params_for(device_, M, N, K);
+
+    int v = 0;
+    while (v < VARIANTS && name != variants[v].name)
+        v++;
+    if (v == VARIANTS || !feasible(v, params, M, N, K))
+        throw cl::Error(CL_INVALID_VALUE, "dispatch: the kernel cannot run this shape on the device");
+
+    std::ostringstream options;
+    if (v == ROW_PRIV || v == ROW_PRIV_BLOC)
+        options << "-DPRIV_K=" << PRIV_K;
+    else if (v == BLOCK || v == SPLIT_K)
+        options << block_options(params, M, N, K);
+    else if (v == BLOCK_REG)
+        options << reg_options(params, M, N, K);
+
+    cl::Event event;
+    if (v == SPLIT_K)
+    {
+        const int b = params.blksz;
+        int kchunk;
+        const int s = split(params, M, N, K, &kchunk);
+
+        // Room for the partial products, kept for later calls
+        const size_t bytes = sizeof(float) * (size_t)s * M * N;
+        if (bytes > partial_size_)
+        {
+            partial_ = cl::Buffer(context_, CL_MEM_READ_WRITE, bytes);
+            partial_size_ = bytes;
+        }
+
+        cl::Kernel& partial = build(variants[v].source, options.str(), "mmul_partial");
+        partial.setArg(0, M);
+        partial.setArg(1, N);
+        partial.setArg(2, K);
+        partial.setArg(3, kchunk);
+        partial.setArg(4, d_a);
+        partial.setArg(5, d_b);
+        partial.setArg(6, partial_);
+        partial.setArg(7, cl::Local(sizeof(float) * b*b));
+        partial.setArg(8, cl::Local(sizeof(float) * b*b));
+
+        std::vector<cl::Event> products(1);
+        queue.enqueueNDRangeKernel(partial, cl::NullRange,
+            cl::NDRange(ROUND_UP(N, b), ROUND_UP(M, b), s), cl::NDRange(b, b, 1),
+            NULL, &products[0]);
+
+        cl::Kernel& reduce = build(variants[v].source, options.str(), "reduce_partial");
+        reduce.setArg(0, M * N);
+        reduce.setArg(1, s);
+        reduce.setArg(2, partial_);
+        reduce.setArg(3, d_c);
+        queue.enqueueNDRangeKernel(reduce, cl::NullRange, cl::NDRange(M * N), cl::NullRange,
+            &products, &event);
+
+        if (first)
+            *first = products[0];
+        return event;
+    }
+
+    cl::Kernel& kernel = build(variants[v].source, options.str(), "mmul");
+
+    kernel.setArg(0, M);
+    kernel.setArg(1, N);
+    kernel.setArg(2, K);
+    kernel.setArg(3, d_a);
+    kernel.setArg(4, d_b);
+    kernel.setArg(5, d_c);
+
+    cl::NDRange global, local;
+    switch (v)
+    {
+        case ELEM:
+            global = cl::NDRange(M, N);
+            break;
+        case ROW:
+            global = cl::NDRange(M);
+            break;
+        case ROW_PRIV:
+            global = cl::NDRange(ROUND_UP(M, ROW_LOCAL));
+            local  = cl::NDRange(ROW_LOCAL);
+            break;
+        case ROW_PRIV_BLOC:
+            kernel.setArg(6, cl::Local(sizeof(float) * std::min(K, PRIV_K)));
+            global = cl::NDRange(ROUND_UP(M, ROW_LOCAL));
+            local  = cl::NDRange(ROW_LOCAL);
+            break;
+        case BLOCK:
+        {
+            const int b = params.blksz;
+            kernel.setArg(6, cl::Local(sizeof(float) * b*b));
+            kernel.setArg(7, cl::Local(sizeof(float) * b*b));
+            global = cl::NDRange(ROUND_UP(N, b), ROUND_UP(M, b));
+            local  = cl::NDRange(b, b);
+            break;
+        }
+        default:
+            kernel.setArg(6, cl::Local(sizeof(float) * params.tsk*params.tsm));
+            kernel.setArg(7, cl::Local(sizeof(float) * params.tsk*params.tsn));
+            global = cl::NDRange(ROUND_UP(N, params.tsn)/params.wptn, ROUND_UP(M, params.tsm)/params.wptm);
+            local  = cl::NDRange(params.tsn/params.wptn, params.tsm/params.wptm);
+            break;
+    }
+
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, NULL, &event);
+    if (first)
+        *first = event;
+    return event;
+}
+
+//------------------------------------------------------------------------------
+//
+//  The device used by matmul()
+//
+//------------------------------------------------------------------------------
+static cl::Context       matmul_context;
+static cl::CommandQueue  matmul_queue;
+static MatmulDispatcher *matmul_dispatch = NULL;
+
+void matmul_device(cl::Context& context, cl::Device& device)
+{
+    delete matmul_dispatch;
+    matmul_dispatch = new MatmulDispatcher(context, device);
+    matmul_context  = context;
+    matmul_queue    = cl::CommandQueue(context, device);
+}
+
+MatmulDispatcher& matmul_dispatcher()
+{
+    if (!matmul_dispatch)
+    {
+        cl::Context context(CL_DEVICE_TYPE_DEFAULT);
+        cl::Device device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
+        matmul_device(context, device);
+    }
+    return *matmul_dispatch;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute C = A * B with the fastest kernel
+//
+//------------------------------------------------------------------------------
+double matmul(const util::aligned_vector<float>& A, const util::aligned_vector<float>& B,
+    util::aligned_vector<float>& C, int M, int N, int K, std::string *variant)
+{
+    MatmulDispatcher& dispatcher = matmul_dispatcher();
+
+    util::Timer timer;
+    const uint64_t start = timer.getTimeMicroseconds();
+
+    cl::Buffer d_a(matmul_context, CL_MEM_READ_ONLY,  sizeof(float) * (size_t)M * K);
+    cl::Buffer d_b(matmul_context, CL_MEM_READ_ONLY,  sizeof(float) * (size_t)K * N);
+    cl::Buffer d_c(matmul_context, CL_MEM_WRITE_ONLY, sizeof(float) * (size_t)M * N);
+
+    matmul_queue.enqueueWriteBuffer(d_a, CL_FALSE, 0, sizeof(float) * (size_t)M * K, &A[0]);
+    matmul_queue.enqueueWriteBuffer(d_b, CL_FALSE, 0, sizeof(float) * (size_t)K * N, &B[0]);
+    dispatcher.run(matmul_queue, M, N, K, d_a, d_b, d_c, variant);
+    matmul_queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(float) * (size_t)M * N, &C[0]);
+
+    return (timer.getTimeMicroseconds() - start) / 1.0e6;
+}
@@ -0,0 +1,145 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Matrix multiplication dispatcher (function prototypes)
+//
+//  PURPOSE: One entry point, matmul(A, B, C, M, N, K), that runs the
+//           kernel expected to be fastest for the device and the shape
+//           instead of trying them all.  The expected time of each kernel
+//           comes from a small cost model:
+//
+//             time = DISPATCH_LAUNCH + 2*M*N*K / (rate * fill * useful)
+//
+//           rate    the kernel's rate on this device.  It is taken from
+//                   the mult results of an earlier benchmark run (the CSV
+//                   written by Bench/Cpp, see DISPATCH_DB), interpolated
+//                   in the order of the matrices.  Without results for the
+//                   device it is a fraction of an estimated peak, by
+//                   device type, and halved for kernels using local memory
+//                   when the device only emulates it in global memory.
+//           fill    how well the work-groups fill the compute units
+//           useful  the fraction of the padded NDRange doing real work
+//
+//           Kernels that need more local memory or larger work-groups
+//           than the device has are never chosen.
+//
+//           When C has too few blocks to fill the device (a small C
+//           with a deep K) the blocked kernel is also offered split-K
+//           (C_splitk.cl): K is cut into slices that run as separate
+//           work-groups, and a second kernel adds up their partial
+//           products.  Its fill counts the slices, and its time adds a
+//           launch and the traffic of the partial products at
+//           DISPATCH_BW.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __DISPATCH_HDR
+#define __DISPATCH_HDR
+
+#include <map>
+
+#include "tuner.hpp"
+
+#define DISPATCH_DB "../../Bench/Cpp/bench.csv"  // benchmark results to calibrate from
+#define DISPATCH_LAUNCH (20.0e-6)   // seconds to launch a kernel, for the model
+#define DISPATCH_BW     (50.0)      // GB/s of an element-wise pass, for the model
+
+//------------------------------------------------------------------------------
+//
+//  The predicted time of one kernel for a shape
+//
+//------------------------------------------------------------------------------
+struct DispatchChoice
+{
+    std::string variant;    // kernel name as in the benchmark (elem, row, ...)
+    double      seconds;    // predicted kernel time
+    bool        calibrated; // rate from benchmark results, not the estimate
+};
+
+//------------------------------------------------------------------------------
+//
+//  Dispatcher for one device.  The calibration file is read once, when it
+//  is created, and the kernels are built the first time they are chosen.
+//
+//------------------------------------------------------------------------------
+class MatmulDispatcher
+{
+public:
+    MatmulDispatcher(cl::Context& context, cl::Device& device,
+        const std::string& db = DISPATCH_DB);
+
+    // The kernels the device can run for the shape, fastest first
+    std::vector<DispatchChoice> rank(int M, int N, int K);
+
+    // C = A * B on device buffers with the fastest kernel; returns the
+    // event of the kernel and sets variant to its name if not NULL.  A
+    // product of two kernels (split_k) returns the event of the second
+    // and sets first, if not NULL, to that of the first; otherwise first
+    // is the returned event too.
+    cl::Event run(cl::CommandQueue& queue, int M, int N, int K,
+        cl::Buffer& d_a, cl::Buffer& d_b, cl::Buffer& d_c, std::string *variant = NULL,
+        cl::Event *first = NULL);
+
+    // The same with the kernel named variant, to compare kernels; throws
+    // if the device cannot run it for the shape
+    cl::Event run_variant(const std::string& variant, cl::CommandQueue& queue,
+        int M, int N, int K, cl::Buffer& d_a, cl::Buffer& d_b, cl::Buffer& d_c,
+        cl::Event *first = NULL);
+
+    // Number of slices of K split_k uses for the shape (1: not split)
+    int slices(int M, int N, int K);
+
+    // Number of kernels with benchmark results for this device
+    int calibrated() const { return (int)rates_.size(); }
+
+private:
+    double estimate(int v) const;
+    double shape_factor(int v, const TuneParams& params, int M, int N, int K) const;
+    bool   feasible(int v, const TuneParams& params, int M, int N, int K) const;
+    double predict(int v, const TuneParams& params, int M, int N, int K, bool *calibrated) const;
+    void   calibrate(const std::string& db);
+    int    split(const TuneParams& params, int M, int N, int K, int *kchunk) const;
+    cl::Kernel& build(const char *source, const std::string& options, const char *name);
+
+    cl::Context context_;
+    cl::Device  device_;
+    bool        gpu_;           // not a CPU: use the GPU efficiencies
+    bool        local_global_;  // local memory is emulated in global memory
+    int         units_;         // compute units
+    size_t      max_group_;     // largest work-group
+    cl_ulong    local_mem_;     // bytes of local memory
+    double      peak_;          // estimated peak GFLOPS (uncalibrated model)
+    double      scale_;         // lowest measured / estimated rate of the calibrated kernels
+
+    // Measured GFLOPS of each calibrated kernel by order of the matrices
+    std::map<int, std::map<int, double> > rates_;
+    std::map<std::string, cl::Kernel> kernels_;
+    cl::Buffer  partial_;       // partial products of split_k
+    size_t      partial_size_;  // its bytes
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to choose the device used by matmul().  Without a call, the
+//  first time matmul() is called it uses the platform's default device.
+//
+//------------------------------------------------------------------------------
+void matmul_device(cl::Context& context, cl::Device& device);
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the dispatcher matmul() uses, to see its choices
+//
+//------------------------------------------------------------------------------
+MatmulDispatcher& matmul_dispatcher();
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute C = A * B for A(M,K) and B(K,N) on the host with
+//  the fastest kernel on the device.  Returns the run time in seconds,
+//  including the copies, and sets variant to the kernel used if not NULL.
+//
+//------------------------------------------------------------------------------
+double matmul(const util::aligned_vector<float>& A, const util::aligned_vector<float>& B,
+    util::aligned_vector<float>& C, int M, int N, int K, std::string *variant = NULL);
+
+#endif
@@ -0,0 +1,263 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Fused epilogues for the blocked matrix multiplication kernels
+//
+//  PURPOSE: Build options and arguments for the epilogues of the blocked
+//           kernels, the same operations as separate passes
+//           (C_epilogue.cl) and on the host, and a comparison of the two
+//           on the device (see epilogue.hpp).
+//
+//------------------------------------------------------------------------------
+
+#include <sstream>
+#include <algorithm>
+
+#include "matmul.hpp"
+#include "epilogue.hpp"
+#include "profile.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+
+// The operations in the order they are applied, with their names and the
+// build options that select them
+static const struct
+{
+    EpilogueOps op;
+    const char *name;
+    const char *option;
+    const char *pass;       // kernel in C_epilogue.cl
+}
+epilogue_ops[] =
+{
+    { EpiScale,    "scale",    "-DEPI_SCALE",    "scale_pass"    },
+    { EpiBias,     "bias",     "-DEPI_BIAS",     "bias_pass"     },
+    { EpiRelu,     "relu",     "-DEPI_RELU",     "relu_pass"     },
+    { EpiGelu,     "gelu",     "-DEPI_GELU",     "gelu_pass"     },
+    { EpiResidual, "residual", "-DEPI_RESIDUAL", "residual_pass" }
+};
+static const int num_ops = sizeof(epilogue_ops) / sizeof(epilogue_ops[0]);
+
+bool parse_epilogue(const std::string& list, unsigned& ops)
+{
+    std::istringstream in(list);
+    std::string name;
+    ops = 0;
+    while (std::getline(in, name, ','))
+    {
+        int i = 0;
+        while (i < num_ops && name != epilogue_ops[i].name)
+            i++;
+        if (i == num_ops)
+            return false;
+        ops |= epilogue_ops[i].op;
+    }
+    return ops != 0;
+}
+
+std::string epilogue_name(unsigned ops)
+{
+    std::string name;
+    for (int i = 0; i < num_ops; i++)
+        if (ops & epilogue_ops[i].op)
+            name += (name.empty() ? "" : ",") + std::string(epilogue_ops[i].name);
+    return name;
+}
+
+std::string epilogue_options(unsigned ops)
+{
+    std::string options;
+    for (int i = 0; i < num_ops; i++)
+        if (ops & epilogue_ops[i].op)
+            options += std::string(" ") + epilogue_ops[i].option;
+    return options;
+}
+
+int epilogue_args(cl::Kernel& kernel, int index, const Epilogue& epilogue)
+{
+    if (epilogue.ops & EpiScale)
+        kernel.setArg(index++, epilogue.scale);
+    if (epilogue.ops & EpiBias)
+        kernel.setArg(index++, epilogue.bias);
+    if (epilogue.ops & EpiResidual)
+        kernel.setArg(index++, epilogue.residual);
+    return index;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue the epilogue as one pass over C per operation
+//
+//------------------------------------------------------------------------------
+void epilogue_passes(cl::Context& context, cl::CommandQueue& queue, int M, int N,
+    const Epilogue& epilogue, cl::Buffer& C, std::vector<cl::Event>& events)
+{
+    cl::Program program = util::buildProgram(context, util::kernelSource("C_epilogue.cl"), "");
+    const int count = M * N;
+
+    for (int i = 0; i < num_ops; i++)
+    {
+        const EpilogueOps op = epilogue_ops[i].op;
+        if (!(epilogue.ops & op))
+            continue;
+
+        cl::Kernel kernel(program, epilogue_ops[i].pass);
+        int arg = 0;
+        kernel.setArg(arg++, count);
+        if (op == EpiScale)
+            kernel.setArg(arg++, epilogue.scale);
+        if (op == EpiBias)
+        {
+            kernel.setArg(arg++, N);
+            kernel.setArg(arg++, epilogue.bias);
+        }
+        if (op == EpiResidual)
+            kernel.setArg(arg++, epilogue.residual);
+        kernel.setArg(arg++, C);
+
+        cl::Event event;
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(count), cl::NullRange,
+            NULL, &event);
+        events.push_back(event);
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to apply an epilogue on the host
+//
+//------------------------------------------------------------------------------
+void epilogue_host(int M, int N, unsigned ops, float scale, const float *bias,
+    const float *R, float *C)
+{
+    for (int i = 0; i < M; i++)
+        for (int j = 0; j < N; j++)
+        {
+            float x = C[i*N + j];
+            if (ops & EpiScale)
+                x *= scale;
+            if (ops & EpiBias)
+                x += bias[j];
+            if (ops & EpiRelu)
+                x = std::max(x, 0.0f);
+            if (ops & EpiGelu)
+                x = 0.5f * x * (1.0f + tanhf(0.7978845608f * (x + 0.044715f * x*x*x)));
+            if (ops & EpiResidual)
+                x += R[i*N + j];
+            C[i*N + j] = x;
+        }
+}
+
+double epilogue_bytes(int M, int N, unsigned ops, bool fused)
+{
+    const double c = sizeof(float) * (double)M * N;
+    double bytes = 0.0;
+    if (ops & EpiBias)
+        bytes += sizeof(float) * (double)N;
+    if (ops & EpiResidual)
+        bytes += c;
+    if (!fused)
+        for (int i = 0; i < num_ops; i++)
+            if (ops & epilogue_ops[i].op)
+                bytes += 2.0 * c;
+    return bytes;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run a blocked kernel with an epilogue unfused and fused
+//
+//------------------------------------------------------------------------------
+EpilogueStats epilogue_compare(cl::Context& context, cl::CommandQueue& queue,
+    const TuneParams& params, bool reg, int M, int N, int K, unsigned ops,
+    util::aligned_vector<float>& A, util::aligned_vector<float>& B)
+{
+    EpilogueStats stats;
+
+    // Operands of the epilogue: a scale that keeps the activations away
+    // from their linear parts, a bias and a residual in [-1, 1]
+    Epilogue epilogue;
+    epilogue.ops   = ops;
+    epilogue.scale = 1.0f / (float)sqrt((double)K);
+    util::aligned_vector<float> h_bias(N), h_R((size_t)M * N);
+    util::aligned_vector<double> r((size_t)M * N);
+    randmat(1, N, r);
+    std::copy(r.begin(), r.begin() + N, h_bias.begin());
+    randmat(M, N, r);
+    std::copy(r.begin(), r.end(), h_R.begin());
+    epilogue.bias     = cl::Buffer(context, h_bias.begin(), h_bias.end(), true);
+    epilogue.residual = cl::Buffer(context, h_R.begin(), h_R.end(), true);
+
+    cl::Buffer d_a(context, A.begin(), A.end(), true);
+    cl::Buffer d_b(context, B.begin(), B.end(), true);
+    cl::Buffer d_c(context, CL_MEM_READ_WRITE, sizeof(float) * (size_t)M * N);
+
+    const std::string source  = util::kernelSource(reg ? "C_block_reg.cl" : "C_block_form.cl");
+    const std::string options = reg ? reg_options(params, M, N, K) : block_options(params, M, N, K);
+
+    // The same kernel without and with the epilogue
+    cl::Kernel plain(util::buildProgram(context, source, options), "mmul");
+    cl::Kernel fused(util::buildProgram(context, source, options + epilogue_options(ops)), "mmul");
+
+    cl::NDRange global, local;
+    size_t Abytes, Bbytes;
+    if (reg)
+    {
+        global = cl::NDRange(ROUND_UP(N, params.tsn) / params.wptn, ROUND_UP(M, params.tsm) / params.wptm);
+        local  = cl::NDRange(params.tsn / params.wptn, params.tsm / params.wptm);
+        Abytes = sizeof(float) * params.tsk * params.tsm;
+        Bbytes = sizeof(float) * params.tsk * params.tsn;
+    }
+    else
+    {
+        global = cl::NDRange(ROUND_UP(N, params.blksz), ROUND_UP(M, params.blksz));
+        local  = cl::NDRange(params.blksz, params.blksz);
+        Abytes = Bbytes = sizeof(float) * params.blksz * params.blksz;
+    }
+    cl::Kernel *kernels[2] = { &plain, &fused };
+    for (int i = 0; i < 2; i++)
+    {
+        kernels[i]->setArg(0, M);
+        kernels[i]->setArg(1, N);
+        kernels[i]->setArg(2, K);
+        kernels[i]->setArg(3, d_a);
+        kernels[i]->setArg(4, d_b);
+        kernels[i]->setArg(5, d_c);
+        kernels[i]->setArg(6, cl::Local(Abytes));
+        kernels[i]->setArg(7, cl::Local(Bbytes));
+    }
+    epilogue_args(fused, 8, epilogue);
+
+    util::aligned_vector<float> h_C((size_t)M * N), ref((size_t)M * N);
+
+    // Unfused: the product, checked on its own, then one pass per operation
+    std::vector<cl::Event> events;
+    cl::Event event;
+    queue.enqueueNDRangeKernel(plain, cl::NullRange, global, local, NULL, &event);
+    cl::copy(queue, d_c, ref.begin(), ref.end());
+    stats.gemm     = profile_seconds(event);
+    stats.residual = freivalds(M, N, K, A, B, ref, FREIVALDS_ROUNDS);
+    epilogue_host(M, N, ops, epilogue.scale, &h_bias[0], &h_R[0], &ref[0]);
+
+    epilogue_passes(context, queue, M, N, epilogue, d_c, events);
+    cl::copy(queue, d_c, h_C.begin(), h_C.end());
+    stats.passes = 0.0;
+    for (size_t i = 0; i < events.size(); i++)
+        stats.passes += profile_seconds(events[i]);
+
+    stats.unfused_err = 0.0;
+    for (size_t i = 0; i < h_C.size(); i++)
+        stats.unfused_err = std::max(stats.unfused_err, (double)fabs(h_C[i] - ref[i]));
+
+    // Fused: one kernel
+    zero_mat(M, N, h_C);
+    cl::copy(queue, h_C.begin(), h_C.end(), d_c);
+    queue.enqueueNDRangeKernel(fused, cl::NullRange, global, local, NULL, &event);
+    cl::copy(queue, d_c, h_C.begin(), h_C.end());
+    stats.fused = profile_seconds(event);
+
+    stats.fused_err = 0.0;
+    for (size_t i = 0; i < h_C.size(); i++)
+        stats.fused_err = std::max(stats.fused_err, (double)fabs(h_C[i] - ref[i]));
+
+    return stats;
+}
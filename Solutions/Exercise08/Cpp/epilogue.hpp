@@ -0,0 +1,132 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Fused epilogues for the blocked matrix multiplication kernels
+//           (function prototypes)
+//
+//  PURPOSE: A product is often followed by element-wise operations on C:
+//           scaling, adding a bias per column, an activation, adding a
+//           residual matrix.  Run as separate passes (C_epilogue.cl) each
+//           one reads and writes all of C again.  The blocked kernels
+//           (C_block_form.cl and C_block_reg.cl) can instead apply them to
+//           C while it is still in registers, before its only store, when
+//           built with epilogue_options().  The operations always run in
+//           this order:
+//
+//             scale     C = scale * C
+//             bias      C = C + bias       bias is a row of N, added to every row
+//             relu      C = max(C, 0)
+//             gelu      C = gelu(C)        tanh approximation
+//             residual  C = C + R          R is M x N
+//
+//           epilogue_compare() runs a kernel with the epilogue fused and
+//           unfused for the driver.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __EPILOGUE_HDR
+#define __EPILOGUE_HDR
+
+#include "tuner.hpp"
+
+enum EpilogueOps
+{
+    EpiScale    = 1,
+    EpiBias     = 2,
+    EpiRelu     = 4,
+    EpiGelu     = 8,
+    EpiResidual = 16
+};
+
+//------------------------------------------------------------------------------
+//
+//  The operations of an epilogue and their operands
+//
+//------------------------------------------------------------------------------
+struct Epilogue
+{
+    unsigned   ops;         // EpilogueOps or'ed together
+    float      scale;       // for EpiScale
+    cl::Buffer bias;        // N elements, for EpiBias
+    cl::Buffer residual;    // M x N, for EpiResidual
+};
+
+//------------------------------------------------------------------------------
+//
+//  Functions to read a list of operations ("bias,relu"; false if a name is
+//  unknown) and to write one
+//
+//------------------------------------------------------------------------------
+bool parse_epilogue(const std::string& list, unsigned& ops);
+std::string epilogue_name(unsigned ops);
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the build options selecting the operations in the
+//  blocked kernels
+//
+//------------------------------------------------------------------------------
+std::string epilogue_options(unsigned ops);
+
+//------------------------------------------------------------------------------
+//
+//  Function to set the operands of the epilogue as arguments of a kernel
+//  built with epilogue_options(), starting at argument index (the first
+//  after the local blocks).  Returns the index after the last one set.
+//
+//------------------------------------------------------------------------------
+int epilogue_args(cl::Kernel& kernel, int index, const Epilogue& epilogue);
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue the epilogue as separate element-wise passes over C,
+//  one per operation; the events of the passes are added to events
+//
+//------------------------------------------------------------------------------
+void epilogue_passes(cl::Context& context, cl::CommandQueue& queue, int M, int N,
+    const Epilogue& epilogue, cl::Buffer& C, std::vector<cl::Event>& events);
+
+//------------------------------------------------------------------------------
+//
+//  Function to apply an epilogue to C on the host (the reference)
+//
+//------------------------------------------------------------------------------
+void epilogue_host(int M, int N, unsigned ops, float scale, const float *bias,
+    const float *R, float *C);
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the bytes of global memory an epilogue moves on top
+//  of the product's own store of C: its operands, plus a read and a write
+//  of C for every pass when it is not fused
+//
+//------------------------------------------------------------------------------
+double epilogue_bytes(int M, int N, unsigned ops, bool fused);
+
+//------------------------------------------------------------------------------
+//
+//  Kernel times of a blocked kernel with an epilogue, unfused and fused,
+//  and the largest difference of each result from the host reference
+//
+//------------------------------------------------------------------------------
+struct EpilogueStats
+{
+    double gemm;        // product alone
+    double passes;      // the element-wise passes after it
+    double fused;       // product with the epilogue fused
+    double unfused_err;
+    double fused_err;
+    double residual;    // Freivalds residual of the product alone
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to run C_block_form.cl (reg false) or C_block_reg.cl (reg true)
+//  on A and B with the operations ops unfused and fused, on random operands.
+//  The queue must have profiling enabled.
+//
+//------------------------------------------------------------------------------
+EpilogueStats epilogue_compare(cl::Context& context, cl::CommandQueue& queue,
+    const TuneParams& params, bool reg, int M, int N, int K, unsigned ops,
+    util::aligned_vector<float>& A, util::aligned_vector<float>& B);
+
+#endif
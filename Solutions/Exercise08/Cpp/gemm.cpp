@@ -0,0 +1,238 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: BLAS style matrix multiplication on device buffers
+//
+//  PURPOSE: Check the arguments of sgemm and dgemm the way BLAS does, turn
+//           column major calls into row major ones and enqueue the kernel.
+//
+//           A column major matrix read as row major is its transpose, so a
+//           column major C = op(A) * op(B) is the row major
+//
+//             C' = op(B)' * op(A)'
+//
+//           with the roles of A and B (and M and N) swapped.  No data moves.
+//
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+#include "matmul.hpp"
+#include "dispatch.hpp"
+#include "gemm.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  The general kernel built for one device, precision and pair of transposes
+//
+//------------------------------------------------------------------------------
+struct GemmKernel
+{
+    cl::Kernel kernel;
+    int        ts;      // block of C per work-group
+    int        wpt;     // elements of C per work-item
+};
+
+static std::map<std::string, GemmKernel> gemm_kernels;
+static std::map<std::string, MatmulDispatcher*> gemm_dispatchers;
+
+//------------------------------------------------------------------------------
+//
+//  Function to build (once) the general kernel.  The block is made smaller
+//  until the work-group and the local memory fit the device.
+//
+//------------------------------------------------------------------------------
+static GemmKernel& gemm_kernel(const cl::Context& context, const cl::Device& device,
+    bool dbl, bool transA, bool transB)
+{
+    std::ostringstream key;
+    key << device_key(context, device) << (dbl ? " d" : " s")
+        << (transA ? "T" : "N") << (transB ? "T" : "N");
+
+    std::map<std::string, GemmKernel>::iterator it = gemm_kernels.find(key.str());
+    if (it != gemm_kernels.end())
+        return it->second;
+
+    const size_t   real     = dbl ? sizeof(double) : sizeof(float);
+    const size_t   max_wg   = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const cl_ulong max_loc  = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+    const std::string source = util::kernelSource("C_gemm.cl");
+
+    GemmKernel gemm;
+    gemm.ts = GEMM_TS;
+    for (;;)
+    {
+        gemm.wpt = std::min(GEMM_WPT, gemm.ts);
+        const size_t wg = (size_t)gemm.ts * gemm.ts / gemm.wpt;
+        if (gemm.ts > 4 && (wg > max_wg || 2 * real * gemm.ts * gemm.ts > max_loc))
+        {
+            gemm.ts /= 2;
+            continue;
+        }
+
+        std::ostringstream options;
+        options << "-DTS=" << gemm.ts << " -DWPT=" << gemm.wpt;
+        if (dbl)
+            options << " -DPREC_DOUBLE";
+        if (transA)
+            options << " -DTRANS_A";
+        if (transB)
+            options << " -DTRANS_B";
+
+        cl::Program program = util::buildProgram(context, source, options.str());
+        gemm.kernel = cl::Kernel(program, "gemm");
+
+        // The compiled kernel may allow smaller work-groups than the device
+        const size_t kernel_wg = gemm.kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+        if (wg <= kernel_wg || gemm.ts <= 4)
+            break;
+        gemm.ts /= 2;
+    }
+
+    return gemm_kernels.insert(std::make_pair(key.str(), gemm)).first->second;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to check that a stored matrix (rows x cols of op(X), so cols x
+//  rows if it is transposed) fits its leading dimension and its buffer:
+//  check_operand() (matrix_lib) on its lines in the layout
+//
+//------------------------------------------------------------------------------
+static void check_matrix(const char *const errors[3], GemmLayout layout,
+    GemmTranspose trans, int rows, int cols, const cl::Buffer& X, size_t off, int ld,
+    size_t size)
+{
+    if (trans == GemmTrans)
+        std::swap(rows, cols);
+
+    // The stored matrix is lines of length ld, each holding used elements
+    const int lines = (layout == GemmRowMajor) ? rows : cols;
+    const int used  = (layout == GemmRowMajor) ? cols : rows;
+    check_operand(errors, lines, used, ld, X, off, 0, 1, size);
+}
+
+static const char *const errors_a[3] = {
+    "gemm: lda too small", "gemm: A overruns its buffer", "gemm: A too large" };
+static const char *const errors_b[3] = {
+    "gemm: ldb too small", "gemm: B overruns its buffer", "gemm: B too large" };
+static const char *const errors_c[3] = {
+    "gemm: ldc too small", "gemm: C overruns its buffer", "gemm: C too large" };
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue C = alpha * op(A) * op(B) + beta * C for T = float or
+//  double
+//
+//------------------------------------------------------------------------------
+template <typename T>
+static cl::Event gemm(cl::CommandQueue& queue, GemmLayout layout,
+    GemmTranspose transA, GemmTranspose transB, int M, int N, int K,
+    T alpha, const cl::Buffer& A, size_t offA, int lda,
+    const cl::Buffer& B, size_t offB, int ldb,
+    T beta, cl::Buffer& C, size_t offC, int ldc)
+{
+    const bool dbl = sizeof(T) == sizeof(double);
+
+    if (M < 0 || N < 0 || K < 0)
+        throw cl::Error(CL_INVALID_VALUE, "gemm: negative matrix size");
+    check_matrix(errors_a, layout, transA, M, K, A, offA, lda, sizeof(T));
+    check_matrix(errors_b, layout, transB, K, N, B, offB, ldb, sizeof(T));
+    check_matrix(errors_c, layout, GemmNoTrans, M, N, C, offC, ldc, sizeof(T));
+
+    cl::Context context = queue.getInfo<CL_QUEUE_CONTEXT>();
+    cl::Device  device  = queue.getInfo<CL_QUEUE_DEVICE>();
+    if (dbl && device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") == std::string::npos)
+        throw cl::Error(CL_INVALID_OPERATION, "dgemm: device has no fp64");
+
+    cl::Event event;
+    if (M == 0 || N == 0)
+    {
+        queue.enqueueMarkerWithWaitList(NULL, &event);
+        return event;
+    }
+
+    // A and B are not read if alpha is zero
+    if (alpha == 0)
+        K = 0;
+
+    cl::Buffer a(A), b(B);
+    if (layout == GemmColMajor)
+    {
+        std::swap(M, N);
+        std::swap(transA, transB);
+        std::swap(a, b);
+        std::swap(offA, offB);
+        std::swap(lda, ldb);
+    }
+
+    // A plain product of packed matrices: the tuned mult kernels
+    if (!dbl && K > 0 && alpha == 1 && beta == 0
+        && transA == GemmNoTrans && transB == GemmNoTrans
+        && offA == 0 && offB == 0 && offC == 0 && lda == K && ldb == N && ldc == N)
+    {
+        const std::string key = device_key(context, device);
+        std::map<std::string, MatmulDispatcher*>::iterator it = gemm_dispatchers.find(key);
+        if (it == gemm_dispatchers.end())
+            it = gemm_dispatchers.insert(std::make_pair(key,
+                new MatmulDispatcher(context, device))).first;
+        return it->second->run(queue, M, N, K, a, b, C);
+    }
+
+    GemmKernel& gemm = gemm_kernel(context, device, dbl, transA == GemmTrans, transB == GemmTrans);
+    const int ts = gemm.ts;
+
+    gemm.kernel.setArg(0, M);
+    gemm.kernel.setArg(1, N);
+    gemm.kernel.setArg(2, K);
+    gemm.kernel.setArg(3, alpha);
+    gemm.kernel.setArg(4, a);
+    gemm.kernel.setArg(5, (int)offA);
+    gemm.kernel.setArg(6, lda);
+    gemm.kernel.setArg(7, b);
+    gemm.kernel.setArg(8, (int)offB);
+    gemm.kernel.setArg(9, ldb);
+    gemm.kernel.setArg(10, beta);
+    gemm.kernel.setArg(11, C);
+    gemm.kernel.setArg(12, (int)offC);
+    gemm.kernel.setArg(13, ldc);
+    gemm.kernel.setArg(14, cl::Local(sizeof(T) * ts * ts));
+    gemm.kernel.setArg(15, cl::Local(sizeof(T) * ts * ts));
+
+    queue.enqueueNDRangeKernel(gemm.kernel, cl::NullRange,
+        cl::NDRange(ROUND_UP(N, ts), ROUND_UP(M, ts) / gemm.wpt),
+        cl::NDRange(ts, ts / gemm.wpt), NULL, &event);
+    return event;
+}
+
+cl::Event sgemm(cl::CommandQueue& queue, GemmLayout layout,
+    GemmTranspose transA, GemmTranspose transB, int M, int N, int K,
+    float alpha, const cl::Buffer& A, size_t offA, int lda,
+    const cl::Buffer& B, size_t offB, int ldb,
+    float beta, cl::Buffer& C, size_t offC, int ldc)
+{
+    return gemm<float>(queue, layout, transA, transB, M, N, K,
+        alpha, A, offA, lda, B, offB, ldb, beta, C, offC, ldc);
+}
+
+cl::Event dgemm(cl::CommandQueue& queue, GemmLayout layout,
+    GemmTranspose transA, GemmTranspose transB, int M, int N, int K,
+    double alpha, const cl::Buffer& A, size_t offA, int lda,
+    const cl::Buffer& B, size_t offB, int ldb,
+    double beta, cl::Buffer& C, size_t offC, int ldc)
+{
+    return gemm<double>(queue, layout, transA, transB, M, N, K,
+        alpha, A, offA, lda, B, offB, ldb, beta, C, offC, ldc);
+}
+
+void gemm_release()
+{
+    gemm_kernels.clear();
+    for (std::map<std::string, MatmulDispatcher*>::iterator it = gemm_dispatchers.begin();
+         it != gemm_dispatchers.end(); ++it)
+        delete it->second;
+    gemm_dispatchers.clear();
+}
@@ -0,0 +1,84 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: BLAS style matrix multiplication on device buffers
+//           (function prototypes)
+//
+//  PURPOSE: sgemm and dgemm compute
+//
+//             C = alpha * op(A) * op(B) + beta * C
+//
+//           with the arguments of the BLAS routines of the same name:
+//           row or column major storage, op(X) = X or X', and leading
+//           dimensions.  The matrices are cl::Buffers, each with an offset
+//           (in elements) to the first element, so the operands stay on
+//           the device from one call to the next and a call only enqueues
+//           kernels on the caller's queue.  Nothing waits for them to
+//           finish: use the returned event or finish the queue.
+//
+//           sgemm calls that are a plain product of packed row major
+//           matrices, C = A * B, run the fastest of the tuned mult
+//           kernels (see dispatch.hpp).  Everything else runs the general
+//           kernel in C_gemm.cl.  Kernels are built the first time they
+//           are needed for a device and kept until gemm_release().
+//
+//           These functions, the dispatcher, the tuner, matrix_lib and the
+//           embedded kernels make up libmatmul.a (see the Makefile):
+//
+//             #include "gemm.hpp"
+//             ...
+//             sgemm(queue, GemmRowMajor, GemmNoTrans, GemmTrans, M, N, K,
+//                   1.0f, d_a, 0, K, d_b, 0, K, 0.0f, d_c, 0, N);
+//
+//           Bad arguments throw cl::Error(CL_INVALID_VALUE) and dgemm on a
+//           device without fp64 throws cl::Error(CL_INVALID_OPERATION).
+//
+//------------------------------------------------------------------------------
+
+#ifndef __GEMM_HDR
+#define __GEMM_HDR
+
+enum GemmLayout
+{
+    GemmRowMajor,
+    GemmColMajor
+};
+
+enum GemmTranspose
+{
+    GemmNoTrans,
+    GemmTrans
+};
+
+#define GEMM_TS  32      // block of C per work-group of C_gemm.cl
+#define GEMM_WPT 4       // elements of C per work-item of C_gemm.cl
+
+//------------------------------------------------------------------------------
+//
+//  Functions to enqueue C = alpha * op(A) * op(B) + beta * C, where op(A)
+//  is M x K, op(B) is K x N and C is M x N.  With row major storage lda is
+//  the distance between rows of A as stored (at least K, or M if A is
+//  transposed), and so on; with column major storage it is the distance
+//  between columns.  Returns the event of the last kernel.
+//
+//------------------------------------------------------------------------------
+cl::Event sgemm(cl::CommandQueue& queue, GemmLayout layout,
+    GemmTranspose transA, GemmTranspose transB, int M, int N, int K,
+    float alpha, const cl::Buffer& A, size_t offA, int lda,
+    const cl::Buffer& B, size_t offB, int ldb,
+    float beta, cl::Buffer& C, size_t offC, int ldc);
+
+cl::Event dgemm(cl::CommandQueue& queue, GemmLayout layout,
+    GemmTranspose transA, GemmTranspose transB, int M, int N, int K,
+    double alpha, const cl::Buffer& A, size_t offA, int lda,
+    const cl::Buffer& B, size_t offB, int ldb,
+    double beta, cl::Buffer& C, size_t offC, int ldc);
+
+//------------------------------------------------------------------------------
+//
+//  Function to drop the kernels built by sgemm and dgemm (and with them
+//  the library's references to the contexts they were built for)
+//
+//------------------------------------------------------------------------------
+void gemm_release();
+
+#endif
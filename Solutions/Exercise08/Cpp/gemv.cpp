@@ -0,0 +1,206 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: BLAS style matrix-vector products on device buffers
+//
+//  PURPOSE: Check the arguments of sgemv the way BLAS does, pick the kernel
+//           that reads A in the order it is stored and enqueue it.
+//
+//           A row major A holds the rows of op(A) = A contiguously, and so
+//           does a column major A transposed: both run gemv_rows.  The
+//           other two cases hold the columns of op(A) contiguously and run
+//           gemv_cols.  No data moves.
+//
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+#include "matmul.hpp"
+#include "gemv.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  A kernel of C_gemv.cl built for one device, with its work-group
+//
+//------------------------------------------------------------------------------
+struct GemvKernel
+{
+    cl::Kernel kernel;
+    int        x, y;    // lanes x rows (gemv_rows) or GEMV_CX x GEMV_CY (gemv_cols)
+};
+
+static std::map<std::string, GemvKernel> gemv_kernels;
+
+//------------------------------------------------------------------------------
+//
+//  Function to build (once) gemv_rows or gemv_cols.  The work-group is made
+//  smaller, first across the rows and then along them, until it fits the
+//  device and the compiled kernel.
+//
+//------------------------------------------------------------------------------
+static GemvKernel& gemv_kernel(const cl::Context& context, const cl::Device& device, bool cols)
+{
+    std::ostringstream key;
+    key << device_key(context, device) << (cols ? " cols" : " rows");
+
+    std::map<std::string, GemvKernel>::iterator it = gemv_kernels.find(key.str());
+    if (it != gemv_kernels.end())
+        return it->second;
+
+    const std::string source = util::kernelSource("C_gemv.cl");
+
+    GemvKernel gemv;
+    gemv.x = cols ? GEMV_CX : GEMV_LANES;
+    gemv.y = cols ? GEMV_CY : GEMV_ROWS;
+    size_t limit = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    for (;;)
+    {
+        while ((size_t)gemv.x * gemv.y > limit && gemv.x * gemv.y > 1)
+        {
+            if (gemv.y > 1)
+                gemv.y /= 2;
+            else
+                gemv.x /= 2;
+        }
+
+        std::ostringstream options;
+        if (cols)
+            options << "-DGEMV_CX=" << gemv.x << " -DGEMV_CY=" << gemv.y;
+        else
+            options << "-DGEMV_LANES=" << gemv.x << " -DGEMV_ROWS=" << gemv.y;
+
+        cl::Program program = util::buildProgram(context, source, options.str());
+        gemv.kernel = cl::Kernel(program, cols ? "gemv_cols" : "gemv_rows");
+
+        // The compiled kernel may allow smaller work-groups than the device
+        limit = gemv.kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+        if ((size_t)gemv.x * gemv.y <= limit || gemv.x * gemv.y == 1)
+            break;
+    }
+
+    return gemv_kernels.insert(std::make_pair(key.str(), gemv)).first->second;
+}
+
+static const char *const errors_a[3] = {
+    "gemv: lda too small", "gemv: A overruns its buffer", "gemv: A too large" };
+static const char *const errors_x[3] = {
+    "gemv: x too short", "gemv: x overruns its buffer", "gemv: x too large" };
+static const char *const errors_y[3] = {
+    "gemv: y too short", "gemv: y overruns its buffer", "gemv: y too large" };
+
+//------------------------------------------------------------------------------
+//
+//  Functions to enqueue y = alpha * op(A) * x + beta * y for a batch
+//
+//------------------------------------------------------------------------------
+cl::Event sgemv_batched(cl::CommandQueue& queue, GemmLayout layout, GemmTranspose trans,
+    int M, int N, float alpha, const cl::Buffer& A, size_t offA, int lda, int strideA,
+    const cl::Buffer& x, size_t offX, int strideX, float beta,
+    cl::Buffer& y, size_t offY, int strideY, int batch)
+{
+    if (M < 0 || N < 0 || batch < 0)
+        throw cl::Error(CL_INVALID_VALUE, "gemv: negative size");
+    if (strideA < 0 || strideX < 0 || strideY < 0)
+        throw cl::Error(CL_INVALID_VALUE, "gemv: negative stride");
+
+    // A stored by the rows of op(A), or by its columns
+    const bool cols = (layout == GemmRowMajor) != (trans == GemmNoTrans);
+    check_operand(errors_a, cols ? N : M, cols ? M : N, lda, A, offA, strideA, batch, sizeof(float));
+    check_operand(errors_x, 1, N, std::max(1, N), x, offX, strideX, batch, sizeof(float));
+    check_operand(errors_y, 1, M, std::max(1, M), y, offY, strideY, batch, sizeof(float));
+    if (batch > 1 && strideY < M)
+        throw cl::Error(CL_INVALID_VALUE, "gemv: y of the products overlap");
+
+    // With N == 0 the kernels read no A or x and leave y = beta * y
+
+    cl::Event event;
+    if (M == 0 || batch == 0)
+    {
+        queue.enqueueMarkerWithWaitList(NULL, &event);
+        return event;
+    }
+
+    cl::Context context = queue.getInfo<CL_QUEUE_CONTEXT>();
+    cl::Device  device  = queue.getInfo<CL_QUEUE_DEVICE>();
+    GemvKernel& gemv = gemv_kernel(context, device, cols);
+
+    gemv.kernel.setArg(0, M);
+    gemv.kernel.setArg(1, N);
+    gemv.kernel.setArg(2, alpha);
+    gemv.kernel.setArg(3, A);
+    gemv.kernel.setArg(4, (int)offA);
+    gemv.kernel.setArg(5, lda);
+    gemv.kernel.setArg(6, strideA);
+    gemv.kernel.setArg(7, x);
+    gemv.kernel.setArg(8, (int)offX);
+    gemv.kernel.setArg(9, strideX);
+    gemv.kernel.setArg(10, beta);
+    gemv.kernel.setArg(11, y);
+    gemv.kernel.setArg(12, (int)offY);
+    gemv.kernel.setArg(13, strideY);
+
+    cl::NDRange global;
+    if (cols)
+    {
+        gemv.kernel.setArg(14, cl::Local(sizeof(cl_float4) * gemv.x * gemv.y));
+        global = cl::NDRange(ROUND_UP((M + 3) / 4, gemv.x), gemv.y, batch);
+    }
+    else
+    {
+        gemv.kernel.setArg(14, cl::Local(sizeof(float) * gemv.x * gemv.y));
+        global = cl::NDRange(gemv.x, ROUND_UP(M, gemv.y), batch);
+    }
+
+    queue.enqueueNDRangeKernel(gemv.kernel, cl::NullRange, global,
+        cl::NDRange(gemv.x, gemv.y, 1), NULL, &event);
+    return event;
+}
+
+cl::Event sgemv(cl::CommandQueue& queue, GemmLayout layout, GemmTranspose trans,
+    int M, int N, float alpha, const cl::Buffer& A, size_t offA, int lda,
+    const cl::Buffer& x, size_t offX, float beta, cl::Buffer& y, size_t offY)
+{
+    return sgemv_batched(queue, layout, trans, M, N, alpha, A, offA, lda, 0,
+        x, offX, 0, beta, y, offY, 0, 1);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to measure the device's memory bandwidth with stream_scale,
+//  counting the read of a and the write of b
+//
+//------------------------------------------------------------------------------
+double stream_bandwidth(cl::CommandQueue& queue, int warmup, int reps)
+{
+    cl::Context context = queue.getInfo<CL_QUEUE_CONTEXT>();
+    cl::Device  device  = queue.getInfo<CL_QUEUE_DEVICE>();
+    cl::Program program = util::buildProgram(context, util::kernelSource("C_stream.cl"));
+    cl::make_kernel<cl::Buffer, cl::Buffer, float, unsigned int> scale(program, "stream_scale");
+
+    // Arrays well past any cache, but leaving room in device memory
+    cl_ulong bytes = std::min((cl_ulong)GEMV_STREAM_BYTES, device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>());
+    bytes = std::min(bytes, device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() / 4);
+    const unsigned int count = (unsigned int)(bytes / sizeof(cl_float4));
+    cl::Buffer d_a(context, CL_MEM_READ_ONLY, sizeof(cl_float4) * count);
+    cl::Buffer d_b(context, CL_MEM_WRITE_ONLY, sizeof(cl_float4) * count);
+
+    double best = 0.0;
+    for (int r = 0; r < warmup + std::max(1, reps); r++)
+    {
+        cl::Event event = scale(cl::EnqueueArgs(queue, cl::NDRange(count)), d_a, d_b, 3.0f, count);
+        event.wait();
+        const double t = (event.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+            - event.getProfilingInfo<CL_PROFILING_COMMAND_START>()) * 1.0e-9;
+        if (r == warmup || (r > warmup && t < best))
+            best = t;
+    }
+    return 2.0 * sizeof(cl_float4) * count / best / 1.0e9;
+}
+
+void gemv_release()
+{
+    gemv_kernels.clear();
+}
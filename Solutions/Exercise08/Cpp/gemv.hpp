@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: BLAS style matrix-vector products on device buffers
+//           (function prototypes)
+//
+//  PURPOSE: sgemv computes
+//
+//             y = alpha * op(A) * x + beta * y
+//
+//           with the arguments of the BLAS routine: row or column major
+//           storage of A, op(A) = A or A', and a leading dimension.  x and
+//           y are contiguous.  As with sgemm (gemm.hpp) the operands are
+//           cl::Buffers, each with an offset (in elements) to its first
+//           element.  sgemv_batched does the same for a batch of products
+//           of one shape, each at a stride from the last, in one launch.
+//           Calls only enqueue a kernel on the caller's queue, and kernels
+//           are built the first time they are needed for a device and kept
+//           until gemv_release().
+//
+//           A product reads each element of A once for two flops, so it is
+//           bound by memory bandwidth.  The kernels (C_gemv.cl) read A in
+//           the order it is stored with float4 loads: A stored by rows of
+//           op(A) runs gemv_rows, a work-group per block of rows with the
+//           dot products finished in local memory, and A stored by columns
+//           of op(A) runs gemv_cols, 4 elements of y per work-item.
+//
+//           Bad arguments throw cl::Error(CL_INVALID_VALUE).  These
+//           functions are part of libmatmul.a.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __GEMV_HDR
+#define __GEMV_HDR
+
+#include "gemm.hpp"
+
+#define GEMV_LANES 32    // work-items along a row of A in gemv_rows
+#define GEMV_ROWS  4     // rows of A per work-group of gemv_rows
+#define GEMV_CX    32    // work-items per work-group of gemv_cols, 4 rows each
+#define GEMV_CY    4     // work-items sharing the columns of those rows
+#define GEMV_STREAM_BYTES (256 * 1024 * 1024)   // largest stream_bandwidth() array
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue y = alpha * op(A) * x + beta * y, where op(A) is
+//  M x N, x has N elements and y M.  With row major storage lda is the
+//  distance between rows of A as stored (at least N, or M if A is
+//  transposed); with column major storage it is the distance between
+//  columns.  y is not read if beta is zero, and is only scaled by beta if
+//  N is zero.  Returns the kernel's event.
+//
+//------------------------------------------------------------------------------
+cl::Event sgemv(cl::CommandQueue& queue, GemmLayout layout, GemmTranspose trans,
+    int M, int N, float alpha, const cl::Buffer& A, size_t offA, int lda,
+    const cl::Buffer& x, size_t offX, float beta, cl::Buffer& y, size_t offY);
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue batch products like sgemv, product i on the matrix
+//  at offA + i * strideA in A and the vectors at offX + i * strideX in x
+//  and offY + i * strideY in y (in elements).  The y of the products must
+//  not overlap, so strideY is at least M when batch > 1.
+//
+//------------------------------------------------------------------------------
+cl::Event sgemv_batched(cl::CommandQueue& queue, GemmLayout layout, GemmTranspose trans,
+    int M, int N, float alpha, const cl::Buffer& A, size_t offA, int lda, int strideA,
+    const cl::Buffer& x, size_t offX, int strideX, float beta,
+    cl::Buffer& y, size_t offY, int strideY, int batch);
+
+//------------------------------------------------------------------------------
+//
+//  Function to measure the device's sustained global memory bandwidth in
+//  GB/s, the roof sgemv is held against (and the Bench harness's
+//  roofline): the fastest of reps runs, after warmup untimed ones, of the
+//  STREAM scale kernel (C_stream.cl) on arrays well past the size of any
+//  cache.  The queue must have profiling enabled.
+//
+//------------------------------------------------------------------------------
+double stream_bandwidth(cl::CommandQueue& queue, int warmup, int reps);
+
+//------------------------------------------------------------------------------
+//
+//  Function to drop the kernels built by sgemv and sgemv_batched
+//
+//------------------------------------------------------------------------------
+void gemv_release();
+
+#endif
@@ -0,0 +1,319 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Blocked, vectorised, multi-threaded matrix multiplication on the
+//           host CPU
+//
+//  PURPOSE: Compute C = A * B on the host fast enough to be an honest
+//           baseline for the OpenCL kernels.
+//
+//           The loops over C, A and B are blocked three times:
+//
+//             jc ... NC columns of B and C   (packed B panel lives in L3)
+//             pc ... KC deep slice of A and B (packed A block lives in L2)
+//             ic ... MC rows of A and C       (shared between threads)
+//
+//           Inside a block, the micro-kernel computes an MR x NR tile of C
+//           in registers from an MR wide sliver of packed A and an NR wide
+//           sliver of packed B (both live in L1).  Packing copies the
+//           slivers into contiguous, zero padded buffers, so the
+//           micro-kernel streams both operands with unit stride and edge
+//           tiles need no special cases.
+//
+//           The micro-kernel is picked at run time: AVX-512 (8x32) or
+//           AVX2 with FMA (6x16) when the CPU supports them, otherwise a
+//           plain C++ version (4x8) that the compiler can vectorise.
+//
+//------------------------------------------------------------------------------
+
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HOST_GEMM_X86
+#include <immintrin.h>
+#endif
+
+#include "host_gemm.hpp"
+
+// Cache block sizes: a KC x NC panel of B should fit in L3, an MC x KC
+// block of A in L2 and a KC deep sliver of each operand in L1
+#define KC 256
+#define MC 96
+#define NC 4096
+
+// Largest micro-tile of any kernel below (used for the edge buffer)
+#define MAX_MR 8
+#define MAX_NR 32
+
+//------------------------------------------------------------------------------
+//
+//  Micro-kernels: C(MR,NR) += Ap(kc,MR)^T * Bp(kc,NR)
+//
+//------------------------------------------------------------------------------
+typedef void (*micro_kernel_fn)(int kc, const float *Ap, const float *Bp, float *C, int ldc);
+
+struct MicroKernel
+{
+    int mr, nr;
+    micro_kernel_fn fn;
+    const char *name;
+};
+
+template <int MR, int NR>
+static void micro_kernel_generic(int kc, const float *Ap, const float *Bp, float *C, int ldc)
+{
+    float c[MR][NR];
+    for (int i = 0; i < MR; i++)
+        for (int j = 0; j < NR; j++)
+            c[i][j] = 0.0f;
+
+    for (int k = 0; k < kc; k++)
+    {
+        for (int i = 0; i < MR; i++)
+            for (int j = 0; j < NR; j++)
+                c[i][j] += Ap[i] * Bp[j];
+        Ap += MR;
+        Bp += NR;
+    }
+
+    for (int i = 0; i < MR; i++)
+        for (int j = 0; j < NR; j++)
+            C[i*ldc+j] += c[i][j];
+}
+
+#ifdef HOST_GEMM_X86
+__attribute__((target("avx2,fma")))
+static void micro_kernel_avx2(int kc, const float *Ap, const float *Bp, float *C, int ldc)
+{
+    // 6 x 16 tile: 12 ymm accumulators, 2 for B and 1 for A
+    __m256 c[6][2];
+    for (int i = 0; i < 6; i++)
+        c[i][0] = c[i][1] = _mm256_setzero_ps();
+
+    for (int k = 0; k < kc; k++)
+    {
+        const __m256 b0 = _mm256_loadu_ps(Bp);
+        const __m256 b1 = _mm256_loadu_ps(Bp + 8);
+        for (int i = 0; i < 6; i++)
+        {
+            const __m256 a = _mm256_broadcast_ss(Ap + i);
+            c[i][0] = _mm256_fmadd_ps(a, b0, c[i][0]);
+            c[i][1] = _mm256_fmadd_ps(a, b1, c[i][1]);
+        }
+        Ap += 6;
+        Bp += 16;
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        _mm256_storeu_ps(C + i*ldc,     _mm256_add_ps(_mm256_loadu_ps(C + i*ldc),     c[i][0]));
+        _mm256_storeu_ps(C + i*ldc + 8, _mm256_add_ps(_mm256_loadu_ps(C + i*ldc + 8), c[i][1]));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void micro_kernel_avx512(int kc, const float *Ap, const float *Bp, float *C, int ldc)
+{
+    // 8 x 32 tile: 16 zmm accumulators, 2 for B and 1 for A
+    __m512 c[8][2];
+    for (int i = 0; i < 8; i++)
+        c[i][0] = c[i][1] = _mm512_setzero_ps();
+
+    for (int k = 0; k < kc; k++)
+    {
+        const __m512 b0 = _mm512_loadu_ps(Bp);
+        const __m512 b1 = _mm512_loadu_ps(Bp + 16);
+        for (int i = 0; i < 8; i++)
+        {
+            const __m512 a = _mm512_set1_ps(Ap[i]);
+            c[i][0] = _mm512_fmadd_ps(a, b0, c[i][0]);
+            c[i][1] = _mm512_fmadd_ps(a, b1, c[i][1]);
+        }
+        Ap += 8;
+        Bp += 32;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        _mm512_storeu_ps(C + i*ldc,      _mm512_add_ps(_mm512_loadu_ps(C + i*ldc),      c[i][0]));
+        _mm512_storeu_ps(C + i*ldc + 16, _mm512_add_ps(_mm512_loadu_ps(C + i*ldc + 16), c[i][1]));
+    }
+}
+#endif
+
+static MicroKernel select_micro_kernel()
+{
+    MicroKernel kernel;
+#ifdef HOST_GEMM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        kernel.mr = 8; kernel.nr = 32;
+        kernel.fn = micro_kernel_avx512;
+        kernel.name = "AVX-512 8x32";
+        return kernel;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        kernel.mr = 6; kernel.nr = 16;
+        kernel.fn = micro_kernel_avx2;
+        kernel.name = "AVX2 6x16";
+        return kernel;
+    }
+#endif
+    kernel.mr = 4; kernel.nr = 8;
+    kernel.fn = micro_kernel_generic<4, 8>;
+    kernel.name = "scalar 4x8";
+    return kernel;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Packing: copy A(mc,kc) into MR wide slivers and B(kc,nc) into NR wide
+//  slivers, padding the last sliver with zeros
+//
+//------------------------------------------------------------------------------
+static void pack_A(int mc, int kc, const float *A, int lda, float *Ap, int mr)
+{
+    for (int ir = 0; ir < mc; ir += mr)
+    {
+        const int rows = std::min(mr, mc - ir);
+        for (int k = 0; k < kc; k++)
+        {
+            for (int i = 0; i < rows; i++)
+                Ap[i] = A[(ir+i)*lda + k];
+            for (int i = rows; i < mr; i++)
+                Ap[i] = 0.0f;
+            Ap += mr;
+        }
+    }
+}
+
+static void pack_B_sliver(int kc, int cols, const float *B, int ldb, float *Bp, int nr)
+{
+    for (int k = 0; k < kc; k++)
+    {
+        for (int j = 0; j < cols; j++)
+            Bp[j] = B[k*ldb + j];
+        for (int j = cols; j < nr; j++)
+            Bp[j] = 0.0f;
+        Bp += nr;
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Macro-kernel: C(mc,nc) += Ap(mc,kc) * Bp(kc,nc) one micro-tile at a time
+//
+//------------------------------------------------------------------------------
+static void macro_kernel(const MicroKernel& uk, int mc, int nc, int kc,
+    const float *Ap, const float *Bp, float *C, int ldc)
+{
+    float Cedge[MAX_MR*MAX_NR];
+
+    for (int jr = 0; jr < nc; jr += uk.nr)
+    {
+        const int cols = std::min(uk.nr, nc - jr);
+        for (int ir = 0; ir < mc; ir += uk.mr)
+        {
+            const int rows = std::min(uk.mr, mc - ir);
+            const float *a = Ap + ir*kc;
+            const float *b = Bp + jr*kc;
+            float *c = C + ir*ldc + jr;
+
+            if (rows == uk.mr && cols == uk.nr)
+            {
+                uk.fn(kc, a, b, c, ldc);
+            }
+            else
+            {
+                // Edge tile: compute the full tile into a buffer and
+                // add only the part that is inside C
+                memset(Cedge, 0, sizeof(float) * uk.mr * uk.nr);
+                uk.fn(kc, a, b, Cedge, uk.nr);
+                for (int i = 0; i < rows; i++)
+                    for (int j = 0; j < cols; j++)
+                        c[i*ldc+j] += Cedge[i*uk.nr+j];
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute C = A * B for row-major matrices
+//
+//------------------------------------------------------------------------------
+void host_sgemm(int M, int N, int K,
+    const float *A, int lda, const float *B, int ldb, float *C, int ldc)
+{
+    static const MicroKernel uk = select_micro_kernel();
+    const int mc_blk = (MC / uk.mr) * uk.mr;
+
+    for (int i = 0; i < M; i++)
+        memset(C + i*ldc, 0, sizeof(float) * N);
+
+    util::aligned_vector<float> Bp((size_t)KC * (NC + uk.nr));
+
+    for (int jc = 0; jc < N; jc += NC)
+    {
+        const int nc = std::min(NC, N - jc);
+
+        for (int pc = 0; pc < K; pc += KC)
+        {
+            const int kc = std::min(KC, K - pc);
+
+            #pragma omp parallel
+            {
+                // Every thread helps pack the shared B panel ...
+                #pragma omp for schedule(static)
+                for (int jr = 0; jr < nc; jr += uk.nr)
+                    pack_B_sliver(kc, std::min(uk.nr, nc - jr),
+                        B + pc*ldb + jc + jr, ldb, &Bp[jr*kc], uk.nr);
+
+                // ... then packs its own blocks of A and updates those rows of C
+                util::aligned_vector<float> Ap((size_t)(mc_blk + uk.mr) * KC);
+
+                #pragma omp for schedule(dynamic)
+                for (int ic = 0; ic < M; ic += mc_blk)
+                {
+                    const int mc = std::min(mc_blk, M - ic);
+                    pack_A(mc, kc, A + ic*lda + pc, lda, &Ap[0], uk.mr);
+                    macro_kernel(uk, mc, nc, kc, &Ap[0], &Bp[0], C + ic*ldc + jc, ldc);
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute the product of packed A(M,K) and B(K,N) with host_sgemm
+//
+//------------------------------------------------------------------------------
+void host_mat_mul(int M, int N, int K, util::aligned_vector<float>& A, util::aligned_vector<float>& B, util::aligned_vector<float>& C)
+{
+    host_sgemm(M, N, K, &A[0], K, &B[0], N, &C[0], N);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to describe the micro-kernel and thread count host_sgemm will use
+//
+//------------------------------------------------------------------------------
+const char *host_gemm_info()
+{
+    static char info[64];
+    MicroKernel uk = select_micro_kernel();
+#ifdef _OPENMP
+    sprintf(info, "%s micro-kernel, %d threads", uk.name, omp_get_max_threads());
+#else
+    sprintf(info, "%s micro-kernel, 1 thread", uk.name);
+#endif
+    return info;
+}
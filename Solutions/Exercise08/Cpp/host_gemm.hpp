@@ -0,0 +1,45 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Blocked, vectorised, multi-threaded matrix multiplication on the
+//           host CPU (function prototypes)
+//
+//  PURPOSE: A fair host baseline for the OpenCL kernels.  The product is
+//           computed the way optimised BLAS libraries do it: B and A are
+//           copied into packed panels sized for the L3, L2 and L1 caches,
+//           and a small register blocked micro-kernel (AVX-512, AVX2 or
+//           plain C++) does the multiply-adds.  Blocks of rows of C are
+//           shared between threads with OpenMP.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __HOST_GEMM_HDR
+#define __HOST_GEMM_HDR
+
+#include <vector>
+
+#include "aligned_allocator.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute C = A * B for row-major matrices, A(M,K), B(K,N) and
+//  C(M,N) with leading dimensions lda, ldb and ldc
+//
+//------------------------------------------------------------------------------
+void host_sgemm(int M, int N, int K,
+    const float *A, int lda, const float *B, int ldb, float *C, int ldc);
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute the product of packed A(M,K) and B(K,N) with host_sgemm
+//
+//------------------------------------------------------------------------------
+void host_mat_mul(int M, int N, int K, util::aligned_vector<float>& A, util::aligned_vector<float>& B, util::aligned_vector<float>& C);
+
+//------------------------------------------------------------------------------
+//
+//  Function to describe the micro-kernel and thread count host_sgemm will use
+//
+//------------------------------------------------------------------------------
+const char *host_gemm_info();
+
+#endif
@@ -0,0 +1,11 @@
+#
+# The kernels of libmatmul.a, for every program that embeds them: set
+# MMUL_CL_DIR to the directory of the .cl files first
+#
+
+MMUL_KERNELS = $(addprefix $(MMUL_CL_DIR)/, \
+	C_elem.cl C_row.cl C_row_priv.cl C_row_priv_bloc.cl \
+	C_trans.cl C_elem_bt.cl C_row_priv_bt.cl \
+	C_block_form.cl C_block_db.cl C_block_reg.cl C_batched.cl \
+	C_spmv_csr.cl C_spmv_sell.cl C_spmm_csr.cl C_gemm.cl \
+	C_epilogue.cl C_splitk.cl C_gemv.cl C_stream.cl)
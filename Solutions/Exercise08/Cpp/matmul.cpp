@@ -7,47 +7,930 @@
 //
 //                C  = A * B
 //
-//           A and B are set to constant matrices so we
-//           can make a quick test of the multiplication.
+//           A and B are random matrices, and every product is
+//           checked against them.
 //
-//  USAGE:   The matrices are constant matrices, square and the order is
-//           set as a constant, ORDER (see mult.h).
+//  USAGE:   By default the matrices are square and the order is set as
+//           a constant, ORDER (see matmul.hpp).  Run with --size M N K to
+//           multiply an M x K matrix A by a K x N matrix B instead; sizes
+//           that are not multiples of the block sizes are handled by the
+//           kernels.
+//
+//           Run with --tune to search for the best block sizes of the
+//           blocked kernels on the chosen device.  The result is saved in
+//           TUNE_DB and used by later runs without searching again.
+//
+//           The host baseline uses the blocked, vectorised and threaded
+//           engine in host_gemm.cpp.  Run with --host-naive to use the
+//           original triple loop (seq_mat_mul_sdot) instead.
+//
+//           Run with --precision to also run the blocked kernel with
+//           fp32, fp64, fp16 and int8 storage (see precision.hpp) on
+//           random matrices, reporting each one's error against a
+//           product computed in fp64 on the host.
+//
+//           Run with --stream to multiply matrices that need not fit in
+//           device memory: A, B and C are streamed through the device in
+//           tiles (see stream.cpp) and the other tests are skipped.  Add
+//           --stream-mem MB to limit the device memory it uses.
+//
+//           Run with --pipeline JOBS to multiply JOBS independent pairs
+//           of random matrices as a job stream (see pipeline.cpp): the
+//           upload of one job, the kernel of the next and the download
+//           and check of the one before overlap.  The single job latency
+//           and the sustained jobs/s are reported, and the other tests
+//           are skipped.
+//
+//           Run with --auto to multiply through the library entry point
+//           matmul() (see dispatch.cpp), which runs only the kernel its
+//           cost model expects to be fastest for the device and the
+//           shape.  The predicted time of every kernel is printed, and
+//           the other tests are skipped.  The model is calibrated from
+//           the results of the benchmark harness (DISPATCH_DB) when they
+//           cover the device.
+//
+//           Run with --blas to check the BLAS style sgemm and dgemm of
+//           libmatmul.a (see gemm.hpp) with every combination of layout
+//           and transposes, alpha and beta, padded leading dimensions and
+//           offsets into the buffers, and the other tests are skipped.
+//
+//           Run with --epilogue OPS, a list such as scale,bias,gelu,residual
+//           (see epilogue.hpp), to run the blocked kernels with those
+//           element-wise operations on C fused into their store, against
+//           the product followed by one pass over C per operation.  The
+//           kernel times and the global memory traffic of the epilogue
+//           each way are reported, and the other tests are skipped.
+//
+//           Run with --double-buffer to time the blocked kernel against
+//           its double buffered variant (C_block_db.cl), which fetches
+//           the next blocks of A and B while it computes on the current
+//           ones, for square matrices of order DB_MIN to DB_MAX and the
+//           --size shape.  The other tests are skipped.  The variant is
+//           also run with the other kernels by default.
+//
+//           Run with --split-k to time the blocked kernel against
+//           split-K (C_splitk.cl), which also cuts K into slices run by
+//           separate work-groups and adds up their partial products, for
+//           a SPLITK_MN square C with K from SPLITK_K_MIN to SPLITK_K_MAX
+//           and for the --size shape.  Each line ends with the kernel
+//           the dispatcher picks for the shape; it picks split-K by
+//           itself when C has too few blocks to fill the device.  The
+//           other tests are skipped.
+//
+//           Run with --gemv to time the matrix-vector products of
+//           libmatmul.a (sgemv and sgemv_batched, see gemv.hpp), which are
+//           bound by memory bandwidth.  Every layout and transpose is run
+//           on square A of order GEMV_MIN to GEMV_MAX and on the M x N of
+//           --size, then GEMV_BATCH small products are run as one batch
+//           and one call at a time.  The GB/s reached is reported against
+//           the device's stream bandwidth, and the other tests are skipped.
+//
+//           Run with --load A.mat B.mat to multiply matrices read from
+//           binary matrix files (see Cpp_common/matrix_file.hpp) instead
+//           of the generated ones, and add --store C.mat to write the
+//           product to one.  The files are memory mapped and row major
+//           float elements back the device buffers directly
+//           (CL_MEM_USE_HOST_PTR), so nothing is parsed or copied on the
+//           host.  The load and store times and bandwidths are reported
+//           next to the kernel time, and the other tests are skipped.
+//           Run with --save-inputs A.mat B.mat to write the generated
+//           A and B (of --size, and --constant) to files and exit.
+//
+//           Run with --multi to split the product across every OpenCL
+//           device found (see multi.cpp) instead of running the tests on
+//           one device.
+//
+//           The row kernels are also run with B transposed on the device
+//           first (C_trans.cl), so both operands are read contiguously.
+//           The driver reports the bandwidth of the transpose and whether
+//           it pays for itself at this size.
+//
+//           The row kernel with A in private memory is also run with the
+//           matrices in each buffer mode of host_buffer.hpp (copy,
+//           CL_MEM_USE_HOST_PTR, CL_MEM_ALLOC_HOST_PTR and SVM), reporting
+//           the time spent moving them between host and device.  Host
+//           matrices are page aligned so CL_MEM_USE_HOST_PTR need not copy.
+//
+//           The queue is created with profiling enabled.  After each
+//           variant's results the driver prints the breakdown taken from
+//           the kernel's and the copies' events (see profile.cpp): queue
+//           and launch latency, kernel time and MFLOPS, and the time and
+//           bandwidth of the transfers.
+//
+//           Programs are built through the binary cache in
+//           program_cache.hpp; the driver prints whether each one came
+//           from source (cold) or from the cache (warm) and how long the
+//           build took.  Set CL_CACHE_DIR=off to always build from source.
+//
+//           A and B are random in [-1, 1] (seeded with RAND_SEED), as
+//           constant matrices hide indexing errors.  Run with --constant
+//           to use the constant matrices of initmat() instead.  Every
+//           product is checked with Freivalds' algorithm (freivalds() in
+//           matrix_lib.cpp): C*r against A*(B*r) for random vectors r,
+//           which is O(N^2) work, so large runs are checked cheaply.
 //
 //  HISTORY: Written by Tim Mattson, August 2010 
 //           Modified by Simon McIntosh-Smith, September 2011
 //           Modified by Tom Deakin and Simon McIntosh-Smith, October 2012
 //           Updated to C++ Wrapper v1.2.6 by Tom Deakin, August 2013
 //           Modified to assume square matricies by Tom Deakin, October 2014
+//           Extended to rectangular M x N x K matrices
 //
 //------------------------------------------------------------------------------
 
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
 #include "matmul.hpp"
 #include "matrix_lib.hpp"
+#include "tuner.hpp"
+#include "host_gemm.hpp"
+#include "stream.hpp"
+#include "multi.hpp"
+#include "pipeline.hpp"
+#include "dispatch.hpp"
+#include "gemm.hpp"
+#include "gemv.hpp"
+#include "epilogue.hpp"
+#include "profile.hpp"
 #include "util.hpp"
+#include "host_buffer.hpp"
+#include "matrix_file.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
 #include "err_code.h"
 #include "device_picker.hpp"
 
+//------------------------------------------------------------------------------
+//
+//  Function to run the blocked kernel with A and B stored as type T and
+//  print its speed and its error relative to the fp64 product Cref
+//
+//------------------------------------------------------------------------------
+template <typename T>
+static void run_precision(cl::Context& context, cl::CommandQueue& queue,
+    const TuneParams& params, int M, int N, int K,
+    util::aligned_vector<double>& r_A, util::aligned_vector<double>& r_B, util::aligned_vector<double>& Cref)
+{
+    typedef typename precision<T>::acc_t Acc;
+    typedef typename precision<T>::out_t TC;
+
+    util::Timer timer;
+    double start_time, run_time;
+
+    util::aligned_vector<T>  h_A(M*K);
+    util::aligned_vector<T>  h_B(K*N);
+    util::aligned_vector<TC> h_C(M*N);
+
+    quantize(M, K, r_A, h_A);
+    quantize(K, N, r_B, h_B);
+
+    cl::Buffer d_a(context, h_A.begin(), h_A.end(), true);
+    cl::Buffer d_b(context, h_B.begin(), h_B.end(), true);
+    cl::Buffer d_c(context, CL_MEM_WRITE_ONLY, sizeof(TC) * M*N);
+
+    cl::Program program = util::buildProgram(context, util::kernelSource("C_block_form.cl"),
+        block_options(params, M, N, K) + precision<T>::options());
+
+    cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg> block_mmul(program, "mmul");
+
+    // The blocks are held in local memory in the accumulator type
+    int blocksize = params.blksz;
+    cl::LocalSpaceArg A_block = cl::Local(sizeof(Acc) * blocksize*blocksize);
+    cl::LocalSpaceArg B_block = cl::Local(sizeof(Acc) * blocksize*blocksize);
+
+    start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
+
+    block_mmul(
+        cl::EnqueueArgs(
+            queue,
+            cl::NDRange(ROUND_UP(N, blocksize), ROUND_UP(M, blocksize)),
+            cl::NDRange(blocksize,blocksize)),
+        M, N, K, d_a, d_b, d_c, A_block, B_block);
+
+    queue.finish();
+
+    run_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
+
+    cl::copy(queue, d_c, h_C.begin(), h_C.end());
+
+    const double scale = precision<T>::scale();
+    printf(" %-24s %.2f seconds at %.1f MFLOPS, relative error %.2e\n",
+        precision<T>::name(), run_time, 2.0 * M * N * K / (1000000.0 * run_time),
+        ref_error(M, N, h_C, scale * scale, Cref));
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run sgemm or dgemm (T float or double) for every layout and
+//  pair of transposes on random matrices stored with padded leading
+//  dimensions at offsets into their buffers, and for a packed C = A * B.
+//  Each C is checked like freivalds(): C*r against
+//  alpha*op(A)*(op(B)*r) + beta*C0*r for a random vector r.
+//
+//------------------------------------------------------------------------------
+template <typename T>
+static int run_blas(cl::Context& context, cl::CommandQueue& queue, const char *routine,
+    cl::Event (*gemm)(cl::CommandQueue&, GemmLayout, GemmTranspose, GemmTranspose,
+        int, int, int, T, const cl::Buffer&, size_t, int, const cl::Buffer&, size_t, int,
+        T, cl::Buffer&, size_t, int),
+    int M, int N, int K)
+{
+    const int pad = 3, off = 5;     // extra elements per line and before each matrix
+    int failed = 0;
+
+    srand(RAND_SEED);
+    for (int c = 0; c < 9; c++)
+    {
+        // Eight general calls, then a packed row major C = A * B
+        const bool packed = c == 8;
+        const GemmLayout    layout = (c & 4) ? GemmColMajor : GemmRowMajor;
+        const GemmTranspose transA = (c & 2) ? GemmTrans : GemmNoTrans;
+        const GemmTranspose transB = (c & 1) ? GemmTrans : GemmNoTrans;
+        const T alpha = packed ? (T)1 : (T)1.5, beta = packed ? (T)0 : (T)0.5;
+        const int p = packed ? 0 : pad;
+        const size_t o = packed ? 0 : off;
+
+        // op(X) is rows x cols, stored (transposed if trans) in lines of
+        // ld elements: rows if row major, columns if column major
+        struct Stored
+        {
+            int rows, cols, ld;
+            bool trans, rowmajor;
+            int lines() const { return (rowmajor != trans) ? rows : cols; }
+            int used()  const { return (rowmajor != trans) ? cols : rows; }
+            size_t size() const { return (size_t)lines() * ld; }
+            size_t at(int i, int j) const
+            {
+                if (trans)
+                    std::swap(i, j);
+                return rowmajor ? (size_t)i * ld + j : (size_t)j * ld + i;
+            }
+        };
+        const bool rm = layout == GemmRowMajor;
+        Stored a = { M, K, 0, transA == GemmTrans, rm };
+        Stored b = { K, N, 0, transB == GemmTrans, rm };
+        Stored x = { M, N, 0, false, rm };
+        a.ld = a.used() + p;
+        b.ld = b.used() + p;
+        x.ld = x.used() + p;
+
+        util::aligned_vector<T> h_A(o + a.size()), h_B(o + b.size()), h_C(o + x.size());
+        for (size_t i = 0; i < h_A.size(); i++) h_A[i] = (T)(2.0 * rand() / RAND_MAX - 1.0);
+        for (size_t i = 0; i < h_B.size(); i++) h_B[i] = (T)(2.0 * rand() / RAND_MAX - 1.0);
+        for (size_t i = 0; i < h_C.size(); i++) h_C[i] = (T)(2.0 * rand() / RAND_MAX - 1.0);
+        const util::aligned_vector<T> h_C0(h_C);
+
+        cl::Buffer d_a(context, h_A.begin(), h_A.end(), true);
+        cl::Buffer d_b(context, h_B.begin(), h_B.end(), true);
+        cl::Buffer d_c(context, h_C.begin(), h_C.end(), false);
+
+        cl::Event event = gemm(queue, layout, transA, transB, M, N, K,
+            alpha, d_a, o, a.ld, d_b, o, b.ld, beta, d_c, o, x.ld);
+        event.wait();
+        const double seconds = profile_seconds(event);
+        cl::copy(queue, d_c, h_C.begin(), h_C.end());
+
+        // Residual of C*r, relative to the rms of the reference
+        std::vector<double> r(N), br(K, 0.0);
+        for (int j = 0; j < N; j++)
+            r[j] = 2.0 * rand() / RAND_MAX - 1.0;
+        for (int k = 0; k < K; k++)
+            for (int j = 0; j < N; j++)
+                br[k] += (double)h_B[o + b.at(k, j)] * r[j];
+        double err = 0.0, norm = 0.0;
+        for (int i = 0; i < M; i++)
+        {
+            double ref = 0.0, got = 0.0, c0 = 0.0;
+            for (int k = 0; k < K; k++)
+                ref += (double)h_A[o + a.at(i, k)] * br[k];
+            for (int j = 0; j < N; j++)
+            {
+                got += (double)h_C[o + x.at(i, j)] * r[j];
+                c0  += (double)h_C0[o + x.at(i, j)] * r[j];
+            }
+            ref = alpha * ref + beta * c0;
+            err  += (got - ref) * (got - ref);
+            norm += ref * ref;
+        }
+        const double residual = sqrt(err / std::max(norm, 1.0e-300));
+        const bool ok = !std::isnan(residual) && residual <= FREIVALDS_TOL(K);
+        failed += !ok;
+
+        if (packed)
+            printf(" %s packed row major NN, alpha 1, beta 0 ", routine);
+        else
+            printf(" %s %s %c%c, lds %4d %4d %4d  ", routine, rm ? "row major" : "col major",
+                a.trans ? 'T' : 'N', b.trans ? 'T' : 'N', a.ld, b.ld, x.ld);
+        printf("%10.3f ms %10.1f MFLOPS  residual %.1e%s\n", seconds * 1.0e3,
+            2.0 * M * N * K / seconds / 1.0e6, residual, ok ? "" : "  FAILED");
+    }
+    return failed;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to time the blocked kernel and its double buffered variant on
+//  random M x K and K x N matrices: the fastest of DB_REPS runs of each,
+//  from the kernel events.  Returns false if either product is wrong.
+//
+//------------------------------------------------------------------------------
+static bool run_double_buffer(cl::Context& context, cl::Device& device, cl::CommandQueue& queue,
+    int M, int N, int K)
+{
+    TuneParams params = default_tune_params();
+    const bool tuned = load_tuning(TUNE_DB, device, M, N, K, params);
+    const int b = params.blksz;
+
+    util::aligned_vector<float> h_A((size_t)M*K), h_B((size_t)K*N), h_C((size_t)M*N);
+    initmat_random(M, N, K, h_A, h_B, h_C);
+
+    cl::Buffer d_a(context, h_A.begin(), h_A.end(), true);
+    cl::Buffer d_b(context, h_B.begin(), h_B.end(), true);
+    cl::Buffer d_c(context, CL_MEM_WRITE_ONLY, sizeof(float) * (size_t)M*N);
+
+    const char *sources[2] = { "C_block_form.cl", "C_block_db.cl" };
+    double best[2];
+    bool ok = true;
+    for (int v = 0; v < 2; v++)
+    {
+        cl::Program program = util::buildProgram(context, util::kernelSource(sources[v]),
+            block_options(params, M, N, K));
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg> mmul(program, "mmul");
+
+        // The double buffered kernel holds two blocks of each operand
+        cl::LocalSpaceArg A_block = cl::Local(sizeof(float) * (v + 1) * b*b);
+        cl::LocalSpaceArg B_block = cl::Local(sizeof(float) * (v + 1) * b*b);
+
+        best[v] = 0.0;
+        for (int r = 0; r < DB_REPS; r++)
+        {
+            cl::Event event = mmul(cl::EnqueueArgs(queue,
+                    cl::NDRange(ROUND_UP(N, b), ROUND_UP(M, b)), cl::NDRange(b, b)),
+                M, N, K, d_a, d_b, d_c, A_block, B_block);
+            event.wait();
+            const double t = profile_seconds(event);
+            if (r == 0 || t < best[v])
+                best[v] = t;
+        }
+
+        cl::copy(queue, d_c, h_C.begin(), h_C.end());
+        const double residual = freivalds(M, N, K, h_A, h_B, h_C, FREIVALDS_ROUNDS);
+        ok = ok && !std::isnan(residual) && residual <= FREIVALDS_TOL(K);
+    }
+
+    const double flops = 2.0 * M * N * K;
+    printf(" %5d x %5d x %5d  blksz %2d%s  %10.3f ms %8.1f MFLOPS  %10.3f ms %8.1f MFLOPS  %5.2fx%s\n",
+        M, N, K, b, tuned ? "*" : " ",
+        best[0] * 1.0e3, flops / best[0] / 1.0e6, best[1] * 1.0e3, flops / best[1] / 1.0e6,
+        best[0] / best[1], ok ? "" : "  FAILED");
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to time the blocked kernel and split-K (C_splitk.cl) through
+//  the dispatcher on random M x K and K x N matrices, the fastest of
+//  SPLITK_REPS runs of each, and to report the kernel the dispatcher
+//  chooses for the shape.  Returns false if either product is wrong.
+//
+//------------------------------------------------------------------------------
+static bool run_split_k(cl::Context& context, cl::CommandQueue& queue,
+    MatmulDispatcher& dispatcher, int M, int N, int K)
+{
+    util::aligned_vector<float> h_A((size_t)M*K), h_B((size_t)K*N), h_C((size_t)M*N);
+    initmat_random(M, N, K, h_A, h_B, h_C);
+
+    cl::Buffer d_a(context, h_A.begin(), h_A.end(), true);
+    cl::Buffer d_b(context, h_B.begin(), h_B.end(), true);
+    cl::Buffer d_c(context, CL_MEM_WRITE_ONLY, sizeof(float) * (size_t)M*N);
+
+    // split_k only runs when the dispatcher would cut K into slices
+    const int slices = dispatcher.slices(M, N, K);
+    const char *variants[2] = { "block", "split_k" };
+    double best[2] = { 0.0, 0.0 };
+    bool ok = true;
+    for (int v = 0; v < (slices > 1 ? 2 : 1); v++)
+    {
+        for (int r = 0; r < SPLITK_REPS; r++)
+        {
+            cl::Event first;
+            cl::Event event = dispatcher.run_variant(variants[v], queue, M, N, K,
+                d_a, d_b, d_c, &first);
+            event.wait();
+            const double t = profile_seconds(first, event);
+            if (r == 0 || t < best[v])
+                best[v] = t;
+        }
+
+        cl::copy(queue, d_c, h_C.begin(), h_C.end());
+        const double residual = freivalds(M, N, K, h_A, h_B, h_C, FREIVALDS_ROUNDS);
+        ok = ok && !std::isnan(residual) && residual <= FREIVALDS_TOL(K);
+    }
+
+    const std::vector<DispatchChoice> choices = dispatcher.rank(M, N, K);
+    const double flops = 2.0 * M * N * K;
+    printf(" %5d x %5d x %8d  %10.3f ms %8.1f MFLOPS  ", M, N, K,
+        best[0] * 1.0e3, flops / best[0] / 1.0e6);
+    if (slices > 1)
+        printf("%3d slices %10.3f ms %8.1f MFLOPS  %5.2fx", slices,
+            best[1] * 1.0e3, flops / best[1] / 1.0e6, best[0] / best[1]);
+    else
+        printf("%-48s", "  K not split");
+    printf("  %s%s\n", choices[0].variant.c_str(), ok ? "" : "  FAILED");
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute y = alpha * op(A) * x + beta * y on the host in
+//  double, for a packed A (the reference of the sgemv checks)
+//
+//------------------------------------------------------------------------------
+static void gemv_host(GemmLayout layout, GemmTranspose trans, int M, int N, float alpha,
+    const float *A, const float *x, float beta, float *y)
+{
+    const bool cols = (layout == GemmRowMajor) != (trans == GemmNoTrans);
+    for (int i = 0; i < M; i++)
+    {
+        double sum = 0.0;
+        for (int j = 0; j < N; j++)
+            sum += (double)(cols ? A[(size_t)j*M + i] : A[(size_t)i*N + j]) * x[j];
+        y[i] = (float)(alpha * sum + (beta == 0.0f ? 0.0 : (double)beta * y[i]));
+    }
+}
+
+// Largest difference of y from ref, relative to the largest element of ref
+static double gemv_error(const util::aligned_vector<float>& y, const util::aligned_vector<float>& ref)
+{
+    double err = 0.0, scale = 1.0e-30;
+    for (size_t i = 0; i < y.size(); i++)
+    {
+        err   = std::max(err, (double)fabs(y[i] - ref[i]));
+        scale = std::max(scale, (double)fabs(ref[i]));
+    }
+    return std::isnan(err) ? err : err / scale;
+}
+
+static const struct
+{
+    GemmLayout    layout;
+    GemmTranspose trans;
+}
+gemv_cases[4] =
+{
+    { GemmRowMajor, GemmNoTrans }, { GemmRowMajor, GemmTrans },
+    { GemmColMajor, GemmNoTrans }, { GemmColMajor, GemmTrans }
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to time sgemv on a random packed M x N op(A), in each layout
+//  and with and without the transpose, the fastest of GEMV_REPS runs from
+//  the kernel events, and report the bandwidth reached against peak.
+//  Returns the number of products that failed the check.
+//
+//------------------------------------------------------------------------------
+static int run_gemv(cl::Context& context, cl::CommandQueue& queue, int M, int N, double peak)
+{
+    util::aligned_vector<double> r((size_t)M * N);
+    util::aligned_vector<float> h_A((size_t)M * N), h_x(N), h_y0(M), h_y(M), ref(M);
+    randmat(M, N, r);
+    std::copy(r.begin(), r.end(), h_A.begin());
+    randmat(1, N, r);
+    std::copy(r.begin(), r.begin() + N, h_x.begin());
+    randmat(1, M, r);
+    std::copy(r.begin(), r.begin() + M, h_y0.begin());
+
+    cl::Buffer d_a(context, h_A.begin(), h_A.end(), true);
+    cl::Buffer d_x(context, h_x.begin(), h_x.end(), true);
+    cl::Buffer d_y(context, CL_MEM_READ_WRITE, sizeof(float) * M);
+
+    const float alpha = 1.5f, beta = 0.5f;
+    const double bytes = sizeof(float) * ((double)M * N + N + 2.0 * M);
+    int failed = 0;
+    for (int c = 0; c < 4; c++)
+    {
+        const GemmLayout    layout = gemv_cases[c].layout;
+        const GemmTranspose trans  = gemv_cases[c].trans;
+        const bool cols = (layout == GemmRowMajor) != (trans == GemmNoTrans);
+
+        // The stored A is M x N by rows or N x M, packed either way
+        const int lda = (layout == GemmRowMajor) == (trans == GemmNoTrans) ? N : M;
+        double best = 0.0;
+        for (int rep = 0; rep < GEMV_REPS; rep++)
+        {
+            cl::copy(queue, h_y0.begin(), h_y0.end(), d_y);
+            cl::Event event = sgemv(queue, layout, trans, M, N, alpha, d_a, 0, lda,
+                d_x, 0, beta, d_y, 0);
+            event.wait();
+            const double t = profile_seconds(event);
+            if (rep == 0 || t < best)
+                best = t;
+        }
+
+        cl::copy(queue, d_y, h_y.begin(), h_y.end());
+        std::copy(h_y0.begin(), h_y0.end(), ref.begin());
+        gemv_host(layout, trans, M, N, alpha, &h_A[0], &h_x[0], beta, &ref[0]);
+        const double err = gemv_error(h_y, ref);
+        const bool ok = err <= TOL;
+        failed += !ok;
+
+        printf(" %5d x %5d  %s %c  %-9s %10.3f ms %8.2f GB/s %5.1f%% of peak  error %.1e%s\n",
+            M, N, layout == GemmRowMajor ? "row major" : "col major", trans == GemmTrans ? 'T' : 'N',
+            cols ? "gemv_cols" : "gemv_rows", best * 1.0e3, bytes / best / 1.0e9,
+            100.0 * bytes / best / 1.0e9 / peak, err, ok ? "" : "  FAILED");
+    }
+    return failed;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to time GEMV_BATCH products of order n as one sgemv_batched
+//  launch against one sgemv call each (from the start of the first kernel
+//  to the end of the last), with and without the transpose.  Returns the
+//  number of batches that failed the check.
+//
+//------------------------------------------------------------------------------
+static int run_gemv_batched(cl::Context& context, cl::CommandQueue& queue, int n, int batch,
+    double peak)
+{
+    const int size = n * n;
+    util::aligned_vector<double> r((size_t)batch * size);
+    util::aligned_vector<float> h_A((size_t)batch * size), h_x((size_t)batch * n);
+    util::aligned_vector<float> h_y((size_t)batch * n), ref((size_t)batch * n);
+    randmat(batch, size, r);
+    std::copy(r.begin(), r.end(), h_A.begin());
+    randmat(batch, n, r);
+    std::copy(r.begin(), r.begin() + h_x.size(), h_x.begin());
+
+    cl::Buffer d_a(context, h_A.begin(), h_A.end(), true);
+    cl::Buffer d_x(context, h_x.begin(), h_x.end(), true);
+    cl::Buffer d_y(context, CL_MEM_READ_WRITE, sizeof(float) * h_y.size());
+
+    const double bytes = sizeof(float) * ((double)size + 2.0 * n) * batch;
+    int failed = 0;
+    for (int c = 0; c < 2; c++)
+    {
+        const GemmTranspose trans = gemv_cases[c].trans;
+        double best[2] = { 0.0, 0.0 };
+        for (int rep = 0; rep < GEMV_REPS; rep++)
+        {
+            cl::Event event = sgemv_batched(queue, GemmRowMajor, trans, n, n, 1.0f,
+                d_a, 0, n, size, d_x, 0, n, 0.0f, d_y, 0, n, batch);
+            event.wait();
+            double t = profile_seconds(event);
+            if (rep == 0 || t < best[0])
+                best[0] = t;
+
+            cl::Event first, last;
+            for (int b = 0; b < batch; b++)
+            {
+                last = sgemv(queue, GemmRowMajor, trans, n, n, 1.0f, d_a, (size_t)b * size, n,
+                    d_x, (size_t)b * n, 0.0f, d_y, (size_t)b * n);
+                if (b == 0)
+                    first = last;
+            }
+            last.wait();
+            t = profile_seconds(first, last);
+            if (rep == 0 || t < best[1])
+                best[1] = t;
+        }
+
+        cl::copy(queue, d_y, h_y.begin(), h_y.end());
+        for (int b = 0; b < batch; b++)
+            gemv_host(GemmRowMajor, trans, n, n, 1.0f, &h_A[(size_t)b * size],
+                &h_x[(size_t)b * n], 0.0f, &ref[(size_t)b * n]);
+        const double err = gemv_error(h_y, ref);
+        const bool ok = err <= TOL;
+        failed += !ok;
+
+        printf(" %5d x %3d x %3d  %c  batched %10.3f ms %8.2f GB/s %5.1f%% of peak,  "
+               "one call each %10.3f ms (%.2fx)  error %.1e%s\n",
+            batch, n, n, trans == GemmTrans ? 'T' : 'N', best[0] * 1.0e3, bytes / best[0] / 1.0e9,
+            100.0 * bytes / best[0] / 1.0e9 / peak, best[1] * 1.0e3, best[1] / best[0], err,
+            ok ? "" : "  FAILED");
+    }
+    return failed;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the elements of a matrix file as a row major float
+//  array: the mapping itself when the file holds one, else a converted
+//  copy in copy
+//
+//------------------------------------------------------------------------------
+static float *file_matrix(util::MatrixFile& file, util::aligned_vector<float>& copy)
+{
+    float *f = file.as<float>();
+    if (f && file.layout() == util::MATRIX_ROW_MAJOR)
+        return f;
+
+    const size_t rows = file.rows(), cols = file.cols();
+    const bool col_major = file.layout() == util::MATRIX_COL_MAJOR;
+    const double *d = file.as<double>();
+    copy.resize(rows * cols);
+    for (size_t i = 0; i < rows; i++)
+        for (size_t j = 0; j < cols; j++)
+        {
+            const size_t at = col_major ? j * rows + i : i * cols + j;
+            copy[i * cols + j] = d ? (float)d[at] : f[at];
+        }
+    return &copy[0];
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to multiply the matrices in two files with the dispatched
+//  kernel, writing the product to a third unless its name is empty
+//
+//------------------------------------------------------------------------------
+static int run_files(cl::Context& context, cl::Device& device, cl::CommandQueue& queue,
+    const std::string& file_a, const std::string& file_b, const std::string& file_c)
+{
+    util::Timer timer;
+    util::MatrixFile fa, fb, fc;
+    util::aligned_vector<float> copy_a, copy_b, h_C;
+
+    // Load: map the files, fault their pages in and hand the elements to
+    // the device, which reads them straight from the page cache.  Mapping
+    // alone reads nothing, so without the prefault the file reads would
+    // land in the kernel time instead
+    uint64_t start = timer.getTimeMicroseconds();
+    if (!fa.open(file_a) || !fb.open(file_b))
+    {
+        std::cout << (fa.error().empty() ? fb.error() : fa.error()) << "\n";
+        return EXIT_FAILURE;
+    }
+    if (fb.rows() != fa.cols())
+    {
+        std::cout << "A is " << fa.rows() << " x " << fa.cols() << " but B is "
+                  << fb.rows() << " x " << fb.cols() << "\n";
+        return EXIT_FAILURE;
+    }
+    if (fa.rows() > INT_MAX || fa.cols() > INT_MAX || fb.cols() > INT_MAX)
+    {
+        std::cout << "A is " << fa.rows() << " x " << fa.cols() << " and B is "
+                  << fb.rows() << " x " << fb.cols() << ": too large\n";
+        return EXIT_FAILURE;
+    }
+    const int M = (int)fa.rows(), K = (int)fa.cols(), N = (int)fb.cols();
+
+    fa.prefault();
+    fb.prefault();
+    float *A = file_matrix(fa, copy_a);
+    float *B = file_matrix(fb, copy_b);
+    cl::Buffer d_a(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, sizeof(float) * (size_t)M * K, A);
+    cl::Buffer d_b(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, sizeof(float) * (size_t)K * N, B);
+    std::vector<cl::Memory> inputs;
+    inputs.push_back(d_a);
+    inputs.push_back(d_b);
+    queue.enqueueMigrateMemObjects(inputs, 0);
+    queue.finish();
+    const double load_time = (timer.getTimeMicroseconds() - start) / 1.0e6;
+
+    // The product goes straight into the mapping of the output file
+    const size_t Cbytes = sizeof(float) * (size_t)M * N;
+    float *C;
+    if (!file_c.empty())
+    {
+        if (!fc.create(file_c, M, N))
+        {
+            std::cout << fc.error() << "\n";
+            return EXIT_FAILURE;
+        }
+        // Counted in the store time through fc.seconds()
+        fc.prefault();
+        C = fc.as<float>();
+    }
+    else
+    {
+        h_C.resize((size_t)M * N);
+        C = &h_C[0];
+    }
+    cl::Buffer d_c(context, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, Cbytes, C);
+
+    printf("\n===== Matrix mult of %s and %s, %d x %d x %d on device ======\n",
+        file_a.c_str(), file_b.c_str(), M, N, K);
+    printf(" A  %s %s, %s\n", fa.type() == util::MATRIX_DOUBLE ? "double" : "float",
+        fa.layout() == util::MATRIX_ROW_MAJOR ? "row major" : "column major",
+        copy_a.empty() ? "used in place" : "converted on the host");
+    printf(" B  %s %s, %s\n", fb.type() == util::MATRIX_DOUBLE ? "double" : "float",
+        fb.layout() == util::MATRIX_ROW_MAJOR ? "row major" : "column major",
+        copy_b.empty() ? "used in place" : "converted on the host");
+
+    MatmulDispatcher dispatcher(context, device);
+    std::string variant;
+    cl::Event first;
+    cl::Event event = dispatcher.run(queue, M, N, K, d_a, d_b, d_c, &variant, &first);
+    event.wait();
+    const double kernel_time = profile_seconds(first, event);
+
+    // Store: mapping C brings the product back into the host pointer,
+    // then the file is written back
+    start = timer.getTimeMicroseconds();
+    void *mapped = queue.enqueueMapBuffer(d_c, CL_TRUE, CL_MAP_READ, 0, Cbytes);
+    double store_time = (timer.getTimeMicroseconds() - start) / 1.0e6;
+
+    const double residual = freivalds(M, N, K, A, B, C, FREIVALDS_ROUNDS);
+
+    start = timer.getTimeMicroseconds();
+    queue.enqueueUnmapMemObject(d_c, mapped);
+    queue.finish();
+    if (!fc.sync())
+        std::cout << fc.error() << "\n";
+    store_time += (timer.getTimeMicroseconds() - start) / 1.0e6 + fc.seconds();
+
+    const double in_bytes = fa.bytes() + (double)fb.bytes();
+    printf(" load     %10.3f ms  %8.2f GB/s\n", load_time * 1.0e3, in_bytes / load_time / 1.0e9);
+    printf(" kernel   %10.3f ms  %8.1f MFLOPS (%s)\n", kernel_time * 1.0e3,
+        2.0 * M * N * K / kernel_time / 1.0e6, variant.c_str());
+    printf(" store    %10.3f ms  %8.2f GB/s%s%s\n", store_time * 1.0e3, Cbytes / store_time / 1.0e9,
+        file_c.empty() ? "" : " to ", file_c.c_str());
+
+    if (std::isnan(residual) || residual > FREIVALDS_TOL(K))
+        printf("\n Errors in multiplication: residual %g\n", residual);
+    return EXIT_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to report whether transposing B paid off for a kernel: the
+//  kernel with B transposed plus the transpose against the original kernel
+//  (kernel times in seconds)
+//
+//------------------------------------------------------------------------------
+static void trans_payoff(double orig_time, double bt_time, double trans_time)
+{
+    const double total = bt_time + trans_time;
+    printf("   transpose %s: %.3f + %.3f ms against %.3f ms with B as is (%.2fx)\n",
+        total < orig_time ? "pays off" : "does not pay off",
+        bt_time * 1.0e3, trans_time * 1.0e3, orig_time * 1.0e3, orig_time / total);
+}
+
 int main(int argc, char *argv[])
 {
 
-    int N;   // A[N][N], B[N][N], C[N][N]
-    int size;      // Number of elements in each matrix
+    int M, N, K;   // A[M][K], B[K][N], C[M][N]
 
 
     double start_time;      // Starting time
     double run_time;        // Timing data
     util::Timer timer;      // timing
 
-    N = ORDER;
-
-    size = N * N;
+    M = N = K = ORDER;
+
+    bool tune = false;
+    bool host_naive = false;
+    bool precisions = false;
+    bool stream = false;
+    bool multi = false;
+    bool random = true;
+    bool dispatch = false;
+    bool blas = false;
+    bool double_buffer = false;
+    bool split_k = false;
+    bool gemv = false;
+    unsigned epilogue = 0;      // operations for --epilogue (0 = none)
+    std::string load_a, load_b, store_c;        // --load and --store files
+    std::string save_a, save_b;                 // --save-inputs files
+    cl_ulong stream_mem = 0;    // device memory limit for --stream (0 = none)
+    int pipeline_jobs = 0;      // jobs for --pipeline (0 = no pipeline)
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--tune"))
+            tune = true;
+        else if (!strcmp(argv[i], "--host-naive"))
+            host_naive = true;
+        else if (!strcmp(argv[i], "--precision"))
+            precisions = true;
+        else if (!strcmp(argv[i], "--stream"))
+            stream = true;
+        else if (!strcmp(argv[i], "--multi"))
+            multi = true;
+        else if (!strcmp(argv[i], "--random"))
+            random = true;
+        else if (!strcmp(argv[i], "--constant"))
+            random = false;
+        else if (!strcmp(argv[i], "--auto"))
+            dispatch = true;
+        else if (!strcmp(argv[i], "--blas"))
+            blas = true;
+        else if (!strcmp(argv[i], "--double-buffer"))
+            double_buffer = true;
+        else if (!strcmp(argv[i], "--split-k"))
+            split_k = true;
+        else if (!strcmp(argv[i], "--gemv"))
+            gemv = true;
+        else if (!strcmp(argv[i], "--epilogue"))
+        {
+            if (++i >= argc || !parse_epilogue(argv[i], epilogue))
+            {
+                std::cout << "Invalid epilogue (try '--epilogue scale,bias,relu,gelu,residual')\n";
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!strcmp(argv[i], "--load") || !strcmp(argv[i], "--save-inputs"))
+        {
+            if (i + 2 >= argc)
+            {
+                std::cout << "Missing file names (try '" << argv[i] << " A.mat B.mat')\n";
+                return EXIT_FAILURE;
+            }
+            if (!strcmp(argv[i], "--load"))
+            {
+                load_a = argv[i+1];
+                load_b = argv[i+2];
+            }
+            else
+            {
+                save_a = argv[i+1];
+                save_b = argv[i+2];
+            }
+            i += 2;
+        }
+        else if (!strcmp(argv[i], "--store"))
+        {
+            if (++i >= argc)
+            {
+                std::cout << "Missing file name (try '--store C.mat')\n";
+                return EXIT_FAILURE;
+            }
+            store_c = argv[i];
+        }
+        else if (!strcmp(argv[i], "--pipeline"))
+        {
+            if (++i >= argc || (pipeline_jobs = atoi(argv[i])) < 1)
+            {
+                std::cout << "Invalid number of jobs (try '--pipeline JOBS')\n";
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!strcmp(argv[i], "--stream-mem"))
+        {
+            if (++i >= argc || atoi(argv[i]) < 1)
+            {
+                std::cout << "Invalid device memory limit (try '--stream-mem MB')\n";
+                return EXIT_FAILURE;
+            }
+            stream_mem = (cl_ulong)atoi(argv[i]) * 1024 * 1024;
+        }
+        else if (!strcmp(argv[i], "--size"))
+        {
+            if (i + 3 >= argc
+                || (M = atoi(argv[i+1])) < 1
+                || (N = atoi(argv[i+2])) < 1
+                || (K = atoi(argv[i+3])) < 1)
+            {
+                std::cout << "Invalid matrix sizes (try '--size M N K')\n";
+                return EXIT_FAILURE;
+            }
+            i += 3;
+        }
+    }
 
-    std::vector<float> h_A(size); // Host memory for Matrix A
-    std::vector<float> h_B(size); // Host memory for Matrix B
-    std::vector<float> h_C(size); // Host memory for Matrix C
+    util::aligned_vector<float> h_A((size_t)M*K); // Host memory for Matrix A
+    util::aligned_vector<float> h_B((size_t)K*N); // Host memory for Matrix B
+    util::aligned_vector<float> h_C((size_t)M*N); // Host memory for Matrix C
 
     cl::Buffer d_a, d_b, d_c;   // Matrices in device memory
 
+    // Constant or random A and B; the products are checked against A and B
+    // with freivalds() either way
+    auto init_inputs = [random](int M, int N, int K, util::aligned_vector<float>& A,
+        util::aligned_vector<float>& B, util::aligned_vector<float>& C)
+    {
+        if (random)
+            initmat_random(M, N, K, A, B, C);
+        else
+            initmat(M, N, K, A, B, C);
+    };
+
+    // Write the generated inputs for a later --load
+    if (!save_a.empty())
+    {
+        init_inputs(M, N, K, h_A, h_B, h_C);
+
+        util::MatrixFile fa, fb;
+        if (!fa.create(save_a, M, K) || !fb.create(save_b, K, N))
+        {
+            std::cout << (fa.error().empty() ? fb.error() : fa.error()) << "\n";
+            return EXIT_FAILURE;
+        }
+        std::copy(h_A.begin(), h_A.end(), fa.as<float>());
+        std::copy(h_B.begin(), h_B.end(), fb.as<float>());
+        if (!fa.sync() || !fb.sync())
+        {
+            std::cout << (fa.error().empty() ? fb.error() : fa.error()) << "\n";
+            return EXIT_FAILURE;
+        }
+        printf("\nWrote A (%d x %d) to %s and B (%d x %d) to %s\n",
+            M, K, save_a.c_str(), K, N, save_b.c_str());
+        return EXIT_SUCCESS;
+    }
+
 //--------------------------------------------------------------------------------
 // Create a context and queue
 //--------------------------------------------------------------------------------
@@ -62,6 +945,27 @@ int main(int argc, char *argv[])
         std::vector<cl::Device> devices;
         unsigned numDevices = getDeviceList(devices);
 
+//--------------------------------------------------------------------------------
+// Matrix multiplication ... split across every device
+//--------------------------------------------------------------------------------
+
+        if (multi)
+        {
+            init_inputs(M, N, K, h_A, h_B, h_C);
+
+            printf("\n===== Matrix mult split across %u devices, %d x %d x %d ======\n",
+                numDevices, M, N, K);
+
+            for (int i = 0; i < COUNT; i++)
+            {
+                zero_mat(M, N, h_C);
+                run_time = multi_mmul(devices, M, N, K, h_A, h_B, h_C);
+                results(M, N, K, h_A, h_B, h_C, run_time);
+            }
+
+            return EXIT_SUCCESS;
+        }
+
         // Check device index in range
         if (deviceIndex >= numDevices)
         {
@@ -78,24 +982,281 @@ int main(int argc, char *argv[])
         std::vector<cl::Device> chosen_device;
         chosen_device.push_back(device);
         cl::Context context(chosen_device);
-        cl::CommandQueue queue(context, device);
+        cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
+
+//--------------------------------------------------------------------------------
+// Out-of-core matrix multiplication ... streamed through the device in tiles
+//--------------------------------------------------------------------------------
+
+        if (stream)
+        {
+            TuneParams params = default_tune_params();
+            if (load_tuning(TUNE_DB, device, M, N, K, params))
+                printf("\nUsing tuned block sizes from %s\n", TUNE_DB);
+
+            init_inputs(M, N, K, h_A, h_B, h_C);
+
+            printf("\n===== Out-of-core matrix mult (streamed tiles), %d x %d x %d on device ======\n",
+                M, N, K);
+
+            for (int i = 0; i < COUNT; i++)
+            {
+                zero_mat(M, N, h_C);
+                run_time = stream_mmul(context, device, params, M, N, K, h_A, h_B, h_C, stream_mem);
+                results(M, N, K, h_A, h_B, h_C, run_time);
+            }
+
+            return EXIT_SUCCESS;
+        }
+
+//--------------------------------------------------------------------------------
+// Pipelined matrix multiplication ... a stream of independent jobs
+//--------------------------------------------------------------------------------
+
+        if (pipeline_jobs > 0)
+        {
+            TuneParams params = default_tune_params();
+            if (load_tuning(TUNE_DB, device, M, N, K, params))
+                printf("\nUsing tuned block sizes from %s\n", TUNE_DB);
+
+            printf("\n===== Pipelined matrix mult, %d jobs of %d x %d x %d on device ======\n",
+                pipeline_jobs, M, N, K);
+
+            PipelineStats stats = pipeline_mmul(context, device, params, M, N, K, pipeline_jobs);
+
+            const double flops = 2.0 * M * N * K;
+            printf(" single job  %10.3f ms   %8.2f jobs/s  %10.1f MFLOPS\n",
+                stats.latency * 1.0e3, 1.0 / stats.latency, flops / stats.latency / 1.0e6);
+            printf(" pipelined   %10.3f ms/job %6.2f jobs/s  %10.1f MFLOPS  (%.2fx)\n",
+                stats.seconds / stats.jobs * 1.0e3, stats.jobs / stats.seconds,
+                flops * stats.jobs / stats.seconds / 1.0e6,
+                stats.latency * stats.jobs / stats.seconds);
+            if (stats.failed)
+                printf("\n Errors in multiplication: %d of %d products failed the check\n",
+                    stats.failed, stats.jobs + 1);
+
+            return EXIT_SUCCESS;
+        }
+
+//--------------------------------------------------------------------------------
+// BLAS style matrix multiplication ... every layout and transpose
+//--------------------------------------------------------------------------------
+
+        if (blas)
+        {
+            printf("\n===== BLAS sgemm and dgemm, %d x %d x %d on device ======\n", M, N, K);
+
+            int failed = run_blas<float>(context, queue, "sgemm", sgemm, M, N, K);
+            if (device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") != std::string::npos)
+                failed += run_blas<double>(context, queue, "dgemm", dgemm, M, N, K);
+            else
+                printf(" dgemm skipped: the device has no fp64\n");
+
+            if (failed)
+                printf("\n Errors in multiplication: %d calls failed the check\n", failed);
+            gemm_release();
+            return EXIT_SUCCESS;
+        }
+
+//--------------------------------------------------------------------------------
+// Double buffered blocked matrix multiplication ... against single buffered
+//--------------------------------------------------------------------------------
+
+        if (double_buffer)
+        {
+            printf("\n===== Blocked matrix mult, single and double buffered local memory ======\n");
+            printf(" %-21s  %-9s  %-30s  %-30s  %s\n", "M x N x K", "", "single buffered",
+                "double buffered", "speedup");
+
+            // Square sizes while A, B and C fit in device memory
+            const cl_ulong max_alloc = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+            int failed = 0;
+            for (int n = DB_MIN; n <= DB_MAX; n *= 2)
+            {
+                if (sizeof(float) * (cl_ulong)n * n > max_alloc)
+                    break;
+                failed += !run_double_buffer(context, device, queue, n, n, n);
+            }
+            if (M != N || N != K || M < DB_MIN || M > DB_MAX || (M & (M - 1)))
+                failed += !run_double_buffer(context, device, queue, M, N, K);
+            printf(" (* block size from %s)\n", TUNE_DB);
+
+            if (failed)
+                printf("\n Errors in multiplication: %d sizes failed the check\n", failed);
+            return EXIT_SUCCESS;
+        }
+
+//--------------------------------------------------------------------------------
+// Split-K matrix multiplication ... against blocked, for a small C
+//--------------------------------------------------------------------------------
+
+        if (split_k)
+        {
+            MatmulDispatcher dispatcher(context, device);
+
+            printf("\n===== Blocked matrix mult against split-K, small C and deep K ======\n");
+            printf(" %-24s  %-29s  %-48s  %s\n", "M x N x K", "block", "split_k", "chosen");
+
+            // Deeper K while A and B fit in device memory
+            const cl_ulong max_alloc = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+            int failed = 0;
+            bool swept = false;
+            for (int k = SPLITK_K_MIN; k <= SPLITK_K_MAX; k *= 4)
+            {
+                if (sizeof(float) * (cl_ulong)SPLITK_MN * k > max_alloc)
+                    break;
+                failed += !run_split_k(context, queue, dispatcher, SPLITK_MN, SPLITK_MN, k);
+                swept = swept || (M == SPLITK_MN && N == SPLITK_MN && K == k);
+            }
+            if (!swept)
+                failed += !run_split_k(context, queue, dispatcher, M, N, K);
+
+            if (failed)
+                printf("\n Errors in multiplication: %d sizes failed the check\n", failed);
+            return EXIT_SUCCESS;
+        }
 
 //--------------------------------------------------------------------------------
-// Run sequential matmul
+// Matrix-vector products ... against the device's memory bandwidth
 //--------------------------------------------------------------------------------
 
-        initmat(N, h_A, h_B, h_C);
+        if (gemv)
+        {
+            printf("\n===== Matrix-vector products (sgemv), y = 1.5 * op(A) * x + 0.5 * y ======\n");
+            const double peak = stream_bandwidth(queue, 1, GEMV_REPS);
+            printf(" peak: device stream bandwidth %.2f GB/s\n", peak);
+
+            // Square A while it fits in device memory
+            const cl_ulong max_alloc = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+            int failed = 0;
+            bool swept = false;
+            for (int n = GEMV_MIN; n <= GEMV_MAX; n *= 2)
+            {
+                if (sizeof(float) * (cl_ulong)n * n > max_alloc)
+                    break;
+                failed += run_gemv(context, queue, n, n, peak);
+                swept = swept || (M == n && N == n);
+            }
+            if (!swept)
+                failed += run_gemv(context, queue, M, N, peak);
+
+            printf("\n===== Batched matrix-vector products, y = op(A) * x ======\n");
+            failed += run_gemv_batched(context, queue, GEMV_BATCH_N, GEMV_BATCH, peak);
+
+            if (failed)
+                printf("\n Errors in the products: %d runs failed the check\n", failed);
+            gemv_release();
+            return EXIT_SUCCESS;
+        }
+
+//--------------------------------------------------------------------------------
+// Fused epilogues ... element-wise operations applied before the store of C
+//--------------------------------------------------------------------------------
+
+        if (epilogue)
+        {
+            TuneParams params = default_tune_params();
+            if (load_tuning(TUNE_DB, device, M, N, K, params))
+                printf("\nUsing tuned block sizes from %s\n", TUNE_DB);
+
+            init_inputs(M, N, K, h_A, h_B, h_C);
+
+            printf("\n===== Fused epilogue (%s), %d x %d x %d on device ======\n",
+                epilogue_name(epilogue).c_str(), M, N, K);
+
+            int passes = 0;
+            for (unsigned op = 1; op <= EpiResidual; op <<= 1)
+                passes += (epilogue & op) != 0;
+            const double unfused_bytes = epilogue_bytes(M, N, epilogue, false);
+            const double fused_bytes   = epilogue_bytes(M, N, epilogue, true);
+            printf(" epilogue traffic %.2f MB unfused, %.2f MB fused: %.2f MB saved\n",
+                unfused_bytes / 1.0e6, fused_bytes / 1.0e6, (unfused_bytes - fused_bytes) / 1.0e6);
+
+            for (int reg = 0; reg < 2; reg++)
+            {
+                EpilogueStats stats = epilogue_compare(context, queue, params, reg != 0,
+                    M, N, K, epilogue, h_A, h_B);
+                const double unfused = stats.gemm + stats.passes;
+
+                printf(" %-10s unfused %10.3f ms (product %.3f + %d passes %.3f at %.2f GB/s)  max error %.1e\n",
+                    reg ? "block_reg" : "block", unfused * 1.0e3, stats.gemm * 1.0e3, passes,
+                    stats.passes * 1.0e3, unfused_bytes / stats.passes / 1.0e9, stats.unfused_err);
+                printf(" %-10s fused   %10.3f ms (%.2fx)  max error %.1e\n", "",
+                    stats.fused * 1.0e3, unfused / stats.fused, stats.fused_err);
+                if (std::isnan(stats.residual) || stats.residual > FREIVALDS_TOL(K))
+                    printf("\n Errors in multiplication: residual %g\n", stats.residual);
+                if (!(stats.unfused_err <= TOL && stats.fused_err <= TOL))
+                    printf("\n Errors in epilogue: the results differ from the host's\n");
+            }
+            return EXIT_SUCCESS;
+        }
 
-        printf("\n===== Sequential, matrix mult (dot prod), order %d on host CPU ======\n",ORDER);
+//--------------------------------------------------------------------------------
+// Matrix multiplication of matrix files ... mapped, not read
+//--------------------------------------------------------------------------------
+
+        if (!load_a.empty())
+            return run_files(context, device, queue, load_a, load_b, store_c);
+
+//--------------------------------------------------------------------------------
+// Dispatched matrix multiplication ... only the kernel expected to be fastest
+//--------------------------------------------------------------------------------
+
+        if (dispatch)
+        {
+            matmul_device(context, device);
+            MatmulDispatcher& dispatcher = matmul_dispatcher();
+            if (dispatcher.calibrated())
+                printf("\nCost model calibrated for %d kernels from %s\n",
+                    dispatcher.calibrated(), DISPATCH_DB);
+            else
+                printf("\nNo results for this device in %s, using the estimated cost model\n",
+                    DISPATCH_DB);
+
+            printf("\n===== Dispatched matrix mult, %d x %d x %d on device ======\n", M, N, K);
+
+            std::vector<DispatchChoice> choices = dispatcher.rank(M, N, K);
+            for (size_t i = 0; i < choices.size(); i++)
+                printf(" %-14s %12.3f ms predicted (%s)\n", choices[i].variant.c_str(),
+                    choices[i].seconds * 1.0e3, choices[i].calibrated ? "measured" : "estimated");
+
+            init_inputs(M, N, K, h_A, h_B, h_C);
+
+            std::string variant;
+            for (int i = 0; i < COUNT; i++)
+            {
+                zero_mat(M, N, h_C);
+                run_time = matmul(h_A, h_B, h_C, M, N, K, &variant);
+                printf("\n Ran %s\n", variant.c_str());
+                results(M, N, K, h_A, h_B, h_C, run_time);
+            }
+
+            return EXIT_SUCCESS;
+        }
+
+//--------------------------------------------------------------------------------
+// Run matmul on the host
+//--------------------------------------------------------------------------------
+
+        init_inputs(M, N, K, h_A, h_B, h_C);
+
+        if (host_naive)
+            printf("\n===== Sequential, matrix mult (dot prod), %d x %d x %d on host CPU ======\n",M,N,K);
+        else
+            printf("\n===== Blocked matrix mult (%s), %d x %d x %d on host CPU ======\n",
+                host_gemm_info(), M, N, K);
         for(int i = 0; i < COUNT; i++)
         {
-            zero_mat(N, h_C);
+            zero_mat(M, N, h_C);
             start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
 
-            seq_mat_mul_sdot(N, h_A, h_B, h_C);
+            if (host_naive)
+                seq_mat_mul_sdot(M, N, K, h_A, h_B, h_C);
+            else
+                host_mat_mul(M, N, K, h_A, h_B, h_C);
 
             run_time  = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
-            results(N, h_C, run_time);
+            results(M, N, K, h_A, h_B, h_C, run_time);
         }
 
 //--------------------------------------------------------------------------------
@@ -103,30 +1264,60 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 
         //  Reset A, B and C matrices (just to play it safe)
-        initmat(N, h_A, h_B, h_C);
+        init_inputs(M, N, K, h_A, h_B, h_C);
+
+        d_a = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * h_A.size());
+
+        d_b = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * h_B.size());
 
-        d_a = cl::Buffer(context, h_A.begin(), h_A.end(), true);
+        d_c = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * h_C.size());
 
-        d_b = cl::Buffer(context, h_B.begin(), h_B.end(), true);
+        // Upload A and B on the profiled queue, so the copies are timed too
+        Profile profile;    // events of each variant's kernels and copies
+        cl::Event event;    // the last kernel launched
 
-        d_c = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * size);
+        // Kernel times of the variants that are run again with B transposed
+        double elem_time = 0.0, row_priv_time = 0.0;
+
+        printf("\n===== Upload of A and B to the device ======\n");
+        profile_write(profile, queue, h_A, d_a);
+        profile_write(profile, queue, h_B, d_b);
+        profile_results(profile, 0.0);
+
+//--------------------------------------------------------------------------------
+// Pick the block sizes for the blocked kernels, tuning them if asked to
+//--------------------------------------------------------------------------------
+
+        TuneParams params = default_tune_params();
+        if (tune)
+        {
+            if (autotune(context, device, queue, M, N, K, h_A, h_B, d_a, d_b, d_c, params))
+                save_tuning(TUNE_DB, device, M, N, K, params);
+        }
+        else if (load_tuning(TUNE_DB, device, M, N, K, params))
+        {
+            printf("\nUsing tuned block sizes from %s\n", TUNE_DB);
+        }
 
 //--------------------------------------------------------------------------------
 // OpenCL matrix multiplication ... Naive
 //--------------------------------------------------------------------------------
 
-        // Create the compute program from the source buffer
-        cl::Program program(context, util::loadProgram("../C_elem.cl"), true);
+        // Create the compute program from the source buffer, or from the
+        // binary cache if it has been built before (see program_cache.hpp)
+        util::BuildInfo build;
+        cl::Program program = util::buildProgram(context, util::kernelSource("C_elem.cl"), "", &build);
+        util::printBuildInfo("C_elem.cl", build);
 
         // Create the compute kernel from the program
-        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer> naive_mmul(program, "mmul");
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer> naive_mmul(program, "mmul");
 
-        printf("\n===== OpenCL, matrix mult, C(i,j) per work item, order %d ======\n",N);
+        printf("\n===== OpenCL, matrix mult, C(i,j) per work item, %d x %d x %d ======\n",M,N,K);
 
         // Do the multiplication COUNT times
         for (int i = 0; i < COUNT; i++)
         {
-            zero_mat(N, h_C);
+            zero_mat(M, N, h_C);
 
             start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
 
@@ -134,17 +1325,20 @@ int main(int argc, char *argv[])
             // a dot product for each element of the product matrix.  The local work
             // group size is set to NULL ... so I'm telling the OpenCL runtime to
             // figure out a local work group size for me.
-            cl::NDRange global(N, N);
-            naive_mmul(cl::EnqueueArgs(queue, global),
-                    N, d_a, d_b, d_c);
+            cl::NDRange global(M, N);
+            event = naive_mmul(cl::EnqueueArgs(queue, global),
+                    M, N, K, d_a, d_b, d_c);
 
             queue.finish();
 
             run_time  = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
 
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            profile_kernel(profile, event);
+            profile_read(profile, queue, d_c, h_C);
 
-            results(N, h_C, run_time);
+            elem_time = profile_seconds(event);
+            results(M, N, K, h_A, h_B, h_C, run_time);
+            profile_results(profile, 2.0 * M * N * K);
 
         } // end for loop
 
@@ -153,31 +1347,34 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 
         // Create the compute program from the source buffer
-        program = cl::Program(context, util::loadProgram("../C_row.cl"), true);
+        program = util::buildProgram(context, util::kernelSource("C_row.cl"), "", &build);
+        util::printBuildInfo("C_row.cl", build);
 
         // Create the compute kernel from the program
-        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer> crow_mmul(program, "mmul");
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer> crow_mmul(program, "mmul");
 
-        printf("\n===== OpenCL, matrix mult, C row per work item, order %d ======\n",N);
+        printf("\n===== OpenCL, matrix mult, C row per work item, %d x %d x %d ======\n",M,N,K);
 
         // Do the multiplication COUNT times
         for (int i = 0; i < COUNT; i++)
         {
-            zero_mat(N, h_C);
+            zero_mat(M, N, h_C);
 
             start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
 
-            cl::NDRange global(N);
-            crow_mmul(cl::EnqueueArgs(queue, global),
-                    N, d_a, d_b, d_c);
+            cl::NDRange global(M);
+            event = crow_mmul(cl::EnqueueArgs(queue, global),
+                    M, N, K, d_a, d_b, d_c);
 
             queue.finish();
 
             run_time  = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
 
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            profile_kernel(profile, event);
+            profile_read(profile, queue, d_c, h_C);
 
-            results(N, h_C, run_time);
+            results(M, N, K, h_A, h_B, h_C, run_time);
+            profile_results(profile, 2.0 * M * N * K);
 
         } // end for loop
 
@@ -186,69 +1383,134 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 
         // Create the compute program from the source buffer
-        program = cl::Program(context, util::loadProgram("../C_row_priv.cl"), true);
+        char priv_options[32];
+        sprintf(priv_options, "-DPRIV_K=%d", PRIV_K);
+        program = util::buildProgram(context, util::kernelSource("C_row_priv.cl"), priv_options, &build);
+        util::printBuildInfo("C_row_priv.cl", build);
 
         // Create the compute kernel from the program
-        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer> arowpriv_mmul(program, "mmul");
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer> arowpriv_mmul(program, "mmul");
 
-        printf("\n===== OpenCL, matrix mult, C row, A row in priv mem, order %d ======\n",N);
+        printf("\n===== OpenCL, matrix mult, C row, A row in priv mem, %d x %d x %d ======\n",M,N,K);
 
         // Do the multiplication COUNT times
         for (int i = 0; i < COUNT; i++)
         {
-            zero_mat(N, h_C);
+            zero_mat(M, N, h_C);
 
             start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
 
-            cl::NDRange global(N);
-            cl::NDRange local(ORDER / 16);
-            arowpriv_mmul(cl::EnqueueArgs(queue, global, local),
-                    N, d_a, d_b, d_c);
+            cl::NDRange global(ROUND_UP(M, ROW_LOCAL));
+            cl::NDRange local(ROW_LOCAL);
+            event = arowpriv_mmul(cl::EnqueueArgs(queue, global, local),
+                    M, N, K, d_a, d_b, d_c);
 
             queue.finish();
 
             run_time  = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
 
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            profile_kernel(profile, event);
+            profile_read(profile, queue, d_c, h_C);
 
-            results(N, h_C, run_time);
+            row_priv_time = profile_seconds(event);
+            results(M, N, K, h_A, h_B, h_C, run_time);
+            profile_results(profile, 2.0 * M * N * K);
 
         } // end for loop
 
+//--------------------------------------------------------------------------------
+// OpenCL matrix multiplication ... same kernel, in each host memory mode
+//--------------------------------------------------------------------------------
+
+        // A, B and C in each buffer mode of host_buffer.hpp.  On a device
+        // sharing memory with the host the mapped modes should take next to
+        // no transfer time, as nothing is copied.
+        cl::Kernel rowpriv_kernel(program, "mmul");
+
+        for (int m = 0; m < util::BUFFER_MODES; m++)
+        {
+            util::BufferMode mode = (util::BufferMode)m;
+
+            printf("\n===== OpenCL, matrix mult, C row, A row in priv mem, %s buffers, %d x %d x %d ======\n",
+                util::bufferModeName(mode), M, N, K);
+            if (!util::bufferModeSupported(device, mode))
+            {
+                printf(" not supported by the device\n");
+                continue;
+            }
+
+            util::HostBuffer<float> a(context, queue, mode, h_A.size(), CL_MEM_READ_ONLY);
+            util::HostBuffer<float> b(context, queue, mode, h_B.size(), CL_MEM_READ_ONLY);
+            util::HostBuffer<float> c(context, queue, mode, h_C.size(), CL_MEM_WRITE_ONLY);
+
+            std::copy(h_A.begin(), h_A.end(), a.data());
+            std::copy(h_B.begin(), h_B.end(), b.data());
+
+            start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
+
+            a.toDevice();
+            b.toDevice();
+            c.toDevice();
+
+            rowpriv_kernel.setArg(0, M);
+            rowpriv_kernel.setArg(1, N);
+            rowpriv_kernel.setArg(2, K);
+            a.setArg(rowpriv_kernel, 3);
+            b.setArg(rowpriv_kernel, 4);
+            c.setArg(rowpriv_kernel, 5);
+            queue.enqueueNDRangeKernel(rowpriv_kernel, cl::NullRange,
+                cl::NDRange(ROUND_UP(M, ROW_LOCAL)), cl::NDRange(ROW_LOCAL), NULL, &event);
+
+            c.toHost();
+
+            run_time  = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
+
+            std::copy(c.data(), c.data() + h_C.size(), h_C.begin());
+            results(M, N, K, h_A, h_B, h_C, run_time);
+
+            const double seconds = a.transferSeconds() + b.transferSeconds() + c.transferSeconds();
+            const size_t bytes = a.transferBytes() + b.transferBytes() + c.transferBytes();
+            printf("   kernel    %10.3f ms\n", profile_seconds(event) * 1.0e3);
+            printf("   transfers %10.3f ms, %.1f MB copied\n", seconds * 1.0e3, bytes / 1.0e6);
+        }
+
 //--------------------------------------------------------------------------------
 // OpenCL matrix multiplication ... C row per work item, A row pivate, B col local
 //--------------------------------------------------------------------------------
 
         // Create the compute program from the source buffer
-        program = cl::Program(context, util::loadProgram("../C_row_priv_bloc.cl"), true);
+        program = util::buildProgram(context, util::kernelSource("C_row_priv_bloc.cl"), priv_options, &build);
+        util::printBuildInfo("C_row_priv_bloc.cl", build);
 
         // Create the compute kernel from the program
-        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg> browloc_mmul(program, "mmul");
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg> browloc_mmul(program, "mmul");
 
-        printf("\n===== OpenCL, mat mult, C row, priv A, B cols loc, order %d ======\n",N);
+        printf("\n===== OpenCL, mat mult, C row, priv A, B cols loc, %d x %d x %d ======\n",M,N,K);
 
         // Do the multiplication COUNT times
         for (int i = 0; i < COUNT; i++)
         {
-            zero_mat(N, h_C);
+            zero_mat(M, N, h_C);
 
             start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
 
-            cl::NDRange global(N);
-            cl::NDRange local(ORDER / 16);
+            cl::NDRange global(ROUND_UP(M, ROW_LOCAL));
+            cl::NDRange local(ROW_LOCAL);
 
-            cl::LocalSpaceArg localmem = cl::Local(sizeof(float) * N);
+            cl::LocalSpaceArg localmem = cl::Local(sizeof(float) * std::min(K, PRIV_K));
 
-            browloc_mmul(cl::EnqueueArgs(queue, global, local),
-                    N, d_a, d_b, d_c, localmem);
+            event = browloc_mmul(cl::EnqueueArgs(queue, global, local),
+                    M, N, K, d_a, d_b, d_c, localmem);
 
             queue.finish();
 
             run_time  = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
 
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            profile_kernel(profile, event);
+            profile_read(profile, queue, d_c, h_C);
 
-            results(N, h_C, run_time);
+            results(M, N, K, h_A, h_B, h_C, run_time);
+            profile_results(profile, 2.0 * M * N * K);
 
         } // end for loop
 
@@ -257,34 +1519,145 @@ int main(int argc, char *argv[])
 //--------------------------------------------------------------------------------
 
         // Create the compute program from the source buffer
-        program = cl::Program(context, util::loadProgram("../C_block_form.cl"), true);
+        program = util::buildProgram(context, util::kernelSource("C_block_form.cl"),
+            block_options(params, M, N, K), &build);
+        util::printBuildInfo("C_block_form.cl", build);
 
         // Create the compute kernel from the program
-        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg> block_mmul(program, "mmul");
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg> block_mmul(program, "mmul");
 
-        printf("\n===== Parallel matrix mult (blocked), order %d on device ======\n",ORDER);
+        printf("\n===== Parallel matrix mult (blocked), %d x %d x %d on device ======\n",M,N,K);
 
         // Do the multiplication COUNT times
         for (int i = 0; i < COUNT; i++)
         {
-            zero_mat(N, h_C);
+            zero_mat(M, N, h_C);
 
             start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
 
-            // Work-group computes a block of C.  This size is also set
-            // in a #define inside the kernel function.  Note this blocksize
-            // must evenly divide the matrix order
-            int blocksize = 16;
+            // Work-group computes a block of C.  This size is also passed
+            // to the kernel as a #define when it is built.  The NDRange is
+            // padded to whole blocks; the kernel skips the extra elements
+            int blocksize = params.blksz;
 
             cl::LocalSpaceArg A_block = cl::Local(sizeof(float) * blocksize*blocksize);
             cl::LocalSpaceArg B_block = cl::Local(sizeof(float) * blocksize*blocksize);
 
-            block_mmul(
+            event = block_mmul(
+                cl::EnqueueArgs(
+                    queue,
+                    cl::NDRange(ROUND_UP(N, blocksize), ROUND_UP(M, blocksize)),
+                    cl::NDRange(blocksize,blocksize)),
+                M,
+                N,
+                K,
+                d_a,
+                d_b,
+                d_c,
+                A_block,
+                B_block);
+
+            queue.finish();
+
+            run_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
+
+            profile_kernel(profile, event);
+            profile_read(profile, queue, d_c, h_C);
+
+            results(M, N, K, h_A, h_B, h_C, run_time);
+            profile_results(profile, 2.0 * M * N * K);
+
+        } // end for loop
+
+//--------------------------------------------------------------------------------
+// OpenCL matrix multiplication ... blocked, double buffered local memory
+//--------------------------------------------------------------------------------
+
+        program = util::buildProgram(context, util::kernelSource("C_block_db.cl"),
+            block_options(params, M, N, K), &build);
+        util::printBuildInfo("C_block_db.cl", build);
+
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg> db_mmul(program, "mmul");
+
+        printf("\n===== Parallel matrix mult (blocked, double buffered), %d x %d x %d on device ======\n",M,N,K);
+
+        // Do the multiplication COUNT times
+        for (int i = 0; i < COUNT; i++)
+        {
+            zero_mat(M, N, h_C);
+
+            start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
+
+            // As the blocked kernel, with two blocks of A and of B in
+            // local memory: the next pair is loaded while one is used
+            int blocksize = params.blksz;
+
+            cl::LocalSpaceArg A_block = cl::Local(sizeof(float) * 2*blocksize*blocksize);
+            cl::LocalSpaceArg B_block = cl::Local(sizeof(float) * 2*blocksize*blocksize);
+
+            event = db_mmul(
                 cl::EnqueueArgs(
                     queue,
-                    cl::NDRange(N,N),
+                    cl::NDRange(ROUND_UP(N, blocksize), ROUND_UP(M, blocksize)),
                     cl::NDRange(blocksize,blocksize)),
+                M,
+                N,
+                K,
+                d_a,
+                d_b,
+                d_c,
+                A_block,
+                B_block);
+
+            queue.finish();
+
+            run_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
+
+            profile_kernel(profile, event);
+            profile_read(profile, queue, d_c, h_C);
+
+            results(M, N, K, h_A, h_B, h_C, run_time);
+            profile_results(profile, 2.0 * M * N * K);
+
+        } // end for loop
+
+//--------------------------------------------------------------------------------
+// OpenCL matrix multiplication ... blocked, register tiled with vector loads
+//--------------------------------------------------------------------------------
+
+        // Create the compute program from the source buffer, passing the block
+        // and micro-tile sizes so the kernel agrees with the host
+        program = util::buildProgram(context, util::kernelSource("C_block_reg.cl"),
+            reg_options(params, M, N, K), &build);
+        util::printBuildInfo("C_block_reg.cl", build);
+
+        // Create the compute kernel from the program
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg> reg_mmul(program, "mmul");
+
+        printf("\n===== Parallel matrix mult (blocked, %dx%d per work item), %d x %d x %d on device ======\n",
+            params.wptm, params.wptn, M, N, K);
+
+        // Do the multiplication COUNT times
+        for (int i = 0; i < COUNT; i++)
+        {
+            zero_mat(M, N, h_C);
+
+            start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
+
+            // Work-group computes a tsm x tsn block of C and each
+            // work-item computes a wptm x wptn micro-tile of that
+            // block.  The NDRange is padded to whole blocks of C
+            cl::LocalSpaceArg A_block = cl::Local(sizeof(float) * params.tsk*params.tsm);
+            cl::LocalSpaceArg B_block = cl::Local(sizeof(float) * params.tsk*params.tsn);
+
+            event = reg_mmul(
+                cl::EnqueueArgs(
+                    queue,
+                    cl::NDRange(ROUND_UP(N, params.tsn)/params.wptn, ROUND_UP(M, params.tsm)/params.wptm),
+                    cl::NDRange(params.tsn/params.wptn, params.tsm/params.wptm)),
+                M,
                 N,
+                K,
                 d_a,
                 d_b,
                 d_c,
@@ -295,11 +1668,145 @@ int main(int argc, char *argv[])
 
             run_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
 
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            profile_kernel(profile, event);
+            profile_read(profile, queue, d_c, h_C);
 
-            results(N, h_C, run_time);
+            results(M, N, K, h_A, h_B, h_C, run_time);
+            profile_results(profile, 2.0 * M * N * K);
 
         } // end for loop
+
+//--------------------------------------------------------------------------------
+// OpenCL matrix multiplication ... B transposed on the device first
+//--------------------------------------------------------------------------------
+
+        // The row kernels read B a column at a time, with a stride of N.
+        // Transposing B first lets them read both A and B contiguously;
+        // it pays off if the faster kernel makes up for the transpose.
+        char trans_options[32];
+        sprintf(trans_options, "-DTILE=%d", TRANS_TILE);
+        program = util::buildProgram(context, util::kernelSource("C_trans.cl"), trans_options, &build);
+        util::printBuildInfo("C_trans.cl", build);
+
+        cl::make_kernel<int, int, cl::Buffer, cl::Buffer, cl::LocalSpaceArg> transpose(program, "transpose");
+
+        cl::NDRange trans_global(ROUND_UP(N, TRANS_TILE), ROUND_UP(K, TRANS_TILE));
+        cl::NDRange trans_local(TRANS_TILE, TRANS_TILE);
+        cl::LocalSpaceArg tile = cl::Local(sizeof(float) * TRANS_TILE*(TRANS_TILE+1));
+
+        printf("\n===== OpenCL, transpose of B (%dx%d tiles), %d x %d ======\n",
+            TRANS_TILE, TRANS_TILE, K, N);
+
+        // B is constant, so check the kernel on a matrix of distinct
+        // values against the host transpose first
+        {
+            util::aligned_vector<float> h_R(h_B.size()), h_Rt(h_B.size()), h_Rt_ref(h_B.size());
+            for (size_t i = 0; i < h_R.size(); i++)
+                h_R[i] = (float)(i % 65521);
+            trans(K, N, h_R, h_Rt_ref);
+
+            cl::Buffer d_r(context, h_R.begin(), h_R.end(), true);
+            cl::Buffer d_rt(context, CL_MEM_WRITE_ONLY, sizeof(float) * h_R.size());
+            transpose(cl::EnqueueArgs(queue, trans_global, trans_local), K, N, d_r, d_rt, tile);
+            cl::copy(queue, d_rt, h_Rt.begin(), h_Rt.end());
+            if (h_Rt != h_Rt_ref)
+                printf("\n Errors in transpose\n");
+        }
+
+        cl::Buffer d_bt(context, CL_MEM_READ_WRITE, sizeof(float) * h_B.size());
+        event = transpose(cl::EnqueueArgs(queue, trans_global, trans_local), K, N, d_b, d_bt, tile);
+        queue.finish();
+
+        const double trans_time = profile_seconds(event);
+        printf(" %.3f ms at %.2f GB/s\n", trans_time * 1.0e3,
+            2.0 * sizeof(float) * K * N / trans_time / 1.0e9);
+
+        // C(i,j) per work item, reading row i of A and row j of Bt
+        program = util::buildProgram(context, util::kernelSource("C_elem_bt.cl"), "", &build);
+        util::printBuildInfo("C_elem_bt.cl", build);
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer> elem_bt_mmul(program, "mmul");
+
+        printf("\n===== OpenCL, matrix mult, C(i,j) per work item, B transposed, %d x %d x %d ======\n",M,N,K);
+
+        // Do the multiplication COUNT times
+        for (int i = 0; i < COUNT; i++)
+        {
+            zero_mat(M, N, h_C);
+
+            start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
+
+            event = elem_bt_mmul(cl::EnqueueArgs(queue, cl::NDRange(M, N)),
+                    M, N, K, d_a, d_bt, d_c);
+
+            queue.finish();
+
+            run_time  = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
+
+            profile_kernel(profile, event);
+            profile_read(profile, queue, d_c, h_C);
+
+            results(M, N, K, h_A, h_B, h_C, run_time);
+            profile_results(profile, 2.0 * M * N * K);
+            trans_payoff(elem_time, profile_seconds(event), trans_time);
+
+        } // end for loop
+
+        // C row per work item, A row in private memory, reading rows of Bt
+        program = util::buildProgram(context, util::kernelSource("C_row_priv_bt.cl"), priv_options, &build);
+        util::printBuildInfo("C_row_priv_bt.cl", build);
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer> rowpriv_bt_mmul(program, "mmul");
+
+        printf("\n===== OpenCL, matrix mult, C row, A row in priv mem, B transposed, %d x %d x %d ======\n",M,N,K);
+
+        // Do the multiplication COUNT times
+        for (int i = 0; i < COUNT; i++)
+        {
+            zero_mat(M, N, h_C);
+
+            start_time = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0;
+
+            cl::NDRange global(ROUND_UP(M, ROW_LOCAL));
+            cl::NDRange local(ROW_LOCAL);
+            event = rowpriv_bt_mmul(cl::EnqueueArgs(queue, global, local),
+                    M, N, K, d_a, d_bt, d_c);
+
+            queue.finish();
+
+            run_time  = static_cast<double>(timer.getTimeMilliseconds()) / 1000.0 - start_time;
+
+            profile_kernel(profile, event);
+            profile_read(profile, queue, d_c, h_C);
+
+            results(M, N, K, h_A, h_B, h_C, run_time);
+            profile_results(profile, 2.0 * M * N * K);
+            trans_payoff(row_priv_time, profile_seconds(event), trans_time);
+
+        } // end for loop
+
+//--------------------------------------------------------------------------------
+// OpenCL matrix multiplication ... blocked, in each precision
+//--------------------------------------------------------------------------------
+
+        if (precisions)
+        {
+            // Random matrices, so the errors show the effect of each
+            // precision, and their product in fp64 as the reference
+            util::aligned_vector<double> r_A(M*K), r_B(K*N), r_C(M*N);
+            randmat(M, K, r_A);
+            randmat(K, N, r_B);
+            seq_mat_mul_sdot(M, N, K, r_A, r_B, r_C);
+
+            printf("\n===== Parallel matrix mult (blocked) in each precision, %d x %d x %d on device ======\n",
+                M, N, K);
+
+            run_precision<float>(context, queue, params, M, N, K, r_A, r_B, r_C);
+            if (device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") != std::string::npos)
+                run_precision<double>(context, queue, params, M, N, K, r_A, r_B, r_C);
+            else
+                printf(" %-24s not supported by the device\n", precision<double>::name());
+            run_precision<half_t>(context, queue, params, M, N, K, r_A, r_B, r_C);
+            run_precision<cl_char>(context, queue, params, M, N, K, r_A, r_B, r_C);
+        }
     } catch (cl::Error err)
     {
         std::cout << "Exception\n";
@@ -15,6 +15,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <cfloat>
 #include <iostream>
 
 #include <vector>
@@ -24,6 +25,8 @@
 
 #include "util.hpp"
 
+#include "precision.hpp"
+
 #include "matrix_lib.hpp"
 
 //------------------------------------------------------------------------------
@@ -38,9 +41,79 @@ extern double wtime();   // returns time since some fixed past point (wtime.c)
 #define AVAL     3.0     // A elements are constant and equal to AVAL
 #define BVAL     5.0     // B elements are constant and equal to BVAL
 #define TOL      (0.001) // tolerance used in floating point comparisons
+#define RAND_SEED 12345  // seed of the random A and B (unless --constant)
+#define FREIVALDS_ROUNDS 2      // random vectors tried by the Freivalds check
+#define FREIVALDS_C 16.0        // its tolerance, relative to the rms of A*(B*r), is
+                                // FREIVALDS_C * sqrt(K) * FLT_EPSILON: the error of
+                                // a float dot product of length K grows as sqrt(K)
+#define FREIVALDS_TOL(K) (FREIVALDS_C * sqrt((double)(K)) * FLT_EPSILON)
 #define DIM      2       // Max dim for NDRange
 #define COUNT    1       // number of times to do each multiplication
 #define SUCCESS  1
 #define FAILURE  0
+#define ROW_LOCAL 64     // work-group size for the C row per work item kernels
+#define PRIV_K   1024    // elements of the A row held in private memory at once
+#define TRANS_TILE 16    // tile size of the transpose kernel (C_trans.cl)
+
+// Round x up to the next multiple of m (used to pad NDRanges)
+#define ROUND_UP(x,m) ((((x)+(m)-1)/(m))*(m))
+
+//------------------------------------------------------------------------------
+//  Default block sizes for the blocked kernels.  These are used unless the
+//  tuning database (TUNE_DB) has an entry for the device, see tuner.hpp.
+//------------------------------------------------------------------------------
+#define BLKSZ    16      // block size for C_block_form.cl
+#define REG_TSM  64      // rows of C computed by a work-group
+#define REG_TSN  64      // columns of C computed by a work-group
+#define REG_TSK  16      // depth of the A and B blocks held in local memory
+#define REG_WPTM 4       // rows of C computed by a work-item
+#define REG_WPTN 4       // columns of C computed by a work-item
+#define TUNE_DB  "matmul_tune.db"  // tuning database in the working directory
+
+//------------------------------------------------------------------------------
+//  Sweep of the blocked kernel against its double buffered variant
+//  (C_block_db.cl), see --double-buffer in matmul.cpp
+//------------------------------------------------------------------------------
+#define DB_MIN   128     // smallest order of the square matrices in the sweep
+#define DB_MAX   2048    // largest order (doubling from DB_MIN)
+#define DB_REPS  5       // runs of each kernel per size, the fastest is kept
+
+//------------------------------------------------------------------------------
+//  Split-K (C_splitk.cl) for products whose C is too small to fill the
+//  device, see dispatch.cpp and --split-k in matmul.cpp
+//------------------------------------------------------------------------------
+#define SPLITK_MIN_K  256      // least depth of K in a slice
+#define SPLITK_MAX    64       // most slices of K
+#define SPLITK_MN     64       // order of C in the --split-k sweep
+#define SPLITK_K_MIN  4096     // K of the sweep, quadrupling from SPLITK_K_MIN
+#define SPLITK_K_MAX  1048576  // to SPLITK_K_MAX
+#define SPLITK_REPS   5        // runs of each kernel per size, the fastest is kept
+
+//------------------------------------------------------------------------------
+//  Sweep of the matrix-vector kernels (C_gemv.cl), see gemv.hpp and --gemv
+//  in matmul.cpp
+//------------------------------------------------------------------------------
+#define GEMV_MIN     1024   // smallest order of the square A in the sweep
+#define GEMV_MAX     8192   // largest order (doubling from GEMV_MIN)
+#define GEMV_BATCH   256    // products of the batched test
+#define GEMV_BATCH_N 128    // order of their A
+#define GEMV_REPS    5      // runs of each kernel per size, the fastest is kept
+
+//------------------------------------------------------------------------------
+//  Work split for the batched kernel (C_batched.cl), see batched.cpp
+//------------------------------------------------------------------------------
+#define BATCH_WG      256   // largest work-group size used
+#define BATCH_BK      16    // depth of the A and B slices held in local memory
+#define BATCH_ELEMS   1024  // elements of C a work-group aims to compute
+#define BATCH_MAX_EPT 64    // most elements of C held in registers per work-item
+
+//------------------------------------------------------------------------------
+//  Sparse formats and kernels (C_spmv_csr.cl, C_spmv_sell.cl, C_spmm_csr.cl),
+//  see sparse_lib.cpp
+//------------------------------------------------------------------------------
+#define SPARSE_DENSITY 0.02  // default fraction of nonzeros in A
+#define SPMV_WG       128   // work-group size of the vector CSR kernel
+#define SELL_C        32    // rows per slice of SELL-C-sigma
+#define SELL_SIGMA    256   // rows sorted by length together in SELL-C-sigma
 
 #endif
@@ -5,17 +5,23 @@
 //  PURPOSE: This is a simple set of functions to manipulate
 //           matrices used with the multiplcation driver.
 //
-//  USAGE:   The matrices are square and the order is
-//           set as a defined constant, ORDER.
+//  USAGE:   A is M x K, B is K x N and C is M x N, all stored
+//           row-major.
 //
 //  HISTORY: Written by Tim Mattson, August 2010
 //           Modified by Simon McIntosh-Smith, September 2011
 //           Modified by Tom Deakin and Simon McIntosh-Smith, October 2012
 //           Updated to C++ Wrapper v1.2.6 by Tom Deakin, August 2013
 //           Modified to assume square matrices by Simon McIntosh-Smith, Sep 2014
+//           Generalised to rectangular A(M,K), B(K,N) and C(M,N)
+//           Templated on the element and accumulator types (precision.hpp)
 //
 //------------------------------------------------------------------------------
 
+#include <climits>
+#include <algorithm>
+#include <sstream>
+
 #include "matmul.hpp"
 
 //------------------------------------------------------------------------------
@@ -24,19 +30,20 @@
 //
 //------------------------------------------------------------------------------
 
-void seq_mat_mul_sdot(int N, std::vector<float>& A, std::vector<float>& B, std::vector<float>& C)
+template <typename T, typename TC, typename Acc>
+void seq_mat_mul_sdot(int M, int N, int K, util::aligned_vector<T>& A, util::aligned_vector<T>& B, util::aligned_vector<TC>& C)
 {
     int i, j, k;
-    float tmp;
+    Acc tmp;
 
-    for (i = 0; i < N; i++) {
+    for (i = 0; i < M; i++) {
         for (j = 0; j < N; j++) {
-            tmp = 0.0f;
-            for (k = 0; k < N; k++) {
+            tmp = 0;
+            for (k = 0; k < K; k++) {
                 /* C(i,j) = sum(over k) A(i,k) * B(k,j) */
-                tmp += A[i*N+k] * B[k*N+j];
+                tmp += (Acc)A[i*K+k] * (Acc)B[k*N+j];
             }
-            C[i*N+j] = tmp;
+            C[i*N+j] = (TC)tmp;
         }
     }
 }
@@ -46,23 +53,46 @@ void seq_mat_mul_sdot(int N, std::vector<float>& A, std::vector<float>& B, std::
 //  Function to initialize the input matrices A and B
 //
 //------------------------------------------------------------------------------
-void initmat(int N, std::vector<float>& A, std::vector<float>& B, std::vector<float>& C)
+template <typename T, typename TC>
+void initmat(int M, int N, int K, util::aligned_vector<T>& A, util::aligned_vector<T>& B, util::aligned_vector<TC>& C)
 {
     int i, j;
 
     /* Initialize matrices */
 
-    for (i = 0; i < N; i++)
-        for (j = 0; j < N; j++)
-            A[i*N+j] = AVAL;
+    for (i = 0; i < M; i++)
+        for (j = 0; j < K; j++)
+            A[i*K+j] = (T)AVAL;
 
-    for (i = 0; i < N; i++)
+    for (i = 0; i < K; i++)
         for (j = 0; j < N; j++)
-            B[i*N+j] = BVAL;
+            B[i*N+j] = (T)BVAL;
 
-    for (i = 0; i < N; i++)
+    for (i = 0; i < M; i++)
         for (j = 0; j < N; j++)
-            C[i*N+j] = 0.0f;
+            C[i*N+j] = (TC)0;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to initialize A and B with random values (the same every call)
+//
+//------------------------------------------------------------------------------
+template <typename T, typename TC>
+void initmat_random(int M, int N, int K, util::aligned_vector<T>& A, util::aligned_vector<T>& B, util::aligned_vector<TC>& C)
+{
+    int i;
+
+    srand(RAND_SEED);
+
+    for (i = 0; i < M*K; i++)
+        A[i] = (T)(2.0 * rand() / RAND_MAX - 1.0);
+
+    for (i = 0; i < K*N; i++)
+        B[i] = (T)(2.0 * rand() / RAND_MAX - 1.0);
+
+    for (i = 0; i < M*N; i++)
+        C[i] = (TC)0;
 }
 
 //------------------------------------------------------------------------------
@@ -70,27 +100,29 @@ void initmat(int N, std::vector<float>& A, std::vector<float>& B, std::vector<fl
 //  Function to set a matrix to zero
 //
 //------------------------------------------------------------------------------
-void zero_mat (int N, std::vector<float>& C)
+template <typename T>
+void zero_mat (int M, int N, util::aligned_vector<T>& C)
 {
     int i, j;
 
-    for (i = 0; i < N; i++)
+    for (i = 0; i < M; i++)
         for (j = 0; j < N; j++)
-            C[i*N+j] = 0.0f;
+            C[i*N+j] = (T)0;
 }
 
 //------------------------------------------------------------------------------
 //
-//  Function to fill Btrans(N,N) with transpose of B(N,N)
+//  Function to fill Btrans(N,K) with transpose of B(K,N)
 //
 //------------------------------------------------------------------------------
-void trans(int N, std::vector<float>& B, std::vector<float>& Btrans)
+template <typename T>
+void trans(int K, int N, util::aligned_vector<T>& B, util::aligned_vector<T>& Btrans)
 {
     int i, j;
 
-    for (i = 0; i < N; i++)
+    for (i = 0; i < K; i++)
         for (j = 0; j < N; j++)
-            Btrans[j*N+i] = B[i*N+j];
+            Btrans[j*K+i] = B[i*N+j];
 }
 
 //------------------------------------------------------------------------------
@@ -98,16 +130,17 @@ void trans(int N, std::vector<float>& B, std::vector<float>& Btrans)
 //  Function to compute errors of the product matrix
 //
 //------------------------------------------------------------------------------
-float error(int N, std::vector<float>& C)
+template <typename T, typename Acc>
+Acc error(int M, int N, int K, util::aligned_vector<T>& C)
 {
    int i,j;
-   float cval, errsq, err;
-   cval = (float) N * AVAL * BVAL;
-   errsq = 0.0f;
+   Acc cval, errsq, err;
+   cval = (Acc) K * AVAL * BVAL;
+   errsq = 0;
 
-    for (i = 0; i < N; i++) {
+    for (i = 0; i < M; i++) {
         for (j = 0; j < N; j++) {
-            err = C[i*N+j] - cval;
+            err = (Acc)C[i*N+j] - cval;
             errsq += err * err;
         }
     }
@@ -119,16 +152,238 @@ float error(int N, std::vector<float>& C)
 //  Function to analyze and output results
 //
 //------------------------------------------------------------------------------
-void results(int N, std::vector<float>& C, double run_time)
+template <typename T, typename Acc>
+void results(int M, int N, int K, util::aligned_vector<T>& C, double run_time)
 {
 
     float mflops;
-    float errsq;
+    Acc errsq;
     
-    mflops = 2.0 * N * N * N/(1000000.0f * run_time);
+    mflops = 2.0 * M * N * K/(1000000.0f * run_time);
+    printf(" %.2f seconds at %.1f MFLOPS \n",  run_time,mflops);
+    errsq = error<T, Acc>(M, N, K, C);
+    if (std::isnan((double)errsq) || errsq > TOL)
+           printf("\n Errors in multiplication: %f\n",(double)errsq);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to check the product with Freivalds' algorithm.  Each round
+//  takes a random r and computes B*r, A*(B*r) and C*r, three matrix-vector
+//  products, with the rows shared between threads.  An error in C shows up
+//  as a difference in C*r unless r happens to be orthogonal to it, which
+//  for real valued r almost never happens; a second round makes sure.
+//
+//------------------------------------------------------------------------------
+template <typename T, typename TC>
+double freivalds(int M, int N, int K, util::aligned_vector<T>& A, util::aligned_vector<T>& B, util::aligned_vector<TC>& C, int rounds)
+{
+    return freivalds(M, N, K, &A[0], &B[0], &C[0], rounds);
+}
+
+template <typename T, typename TC>
+double freivalds(int M, int N, int K, const T *A, const T *B, const TC *C, int rounds)
+{
+    std::vector<double> r(N), Br(K), ABr(M), Cr(M);
+    unsigned int seed = RAND_SEED;
+    double worst = 0.0;
+
+    for (int round = 0; round < rounds; round++) {
+
+        // Own generator, so the rand() sequence of the caller is untouched
+        for (int j = 0; j < N; j++) {
+            seed = seed * 1103515245u + 12345u;
+            r[j] = 2.0 * (seed >> 8) / (double)(1u << 24) - 1.0;
+        }
+
+        #pragma omp parallel for
+        for (int k = 0; k < K; k++) {
+            double tmp = 0.0;
+            for (int j = 0; j < N; j++)
+                tmp += (double)B[(size_t)k*N+j] * r[j];
+            Br[k] = tmp;
+        }
+
+        #pragma omp parallel for
+        for (int i = 0; i < M; i++) {
+            double ab = 0.0, c = 0.0;
+            for (int k = 0; k < K; k++)
+                ab += (double)A[(size_t)i*K+k] * Br[k];
+            for (int j = 0; j < N; j++)
+                c += (double)C[(size_t)i*N+j] * r[j];
+            ABr[i] = ab;
+            Cr[i] = c;
+        }
+
+        double sumsq = 0.0, maxdiff = 0.0;
+        for (int i = 0; i < M; i++) {
+            const double diff = fabs(Cr[i] - ABr[i]);
+            if (std::isnan(diff))
+                return diff;
+            maxdiff = std::max(maxdiff, diff);
+            sumsq += ABr[i] * ABr[i];
+        }
+
+        const double rms = sqrt(sumsq / M);
+        worst = std::max(worst, rms > 0.0 ? maxdiff / rms : maxdiff);
+    }
+    return worst;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to analyze and output results, checking the product of A and B
+//
+//------------------------------------------------------------------------------
+template <typename T, typename TC>
+void results(int M, int N, int K, util::aligned_vector<T>& A, util::aligned_vector<T>& B, util::aligned_vector<TC>& C, double run_time)
+{
+
+    float mflops;
+    double residual;
+
+    mflops = 2.0 * M * N * K/(1000000.0f * run_time);
     printf(" %.2f seconds at %.1f MFLOPS \n",  run_time,mflops);
-    errsq = error(N, C);
-    if (std::isnan(errsq) || errsq > TOL)
-           printf("\n Errors in multiplication: %f\n",errsq);
+    residual = freivalds(M, N, K, A, B, C, FREIVALDS_ROUNDS);
+    if (std::isnan(residual) || residual > FREIVALDS_TOL(K))
+           printf("\n Errors in multiplication: residual %g\n", residual);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to fill a matrix with random values in [-1, 1]
+//
+//------------------------------------------------------------------------------
+void randmat(int rows, int cols, util::aligned_vector<double>& X)
+{
+    int i;
+
+    for (i = 0; i < rows*cols; i++)
+        X[i] = 2.0 * rand() / RAND_MAX - 1.0;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to convert a double matrix to storage type T
+//
+//------------------------------------------------------------------------------
+template <typename T>
+void quantize(int rows, int cols, util::aligned_vector<double>& X, util::aligned_vector<T>& Xq)
+{
+    int i;
+    const double scale = precision<T>::scale();
+
+    for (i = 0; i < rows*cols; i++)
+        Xq[i] = precision<T>::convert(X[i] * scale);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the error of C relative to the reference product
+//
+//------------------------------------------------------------------------------
+template <typename T>
+double ref_error(int M, int N, util::aligned_vector<T>& C, double scale, util::aligned_vector<double>& Cref)
+{
+    int i;
+    double err, errsq = 0.0, refsq = 0.0;
+
+    for (i = 0; i < M*N; i++) {
+        err = (double)C[i] / scale - Cref[i];
+        errsq += err * err;
+        refsq += Cref[i] * Cref[i];
+    }
+    return refsq > 0.0 ? sqrt(errsq / refsq) : sqrt(errsq);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to check that a batch of operands fits its buffer
+//
+//------------------------------------------------------------------------------
+void check_operand(const char *const errors[3], int lines, int used, int ld,
+    const cl::Buffer& X, size_t off, int stride, int batch, size_t size)
+{
+    if (ld < std::max(1, used))
+        throw cl::Error(CL_INVALID_VALUE, errors[0]);
+
+    if (lines == 0 || used == 0 || batch == 0)
+        return;
+    const size_t end = off + (size_t)(batch - 1) * stride + (size_t)(lines - 1) * ld + used;
+    if (end > X.getInfo<CL_MEM_SIZE>() / size)
+        throw cl::Error(CL_INVALID_VALUE, errors[1]);
+    if (end > INT_MAX)
+        throw cl::Error(CL_INVALID_VALUE, errors[2]);
 }
 
+std::string device_key(const cl::Context& context, const cl::Device& device)
+{
+    std::ostringstream key;
+    key << (const void*)context() << " " << (const void*)device();
+    return key.str();
+}
+
+//------------------------------------------------------------------------------
+//
+//  The precisions the library is built for (see precision.hpp)
+//
+//------------------------------------------------------------------------------
+template void seq_mat_mul_sdot<float,   float,  float >(int, int, int, util::aligned_vector<float>&,   util::aligned_vector<float>&,   util::aligned_vector<float>&);
+template void seq_mat_mul_sdot<double,  double, double>(int, int, int, util::aligned_vector<double>&,  util::aligned_vector<double>&,  util::aligned_vector<double>&);
+template void seq_mat_mul_sdot<half_t,  half_t, float >(int, int, int, util::aligned_vector<half_t>&,  util::aligned_vector<half_t>&,  util::aligned_vector<half_t>&);
+template void seq_mat_mul_sdot<cl_char, cl_int, cl_int>(int, int, int, util::aligned_vector<cl_char>&, util::aligned_vector<cl_char>&, util::aligned_vector<cl_int>&);
+
+template void initmat<float,   float >(int, int, int, util::aligned_vector<float>&,   util::aligned_vector<float>&,   util::aligned_vector<float>&);
+template void initmat<double,  double>(int, int, int, util::aligned_vector<double>&,  util::aligned_vector<double>&,  util::aligned_vector<double>&);
+template void initmat<half_t,  half_t>(int, int, int, util::aligned_vector<half_t>&,  util::aligned_vector<half_t>&,  util::aligned_vector<half_t>&);
+template void initmat<cl_char, cl_int>(int, int, int, util::aligned_vector<cl_char>&, util::aligned_vector<cl_char>&, util::aligned_vector<cl_int>&);
+
+template void initmat_random<float,  float >(int, int, int, util::aligned_vector<float>&,  util::aligned_vector<float>&,  util::aligned_vector<float>&);
+template void initmat_random<double, double>(int, int, int, util::aligned_vector<double>&, util::aligned_vector<double>&, util::aligned_vector<double>&);
+
+template void zero_mat<float >(int, int, util::aligned_vector<float>&);
+template void zero_mat<double>(int, int, util::aligned_vector<double>&);
+template void zero_mat<half_t>(int, int, util::aligned_vector<half_t>&);
+template void zero_mat<cl_int>(int, int, util::aligned_vector<cl_int>&);
+
+template void trans<float  >(int, int, util::aligned_vector<float>&,   util::aligned_vector<float>&);
+template void trans<double >(int, int, util::aligned_vector<double>&,  util::aligned_vector<double>&);
+template void trans<half_t >(int, int, util::aligned_vector<half_t>&,  util::aligned_vector<half_t>&);
+template void trans<cl_char>(int, int, util::aligned_vector<cl_char>&, util::aligned_vector<cl_char>&);
+
+template float  error<float,  float >(int, int, int, util::aligned_vector<float>&);
+template float  error<double, float >(int, int, int, util::aligned_vector<double>&);
+template float  error<half_t, float >(int, int, int, util::aligned_vector<half_t>&);
+template float  error<cl_int, float >(int, int, int, util::aligned_vector<cl_int>&);
+template double error<float,  double>(int, int, int, util::aligned_vector<float>&);
+template double error<double, double>(int, int, int, util::aligned_vector<double>&);
+template double error<half_t, double>(int, int, int, util::aligned_vector<half_t>&);
+template double error<cl_int, double>(int, int, int, util::aligned_vector<cl_int>&);
+
+template void results<float,  float >(int, int, int, util::aligned_vector<float>&,  double);
+template void results<double, float >(int, int, int, util::aligned_vector<double>&, double);
+template void results<half_t, float >(int, int, int, util::aligned_vector<half_t>&, double);
+template void results<cl_int, float >(int, int, int, util::aligned_vector<cl_int>&, double);
+template void results<float,  double>(int, int, int, util::aligned_vector<float>&,  double);
+template void results<double, double>(int, int, int, util::aligned_vector<double>&, double);
+template void results<half_t, double>(int, int, int, util::aligned_vector<half_t>&, double);
+template void results<cl_int, double>(int, int, int, util::aligned_vector<cl_int>&, double);
+
+template double freivalds<float,  float >(int, int, int, util::aligned_vector<float>&,  util::aligned_vector<float>&,  util::aligned_vector<float>&,  int);
+template double freivalds<double, double>(int, int, int, util::aligned_vector<double>&, util::aligned_vector<double>&, util::aligned_vector<double>&, int);
+template double freivalds<float,  float >(int, int, int, const float *,  const float *,  const float *,  int);
+template double freivalds<double, double>(int, int, int, const double *, const double *, const double *, int);
+
+template void results<float,  float >(int, int, int, util::aligned_vector<float>&,  util::aligned_vector<float>&,  util::aligned_vector<float>&,  double);
+template void results<double, double>(int, int, int, util::aligned_vector<double>&, util::aligned_vector<double>&, util::aligned_vector<double>&, double);
+
+template void quantize<float  >(int, int, util::aligned_vector<double>&, util::aligned_vector<float>&);
+template void quantize<double >(int, int, util::aligned_vector<double>&, util::aligned_vector<double>&);
+template void quantize<half_t >(int, int, util::aligned_vector<double>&, util::aligned_vector<half_t>&);
+template void quantize<cl_char>(int, int, util::aligned_vector<double>&, util::aligned_vector<cl_char>&);
+
+template double ref_error<float >(int, int, util::aligned_vector<float>&,  double, util::aligned_vector<double>&);
+template double ref_error<double>(int, int, util::aligned_vector<double>&, double, util::aligned_vector<double>&);
+template double ref_error<half_t>(int, int, util::aligned_vector<half_t>&, double, util::aligned_vector<double>&);
+template double ref_error<cl_int>(int, int, util::aligned_vector<cl_int>&, double, util::aligned_vector<double>&);
+
@@ -2,52 +2,74 @@
 //
 //  PROGRAM: Matrix library include file (function prototypes)
 //
-//  HISTORY: Written by Tim Mattson, August 2010 
+//  HISTORY: Written by Tim Mattson, August 2010
 //           Modified by Simon McIntosh-Smith, September 2011
 //           Modified by Tom Deakin and Simon McIntosh-Smith, October 2012
 //           Updated to C++ Wrapper v1.2.6 by Tom Deakin, August 2013
 //           Modified to assume square matrices by Simon McIntosh-Smith, Sep 2014
+//           Generalised to rectangular A(M,K), B(K,N) and C(M,N)
+//           Templated on the element and accumulator types (precision.hpp)
 //
 //------------------------------------------------------------------------------
 
 #ifndef __MATRIX_LIB_HDR
 #define __MATRIX_LIB_HDR
 
+// Host matrices are page aligned (aligned_allocator.hpp), so they can back
+// CL_MEM_USE_HOST_PTR buffers without the runtime copying them
+#include "aligned_allocator.hpp"
+
 
 //------------------------------------------------------------------------------
 //
 //  Function to compute the matrix product (sequential algorithm, dot producdt)
+//  with A and B of type T, C of type TC and the dot products summed in Acc
 //
 //------------------------------------------------------------------------------
-void seq_mat_mul_sdot(int N, std::vector<float> &A, std::vector<float> &B, std::vector<float> &C);
+template <typename T, typename TC, typename Acc = typename precision<T>::acc_t>
+void seq_mat_mul_sdot(int M, int N, int K, util::aligned_vector<T> &A, util::aligned_vector<T> &B, util::aligned_vector<TC> &C);
 
 //------------------------------------------------------------------------------
 //
 //  Function to initialize the input matrices A and B
 //
 //------------------------------------------------------------------------------
-void initmat(int N, std::vector<float>& A, std::vector<float>& B, std::vector<float>& C);
+template <typename T, typename TC>
+void initmat(int M, int N, int K, util::aligned_vector<T>& A, util::aligned_vector<T>& B, util::aligned_vector<TC>& C);
+
+//------------------------------------------------------------------------------
+//
+//  Function to initialize A and B with random values in [-1, 1] (the same
+//  values on every call) and set C to zero
+//
+//------------------------------------------------------------------------------
+template <typename T, typename TC>
+void initmat_random(int M, int N, int K, util::aligned_vector<T>& A, util::aligned_vector<T>& B, util::aligned_vector<TC>& C);
 
 //------------------------------------------------------------------------------
 //
 //  Function to set a matrix to zero 
 //
 //------------------------------------------------------------------------------
-void zero_mat (int N, std::vector<float> &C);
+template <typename T>
+void zero_mat (int M, int N, util::aligned_vector<T> &C);
 
 //------------------------------------------------------------------------------
 //
-//  Function to fill Btrans(Mdim,Pdim)  with transpose of B(Pdim,Mdim)
+//  Function to fill Btrans(N,K) with transpose of B(K,N)
 //
 //------------------------------------------------------------------------------
-void trans(int N, std::vector<float>& B, std::vector<float>& Btrans);
+template <typename T>
+void trans(int K, int N, util::aligned_vector<T>& B, util::aligned_vector<T>& Btrans);
 
 //------------------------------------------------------------------------------
 //
-//  Function to compute errors of the product matrix
+//  Function to compute errors of the product matrix (the sum of the squared
+//  errors is accumulated in Acc)
 //
 //------------------------------------------------------------------------------
-float error(int N, std::vector<float>& C);
+template <typename T, typename Acc = float>
+Acc error(int M, int N, int K, util::aligned_vector<T>& C);
 
 
 //------------------------------------------------------------------------------
@@ -55,6 +77,71 @@ float error(int N, std::vector<float>& C);
 //  Function to analyze and output results 
 //
 //------------------------------------------------------------------------------
-void results(int N, std::vector<float>& C, double run_time);
-    
+template <typename T, typename Acc = float>
+void results(int M, int N, int K, util::aligned_vector<T>& C, double run_time);
+
+//------------------------------------------------------------------------------
+//
+//  Function to check C = A * B with Freivalds' algorithm: C*r is compared
+//  with A*(B*r) for random vectors r, which is O(N^2) work against the
+//  O(N^3) of a reference product, and works for any A and B.  Returns the
+//  largest difference relative to the rms of A*(B*r) over the rounds.
+//
+//------------------------------------------------------------------------------
+template <typename T, typename TC>
+double freivalds(int M, int N, int K, util::aligned_vector<T>& A, util::aligned_vector<T>& B, util::aligned_vector<TC>& C, int rounds);
+
+// The same on row major arrays anywhere in memory (a mapped file, say)
+template <typename T, typename TC>
+double freivalds(int M, int N, int K, const T *A, const T *B, const TC *C, int rounds);
+
+//------------------------------------------------------------------------------
+//
+//  Function to analyze and output results, checking C against A and B with
+//  freivalds() rather than against the constant matrices of initmat()
+//
+//------------------------------------------------------------------------------
+template <typename T, typename TC>
+void results(int M, int N, int K, util::aligned_vector<T>& A, util::aligned_vector<T>& B, util::aligned_vector<TC>& C, double run_time);
+
+//------------------------------------------------------------------------------
+//
+//  Function to fill a matrix with random values in [-1, 1]
+//
+//------------------------------------------------------------------------------
+void randmat(int rows, int cols, util::aligned_vector<double>& X);
+
+//------------------------------------------------------------------------------
+//
+//  Function to convert a double matrix to storage type T (scaled by
+//  precision<T>::scale(), see precision.hpp)
+//
+//------------------------------------------------------------------------------
+template <typename T>
+void quantize(int rows, int cols, util::aligned_vector<double>& X, util::aligned_vector<T>& Xq);
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the error of C (scaled by scale) relative to the
+//  reference product Cref, as norm(C/scale - Cref) / norm(Cref)
+//
+//------------------------------------------------------------------------------
+template <typename T>
+double ref_error(int M, int N, util::aligned_vector<T>& C, double scale, util::aligned_vector<double>& Cref);
+
+//------------------------------------------------------------------------------
+//
+//  Function to check that a batch of operands in a buffer, from element
+//  off, each lines of used elements ld apart and stride from the last, fit
+//  it.  size is the bytes of an element.  errors are the messages for: ld
+//  too small, overruns the buffer, too large for the kernels' int indices
+//  (literals, as cl::Error keeps only the pointer).
+//
+//------------------------------------------------------------------------------
+void check_operand(const char *const errors[3], int lines, int used, int ld,
+    const cl::Buffer& X, size_t off, int stride, int batch, size_t size);
+
+// Key of a device in a context, for maps of the kernels built for it
+std::string device_key(const cl::Context& context, const cl::Device& device);
+
 #endif
@@ -0,0 +1,186 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Matrix multiplication across several devices
+//
+//  PURPOSE: Split C = A * B by blocks of rows between all devices:
+//
+//             C(rows of device d) = A(rows of device d) * B
+//
+//           1. Every device gets a context, a queue, its tuned block sizes
+//              and a copy of B.
+//           2. Calibration: every device computes the same first
+//              MULTI_CALIB_ROWS rows of C (after a warm up run) and its
+//              rate in MFLOPS is measured, including the upload of A and
+//              the download of C.
+//           3. The rows of C are split in proportion to the rates, in
+//              whole blocks of the largest row block (tsm) of any device.
+//           4. Each device uploads its rows of A, runs the register tiled
+//              kernel (C_block_reg.cl) and downloads its rows of C
+//              straight into place.  All devices are started before any is
+//              waited for, so they run at the same time.
+//
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "matmul.hpp"
+#include "multi.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+
+#define MULTI_CALIB_ROWS 256     // rows of C in each device's calibration run
+
+//------------------------------------------------------------------------------
+//
+//  Everything belonging to one device
+//
+//------------------------------------------------------------------------------
+struct Worker
+{
+    cl::Device       device;
+    cl::Context      context;
+    cl::CommandQueue queue;
+    cl::Kernel       kernel;
+    TuneParams       params;
+
+    cl::Buffer       d_a, d_b, d_c;     // rows of A, all of B, rows of C
+    int              row0, rows;        // the block of rows of A and C
+    double           rate;              // calibrated MFLOPS
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to build the register tiled kernel for a block of rows
+//
+//------------------------------------------------------------------------------
+static void build_kernel(Worker& w, int rows, int N, int K)
+{
+    cl::Program program = util::buildProgram(w.context, util::kernelSource("C_block_reg.cl"),
+        reg_options(w.params, rows, N, K));
+    w.kernel = cl::Kernel(program, "mmul");
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue the upload of rows row0 .. row0+rows-1 of A, the
+//  kernel for those rows of C and the download of them into C
+//
+//------------------------------------------------------------------------------
+static void enqueue_rows(Worker& w, int row0, int rows, int N, int K,
+    util::aligned_vector<float>& A, util::aligned_vector<float>& C)
+{
+    const TuneParams& p = w.params;
+
+    w.queue.enqueueWriteBuffer(w.d_a, CL_FALSE, 0, sizeof(float) * (size_t)rows * K,
+        &A[(size_t)row0 * K]);
+
+    w.kernel.setArg(0, rows);
+    w.kernel.setArg(1, N);
+    w.kernel.setArg(2, K);
+    w.kernel.setArg(3, w.d_a);
+    w.kernel.setArg(4, w.d_b);
+    w.kernel.setArg(5, w.d_c);
+    w.kernel.setArg(6, cl::Local(sizeof(float) * p.tsk*p.tsm));
+    w.kernel.setArg(7, cl::Local(sizeof(float) * p.tsk*p.tsn));
+    w.queue.enqueueNDRangeKernel(w.kernel, cl::NullRange,
+        cl::NDRange(ROUND_UP(N, p.tsn)/p.wptn, ROUND_UP(rows, p.tsm)/p.wptm),
+        cl::NDRange(p.tsn/p.wptn, p.tsm/p.wptm));
+
+    w.queue.enqueueReadBuffer(w.d_c, CL_FALSE, 0, sizeof(float) * (size_t)rows * N,
+        &C[(size_t)row0 * N]);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute C = A * B across the given devices
+//
+//------------------------------------------------------------------------------
+double multi_mmul(std::vector<cl::Device>& devices, int M, int N, int K,
+    util::aligned_vector<float>& A, util::aligned_vector<float>& B, util::aligned_vector<float>& C)
+{
+    util::Timer timer;
+    std::vector<Worker> workers(devices.size());
+
+    // Set up every device
+    int gran = 1;
+    for (size_t d = 0; d < workers.size(); d++)
+    {
+        Worker& w = workers[d];
+        w.device  = devices[d];
+        w.context = cl::Context(std::vector<cl::Device>(1, w.device));
+        w.queue   = cl::CommandQueue(w.context, w.device);
+        w.params  = default_tune_params();
+        load_tuning(TUNE_DB, w.device, M, N, K, w.params);
+        w.d_b     = cl::Buffer(w.context, B.begin(), B.end(), true);
+        gran = std::max(gran, w.params.tsm);
+    }
+
+    // Calibrate each device on the same rows of C
+    const int calib = std::min(M, ROUND_UP(MULTI_CALIB_ROWS, gran));
+    double total = 0.0;
+    for (size_t d = 0; d < workers.size(); d++)
+    {
+        Worker& w = workers[d];
+        w.d_a = cl::Buffer(w.context, CL_MEM_READ_ONLY,  sizeof(float) * (size_t)calib * K);
+        w.d_c = cl::Buffer(w.context, CL_MEM_WRITE_ONLY, sizeof(float) * (size_t)calib * N);
+        build_kernel(w, calib, N, K);
+
+        enqueue_rows(w, 0, calib, N, K, A, C);
+        w.queue.finish();
+
+        uint64_t start = timer.getTimeMicroseconds();
+        enqueue_rows(w, 0, calib, N, K, A, C);
+        w.queue.finish();
+        double run_time = (timer.getTimeMicroseconds() - start) / 1.0e6;
+
+        w.rate = 2.0 * calib * N * K / (1000000.0 * run_time);
+        total += w.rate;
+    }
+
+    // Split the rows of C in proportion to the rates
+    double share = 0.0;
+    int row = 0;
+    for (size_t d = 0; d < workers.size(); d++)
+    {
+        Worker& w = workers[d];
+        share += w.rate;
+        int end = (d + 1 == workers.size())
+            ? M : (int)(M * (share / total) / gran + 0.5) * gran;
+        end = std::max(row, std::min(M, end));
+
+        w.row0 = row;
+        w.rows = end - row;
+        row = end;
+
+        printf(" %-40.40s %10.1f MFLOPS, rows %6d to %6d (%5.1f%%)\n",
+            w.device.getInfo<CL_DEVICE_NAME>().c_str(), w.rate,
+            w.row0, w.row0 + w.rows, 100.0 * w.rows / M);
+    }
+
+    // Size the buffers and kernels for each device's rows
+    for (size_t d = 0; d < workers.size(); d++)
+    {
+        Worker& w = workers[d];
+        if (w.rows == 0)
+            continue;
+        w.d_a = cl::Buffer(w.context, CL_MEM_READ_ONLY,  sizeof(float) * (size_t)w.rows * K);
+        w.d_c = cl::Buffer(w.context, CL_MEM_WRITE_ONLY, sizeof(float) * (size_t)w.rows * N);
+        build_kernel(w, w.rows, N, K);
+    }
+
+    // Start every device, then wait for them all
+    uint64_t start = timer.getTimeMicroseconds();
+
+    for (size_t d = 0; d < workers.size(); d++)
+    {
+        Worker& w = workers[d];
+        if (w.rows == 0)
+            continue;
+        enqueue_rows(w, w.row0, w.rows, N, K, A, C);
+        w.queue.flush();
+    }
+    for (size_t d = 0; d < workers.size(); d++)
+        workers[d].queue.finish();
+
+    return (timer.getTimeMicroseconds() - start) / 1.0e6;
+}
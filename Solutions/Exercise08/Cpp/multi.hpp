@@ -0,0 +1,30 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Matrix multiplication across several devices (function
+//           prototypes)
+//
+//  PURPOSE: Use every OpenCL device in the node at once.  Each device gets
+//           its own context and queue (devices on different platforms
+//           cannot share a context), a copy of B and a block of rows of A
+//           and C.  The blocks are sized in proportion to the throughput
+//           each device reaches on a short calibration run, so a CPU
+//           runtime next to a GPU takes the share it can keep up with.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __MULTI_HDR
+#define __MULTI_HDR
+
+#include "tuner.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute C = A * B for A(M,K), B(K,N) and C(M,N) across the
+//  given devices, printing the calibrated rate and share of C of each one.
+//  Returns the run time in seconds (calibration and setup not included).
+//
+//------------------------------------------------------------------------------
+double multi_mmul(std::vector<cl::Device>& devices, int M, int N, int K,
+    util::aligned_vector<float>& A, util::aligned_vector<float>& B, util::aligned_vector<float>& C);
+
+#endif
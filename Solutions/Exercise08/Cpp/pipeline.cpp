@@ -0,0 +1,158 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Pipelined repeated matrix multiplication
+//
+//  PURPOSE: Run a stream of independent products C = A * B with the
+//           register tiled kernel (C_block_reg.cl), keeping the device
+//           and the host busy at the same time.
+//
+//           Job j uses the device buffer set (slot) j % PIPE_SLOTS and
+//           the host array for C of the same slot.  Events order the
+//           work on each slot:
+//
+//             upload of A and B  waits for the kernel that last read
+//                                the slot (job j - PIPE_SLOTS)
+//             kernel             waits for its uploads and for the
+//                                download of the C last in the slot
+//             download of C      waits for the kernel
+//
+//           The host enqueues job j and then waits for the download of
+//           job j-1 and checks it, so the check runs while job j computes
+//           and job j+1 uploads.  The host C of job j-1 is not written
+//           again until job j-1+PIPE_SLOTS, enqueued after the check.
+//
+//------------------------------------------------------------------------------
+
+#include "matmul.hpp"
+#include "pipeline.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  Function to fill A and B with random values in [-1, 1] from seed
+//
+//------------------------------------------------------------------------------
+static void random_pair(int M, int N, int K, unsigned int seed,
+    util::aligned_vector<float>& A, util::aligned_vector<float>& B)
+{
+    A.resize((size_t)M * K);
+    B.resize((size_t)K * N);
+
+    srand(seed);
+    for (size_t i = 0; i < A.size(); i++)
+        A[i] = (float)(2.0 * rand() / RAND_MAX - 1.0);
+    for (size_t i = 0; i < B.size(); i++)
+        B[i] = (float)(2.0 * rand() / RAND_MAX - 1.0);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run the job stream
+//
+//------------------------------------------------------------------------------
+PipelineStats pipeline_mmul(cl::Context& context, cl::Device& device, const TuneParams& params,
+    int M, int N, int K, int jobs)
+{
+    util::Timer timer;
+    PipelineStats stats = {jobs, 0, 0.0, 0.0};
+
+    util::aligned_vector<float> h_A[PIPE_PAIRS], h_B[PIPE_PAIRS];
+    for (int p = 0; p < PIPE_PAIRS; p++)
+        random_pair(M, N, K, RAND_SEED + p, h_A[p], h_B[p]);
+
+    cl::Program program = util::buildProgram(context, util::kernelSource("C_block_reg.cl"),
+        reg_options(params, M, N, K));
+    cl::Kernel kernel(program, "mmul");
+
+    cl::CommandQueue upload(context, device);
+    cl::CommandQueue compute(context, device);
+    cl::CommandQueue download(context, device);
+
+    const size_t Abytes = sizeof(float) * (size_t)M * K;
+    const size_t Bbytes = sizeof(float) * (size_t)K * N;
+    const size_t Cbytes = sizeof(float) * (size_t)M * N;
+
+    cl::Buffer d_a[PIPE_SLOTS], d_b[PIPE_SLOTS], d_c[PIPE_SLOTS];
+    util::aligned_vector<float> h_C[PIPE_SLOTS];
+    for (int s = 0; s < PIPE_SLOTS; s++)
+    {
+        d_a[s] = cl::Buffer(context, CL_MEM_READ_ONLY,  Abytes);
+        d_b[s] = cl::Buffer(context, CL_MEM_READ_ONLY,  Bbytes);
+        d_c[s] = cl::Buffer(context, CL_MEM_WRITE_ONLY, Cbytes);
+        h_C[s].resize((size_t)M * N);
+    }
+
+    const cl::NDRange global(ROUND_UP(N, params.tsn)/params.wptn, ROUND_UP(M, params.tsm)/params.wptm);
+    const cl::NDRange local(params.tsn/params.wptn, params.tsm/params.wptm);
+
+    // Enqueues job j into its slot, after the jobs before it in the slot
+    cl::Event computed[PIPE_SLOTS], c_read[PIPE_SLOTS];
+    bool busy[PIPE_SLOTS] = {false, false, false};
+    auto enqueue_job = [&](int j)
+    {
+        const int s = j % PIPE_SLOTS;
+        const int p = j % PIPE_PAIRS;
+        std::vector<cl::Event> waits, ready(2);
+
+        if (busy[s])
+            waits.push_back(computed[s]);
+        upload.enqueueWriteBuffer(d_a[s], CL_FALSE, 0, Abytes, &h_A[p][0], &waits, &ready[0]);
+        upload.enqueueWriteBuffer(d_b[s], CL_FALSE, 0, Bbytes, &h_B[p][0], &waits, &ready[1]);
+
+        kernel.setArg(0, M);
+        kernel.setArg(1, N);
+        kernel.setArg(2, K);
+        kernel.setArg(3, d_a[s]);
+        kernel.setArg(4, d_b[s]);
+        kernel.setArg(5, d_c[s]);
+        kernel.setArg(6, cl::Local(sizeof(float) * params.tsk*params.tsm));
+        kernel.setArg(7, cl::Local(sizeof(float) * params.tsk*params.tsn));
+        if (busy[s])
+            ready.push_back(c_read[s]);
+        compute.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, &ready, &computed[s]);
+
+        waits.assign(1, computed[s]);
+        download.enqueueReadBuffer(d_c[s], CL_FALSE, 0, Cbytes, &h_C[s][0], &waits, &c_read[s]);
+        busy[s] = true;
+
+        // Start the work now rather than when the host next blocks
+        upload.flush();
+        compute.flush();
+        download.flush();
+    };
+
+    // Waits for job j and checks its product
+    auto check_job = [&](int j)
+    {
+        const int s = j % PIPE_SLOTS;
+        const int p = j % PIPE_PAIRS;
+        c_read[s].wait();
+        const double residual = freivalds(M, N, K, h_A[p], h_B[p], h_C[s], FREIVALDS_ROUNDS);
+        if (std::isnan(residual) || residual > FREIVALDS_TOL(K))
+            stats.failed++;
+    };
+
+    // One job alone: the latency of a single request
+    uint64_t start = timer.getTimeMicroseconds();
+    enqueue_job(0);
+    check_job(0);
+    stats.latency = (timer.getTimeMicroseconds() - start) / 1.0e6;
+
+    download.finish();
+    for (int s = 0; s < PIPE_SLOTS; s++)
+        busy[s] = false;
+
+    // The stream: job j is enqueued before job j-1 is checked
+    start = timer.getTimeMicroseconds();
+    for (int j = 0; j < jobs; j++)
+    {
+        enqueue_job(j);
+        if (j > 0)
+            check_job(j - 1);
+    }
+    check_job(jobs - 1);
+    stats.seconds = (timer.getTimeMicroseconds() - start) / 1.0e6;
+
+    return stats;
+}
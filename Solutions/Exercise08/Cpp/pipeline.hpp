@@ -0,0 +1,45 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Pipelined repeated matrix multiplication (function prototypes)
+//
+//  PURPOSE: Multiply a sequence of independent A(M,K), B(K,N) pairs as a
+//           throughput job stream.  Uploads, kernels and downloads run on
+//           three in-order queues, ordered by events, and the host checks
+//           each product while the device works on the next ones, so the
+//           upload of job i+1, the kernel of job i and the download and
+//           check of job i-1 overlap.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __PIPELINE_HDR
+#define __PIPELINE_HDR
+
+#include "tuner.hpp"
+
+#define PIPE_SLOTS 3     // sets of device buffers (jobs in flight)
+#define PIPE_PAIRS 4     // distinct A, B pairs the jobs cycle through
+
+//------------------------------------------------------------------------------
+//
+//  Timings of a run of pipeline_mmul
+//
+//------------------------------------------------------------------------------
+struct PipelineStats
+{
+    int    jobs;        // jobs run in the pipeline
+    int    failed;      // products that failed the Freivalds check (the
+                        // single job included)
+    double latency;     // seconds for one job run alone, check included
+    double seconds;     // seconds for all the jobs in the pipeline
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to run one job alone, then jobs of them through the pipeline,
+//  checking every product with freivalds()
+//
+//------------------------------------------------------------------------------
+PipelineStats pipeline_mmul(cl::Context& context, cl::Device& device, const TuneParams& params,
+    int M, int N, int K, int jobs);
+
+#endif
@@ -0,0 +1,170 @@
+//------------------------------------------------------------------------------
+//
+//  Include file for the element types of the matrix multiply harness
+//
+//  PURPOSE: The matrix library and the blocked kernel (C_block_form.cl)
+//           can work in several precisions.  Each one has a storage type
+//           for A and B, an accumulator type for the dot products and a
+//           storage type for C:
+//
+//             name   A, B     accumulate   C       kernel build option
+//             fp32   float    float        float
+//             fp64   double   double       double  -DPREC_DOUBLE
+//             fp16   half     float        half    -DPREC_HALF
+//             int8   char     int          int     -DPREC_INT8
+//
+//           precision<T> describes these for storage type T.  Real valued
+//           inputs are converted to int8 with a fixed scale (x * 127), so
+//           the int8 product has to be divided by scale^2.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __PRECISION_HDR
+#define __PRECISION_HDR
+
+#include <cstring>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+//
+//  IEEE 754 half precision number for host storage.  There is no
+//  arithmetic, values are converted to float (exactly) and from float
+//  (rounding to nearest even) as they are used.
+//
+//------------------------------------------------------------------------------
+struct half_t
+{
+    cl_half bits;
+
+    half_t() {}
+
+    half_t(float f)
+    {
+        cl_uint x;
+        memcpy(&x, &f, sizeof(x));
+
+        const cl_uint sign = (x >> 16) & 0x8000;
+        const int     exp  = (int)((x >> 23) & 0xff) - 127 + 15;
+        cl_uint       mant = x & 0x7fffff;
+        cl_uint       h, rem, halfway;
+
+        if (((x >> 23) & 0xff) == 0xff)         // infinity or NaN
+        {
+            bits = (cl_half)(sign | 0x7c00 | (mant ? 0x200 : 0));
+            return;
+        }
+        if (exp >= 31)                          // too big, round to infinity
+        {
+            bits = (cl_half)(sign | 0x7c00);
+            return;
+        }
+        if (exp <= 0)                           // subnormal or zero
+        {
+            if (exp < -10)
+            {
+                bits = (cl_half)sign;
+                return;
+            }
+            const int shift = 14 - exp;
+            mant   |= 0x800000;
+            h       = mant >> shift;
+            rem     = mant & ((1u << shift) - 1);
+            halfway = 1u << (shift - 1);
+        }
+        else
+        {
+            h       = ((cl_uint)exp << 10) | (mant >> 13);
+            rem     = mant & 0x1fff;
+            halfway = 0x1000;
+        }
+
+        // A carry out of the mantissa correctly bumps the exponent
+        if (rem > halfway || (rem == halfway && (h & 1)))
+            h++;
+        bits = (cl_half)(sign | h);
+    }
+
+    operator float() const
+    {
+        const cl_uint sign = (cl_uint)(bits & 0x8000) << 16;
+        int           exp  = (bits >> 10) & 0x1f;
+        cl_uint       mant = bits & 0x3ff;
+        cl_uint       x;
+
+        if (exp == 0x1f)                        // infinity or NaN
+            x = sign | 0x7f800000 | (mant << 13);
+        else if (exp == 0 && mant == 0)         // zero
+            x = sign;
+        else
+        {
+            if (exp == 0)                       // subnormal: normalise it
+            {
+                exp = 1;
+                while (!(mant & 0x400))
+                {
+                    mant <<= 1;
+                    exp--;
+                }
+                mant &= 0x3ff;
+            }
+            x = sign | ((cl_uint)(exp + 112) << 23) | (mant << 13);
+        }
+
+        float f;
+        memcpy(&f, &x, sizeof(f));
+        return f;
+    }
+};
+
+//------------------------------------------------------------------------------
+//
+//  Description of each precision, by storage type of A and B
+//
+//------------------------------------------------------------------------------
+template <typename T> struct precision;
+
+template <> struct precision<float>
+{
+    typedef float acc_t;
+    typedef float out_t;
+    static const char *name()    { return "fp32"; }
+    static const char *options() { return ""; }
+    static double scale()        { return 1.0; }
+    static float convert(double x) { return (float)x; }
+};
+
+template <> struct precision<double>
+{
+    typedef double acc_t;
+    typedef double out_t;
+    static const char *name()    { return "fp64"; }
+    static const char *options() { return " -DPREC_DOUBLE"; }
+    static double scale()        { return 1.0; }
+    static double convert(double x) { return x; }
+};
+
+template <> struct precision<half_t>
+{
+    typedef float  acc_t;
+    typedef half_t out_t;
+    static const char *name()    { return "fp16 (fp32 accumulate)"; }
+    static const char *options() { return " -DPREC_HALF"; }
+    static double scale()        { return 1.0; }
+    static half_t convert(double x) { return half_t((float)x); }
+};
+
+template <> struct precision<cl_char>
+{
+    typedef cl_int acc_t;
+    typedef cl_int out_t;
+    static const char *name()    { return "int8 (int32 accumulate)"; }
+    static const char *options() { return " -DPREC_INT8"; }
+    static double scale()        { return 127.0; }
+    static cl_char convert(double x)
+    {
+        const double r = floor(x + 0.5);
+        return (cl_char)(r > 127.0 ? 127.0 : (r < -127.0 ? -127.0 : r));
+    }
+};
+
+#endif
@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Event based profiling for the matrix multiply driver
+//
+//  PURPOSE: Record the events of kernels and transfers and print where the
+//           time went:
+//
+//             queue latency  QUEUED -> SUBMIT, time spent in the host side
+//                            queue (averaged over the commands)
+//             launch latency SUBMIT -> START, time for the device to pick
+//                            the command up (averaged over the commands)
+//             kernel         START -> END of the kernels (total)
+//             transfers      START -> END of the reads and writes (total),
+//                            with the effective bandwidth
+//
+//------------------------------------------------------------------------------
+
+#include "matmul.hpp"
+#include "profile.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  Functions to record a kernel launch or a transfer
+//
+//------------------------------------------------------------------------------
+void profile_kernel(Profile& profile, const cl::Event& event)
+{
+    profile.kernels.push_back(event);
+}
+
+void profile_write(Profile& profile, cl::CommandQueue& queue, util::aligned_vector<float>& h, cl::Buffer& d)
+{
+    cl::Event event;
+    queue.enqueueWriteBuffer(d, CL_TRUE, 0, sizeof(float) * h.size(), &h[0], NULL, &event);
+    profile.transfers.push_back(event);
+    profile.bytes.push_back(sizeof(float) * h.size());
+}
+
+void profile_read(Profile& profile, cl::CommandQueue& queue, cl::Buffer& d, util::aligned_vector<float>& h)
+{
+    cl::Event event;
+    queue.enqueueReadBuffer(d, CL_TRUE, 0, sizeof(float) * h.size(), &h[0], NULL, &event);
+    profile.transfers.push_back(event);
+    profile.bytes.push_back(sizeof(float) * h.size());
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the time a finished command ran for
+//
+//------------------------------------------------------------------------------
+double profile_seconds(const cl::Event& event)
+{
+    return (event.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+          - event.getProfilingInfo<CL_PROFILING_COMMAND_START>()) * 1.0e-9;
+}
+
+double profile_seconds(const cl::Event& first, const cl::Event& last)
+{
+    return (last.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+          - first.getProfilingInfo<CL_PROFILING_COMMAND_START>()) * 1.0e-9;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to add up the stages of a list of events (in nanoseconds)
+//
+//------------------------------------------------------------------------------
+static void add_events(std::vector<cl::Event>& events,
+    double& queued, double& launch, double& run)
+{
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const cl_ulong q = events[i].getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>();
+        const cl_ulong s = events[i].getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>();
+        const cl_ulong b = events[i].getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        const cl_ulong e = events[i].getProfilingInfo<CL_PROFILING_COMMAND_END>();
+        queued += (double)(s - q);
+        launch += (double)(b - s);
+        run    += (double)(e - b);
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to print the breakdown of the recorded events and clear them
+//
+//------------------------------------------------------------------------------
+void profile_results(Profile& profile, double flops)
+{
+    double queued = 0.0, launch = 0.0, kernel = 0.0, transfer = 0.0;
+    size_t bytes = 0;
+
+    add_events(profile.kernels, queued, launch, kernel);
+    add_events(profile.transfers, queued, launch, transfer);
+    for (size_t i = 0; i < profile.bytes.size(); i++)
+        bytes += profile.bytes[i];
+
+    const size_t commands = profile.kernels.size() + profile.transfers.size();
+    if (commands > 0)
+    {
+        printf("   queue latency %.3f ms, launch latency %.3f ms (per command)\n",
+            queued / commands / 1.0e6, launch / commands / 1.0e6);
+    }
+    if (!profile.kernels.empty())
+    {
+        printf("   kernel    %10.3f ms", kernel / 1.0e6);
+        if (flops > 0.0 && kernel > 0.0)
+            printf(" at %.1f MFLOPS", flops / (kernel / 1.0e3));
+        printf("\n");
+    }
+    if (!profile.transfers.empty())
+    {
+        printf("   transfers %10.3f ms for %.1f MB", transfer / 1.0e6, bytes / 1.0e6);
+        if (transfer > 0.0)
+            printf(" at %.2f GB/s", bytes / transfer);
+        printf("\n");
+    }
+
+    profile.kernels.clear();
+    profile.transfers.clear();
+    profile.bytes.clear();
+}
@@ -0,0 +1,73 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Event based profiling for the matrix multiply driver
+//           (function prototypes)
+//
+//  PURPOSE: Timing an enqueue plus queue.finish() on the host mixes host
+//           overhead, launch latency and kernel time, and says nothing
+//           about the copies to and from the device.  With a queue created
+//           with CL_QUEUE_PROFILING_ENABLE every command's event records
+//           four device timestamps:
+//
+//             QUEUED   the host enqueued the command
+//             SUBMIT   the runtime submitted it to the device
+//             START    the device started it
+//             END      the device finished it
+//
+//           The driver collects the events of the kernels and transfers of
+//           each variant in a Profile and prints the breakdown with
+//           profile_results.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __PROFILE_HDR
+#define __PROFILE_HDR
+
+#include <vector>
+
+#include "aligned_allocator.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  The kernel and transfer events of one variant
+//
+//------------------------------------------------------------------------------
+struct Profile
+{
+    std::vector<cl::Event> kernels;     // kernel launches
+    std::vector<cl::Event> transfers;   // buffer reads and writes
+    std::vector<size_t>    bytes;       // bytes moved by each transfer
+};
+
+//------------------------------------------------------------------------------
+//
+//  Functions to record a kernel launch, or to copy a host vector to or from
+//  a buffer (blocking) and record the transfer
+//
+//------------------------------------------------------------------------------
+void profile_kernel(Profile& profile, const cl::Event& event);
+
+void profile_write(Profile& profile, cl::CommandQueue& queue, util::aligned_vector<float>& h, cl::Buffer& d);
+
+void profile_read(Profile& profile, cl::CommandQueue& queue, cl::Buffer& d, util::aligned_vector<float>& h);
+
+//------------------------------------------------------------------------------
+//
+//  Functions to return the time a finished command ran for (START to END)
+//  in seconds, or a sequence of commands from the START of the first to the
+//  END of the last
+//
+//------------------------------------------------------------------------------
+double profile_seconds(const cl::Event& event);
+
+double profile_seconds(const cl::Event& first, const cl::Event& last);
+
+//------------------------------------------------------------------------------
+//
+//  Function to print the breakdown of the recorded events and clear them.
+//  flops is the work done by all the kernels (0 to leave out MFLOPS).
+//
+//------------------------------------------------------------------------------
+void profile_results(Profile& profile, double flops);
+
+#endif
@@ -0,0 +1,133 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Sparse matrix formats
+//
+//  PURPOSE: Build the CSR, SELL-C-sigma and ELLPACK forms of a matrix and
+//           the host reference product for the sparse kernels.
+//
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "matmul.hpp"
+#include "sparse_lib.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  Function to fill a matrix with random nonzeros at a mean density
+//
+//------------------------------------------------------------------------------
+void sparse_random(int rows, int cols, double density, util::aligned_vector<float>& A)
+{
+    A.assign((size_t)rows * cols, 0.0f);
+    for (int i = 0; i < rows; i++)
+    {
+        // Squaring a uniform number skews the row lengths: most rows are
+        // short and a few are long, with a mean of density
+        const double u = (double)rand() / RAND_MAX;
+        const double p = std::min(1.0, 3.0 * u * u * density);
+        for (int j = 0; j < cols; j++)
+            if ((double)rand() / RAND_MAX < p)
+                A[(size_t)i*cols + j] = (float)(2.0 * rand() / RAND_MAX - 1.0);
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to convert a dense row major matrix to CSR form
+//
+//------------------------------------------------------------------------------
+CsrMatrix dense_to_csr(int rows, int cols, const util::aligned_vector<float>& A)
+{
+    CsrMatrix S;
+    S.rows = rows;
+    S.cols = cols;
+    S.row_ptr.assign(rows + 1, 0);
+
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            const float a = A[(size_t)i*cols + j];
+            if (a != 0.0f)
+            {
+                S.col.push_back(j);
+                S.val.push_back(a);
+            }
+        }
+        S.row_ptr[i+1] = (int)S.val.size();
+    }
+    return S;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to convert a CSR matrix to SELL-C-sigma form
+//
+//------------------------------------------------------------------------------
+SellMatrix csr_to_sell(const CsrMatrix& A, int c, int sigma)
+{
+    SellMatrix S;
+    S.rows  = A.rows;
+    S.cols  = A.cols;
+    S.c     = c;
+    S.sigma = sigma;
+    S.nnz   = A.nnz();
+
+    // Sort the rows longest first within each window of sigma rows, so
+    // the rows of a slice have similar lengths and need little padding
+    S.perm.resize(A.rows);
+    for (int i = 0; i < A.rows; i++)
+        S.perm[i] = i;
+    for (int w = 0; w < A.rows; w += sigma)
+        std::stable_sort(S.perm.begin() + w, S.perm.begin() + std::min(w + sigma, A.rows),
+            [&A](int a, int b) {
+                return A.row_ptr[a+1] - A.row_ptr[a] > A.row_ptr[b+1] - A.row_ptr[b]; });
+
+    const int slices = (A.rows + c - 1) / c;
+    S.slice_ptr.assign(slices + 1, 0);
+    S.slice_len.assign(slices, 0);
+    for (int r = 0; r < A.rows; r++)
+    {
+        const int i = S.perm[r];
+        S.slice_len[r / c] = std::max(S.slice_len[r / c], A.row_ptr[i+1] - A.row_ptr[i]);
+    }
+    for (int s = 0; s < slices; s++)
+        S.slice_ptr[s+1] = S.slice_ptr[s] + c * S.slice_len[s];
+
+    // Element j of sorted row r goes to column j of its slice
+    S.col.assign(S.slice_ptr[slices], 0);
+    S.val.assign(S.slice_ptr[slices], 0.0f);
+    for (int r = 0; r < A.rows; r++)
+    {
+        const int i = S.perm[r];
+        int at = S.slice_ptr[r / c] + r % c;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i+1]; k++, at += c)
+        {
+            S.col[at] = A.col[k];
+            S.val[at] = A.val[k];
+        }
+    }
+    return S;
+}
+
+SellMatrix csr_to_ell(const CsrMatrix& A)
+{
+    return csr_to_sell(A, std::max(1, A.rows), 1);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute y = A * x on the host
+//
+//------------------------------------------------------------------------------
+void csr_spmv(const CsrMatrix& A, const float *x, float *y)
+{
+    for (int i = 0; i < A.rows; i++)
+    {
+        double sum = 0.0;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i+1]; k++)
+            sum += (double)A.val[k] * x[A.col[k]];
+        y[i] = (float)sum;
+    }
+}
@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Sparse matrix formats (function prototypes)
+//
+//  PURPOSE: Storage for matrices that are mostly zeros, and converters
+//           from the dense row major matrices of matrix_lib:
+//
+//             CSR           the nonzeros row by row, with the column of
+//                           each and the start of each row
+//             SELL-C-sigma  rows sorted by length within windows of sigma
+//                           rows, cut into slices of c rows, and each
+//                           slice padded to its longest row and stored
+//                           column by column (see C_spmv_sell.cl)
+//             ELLPACK       SELL-C-sigma with one slice of all the rows
+//                           and no sorting
+//
+//------------------------------------------------------------------------------
+
+#ifndef __SPARSE_LIB_HDR
+#define __SPARSE_LIB_HDR
+
+#include <vector>
+
+#include "aligned_allocator.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  A matrix in CSR form
+//
+//------------------------------------------------------------------------------
+struct CsrMatrix
+{
+    int rows, cols;
+    std::vector<int> row_ptr;           // rows+1 starts of the rows in col and val
+    std::vector<int> col;               // column of each nonzero
+    util::aligned_vector<float> val;    // the nonzeros
+
+    int nnz() const { return (int)val.size(); }
+    size_t bytes() const { return sizeof(int) * (row_ptr.size() + col.size()) + sizeof(float) * val.size(); }
+};
+
+//------------------------------------------------------------------------------
+//
+//  A matrix in SELL-C-sigma form (ELLPACK when c = rows and sigma = 1)
+//
+//------------------------------------------------------------------------------
+struct SellMatrix
+{
+    int rows, cols;
+    int c, sigma;
+    int nnz;                            // nonzeros, not counting the padding
+    std::vector<int> slice_ptr;         // start of each slice in col and val
+    std::vector<int> slice_len;         // length of the longest row of each slice
+    std::vector<int> perm;              // original row of each sorted row
+    std::vector<int> col;               // column of each element (0 for padding)
+    util::aligned_vector<float> val;    // the elements (0 for padding)
+
+    size_t stored() const { return val.size(); }
+    size_t bytes() const { return sizeof(int) * (slice_ptr.size() + slice_len.size() + perm.size() + col.size())
+                                + sizeof(float) * val.size(); }
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to fill a dense row major matrix with random values in [-1, 1]
+//  at about a fraction density of its elements.  The density of each row
+//  varies (0 to 3 times the mean) so rows differ in length, as they do
+//  in real matrices.
+//
+//------------------------------------------------------------------------------
+void sparse_random(int rows, int cols, double density, util::aligned_vector<float>& A);
+
+//------------------------------------------------------------------------------
+//
+//  Functions to convert between the formats
+//
+//------------------------------------------------------------------------------
+CsrMatrix dense_to_csr(int rows, int cols, const util::aligned_vector<float>& A);
+SellMatrix csr_to_sell(const CsrMatrix& A, int c, int sigma);
+SellMatrix csr_to_ell(const CsrMatrix& A);
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute y = A * x on the host, as the reference
+//
+//------------------------------------------------------------------------------
+void csr_spmv(const CsrMatrix& A, const float *x, float *y);
+
+#endif
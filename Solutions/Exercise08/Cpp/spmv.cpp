@@ -0,0 +1,362 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Sparse matrix products benchmark
+//
+//  PURPOSE: Compare the sparse kernels with the dense blocked kernel
+//           (C_block_form.cl) on the same matrices, where A is mostly
+//           zeros:
+//
+//             SpMV   y = A * x       CSR with a row per work-item
+//                                    (C_spmv_csr.cl, scalar), CSR with a
+//                                    row per VEC work-items (vector),
+//                                    ELLPACK and SELL-C-sigma
+//                                    (C_spmv_sell.cl), against the
+//                                    blocked kernel with N = 1
+//             SpMM   C = A * B       CSR (C_spmm_csr.cl) against the
+//                                    blocked kernel
+//
+//           Every kernel is reported in GFLOP/s of useful work (2 flops
+//           per nonzero of A and column of the product, so the dense
+//           kernel is charged nothing for the zeros it multiplies) and in
+//           effective bandwidth: the bytes of the format, the vectors
+//           and the result, each counted once, over the time.
+//
+//  USAGE:   ./spmv [--size M N K] [--density d] [--reps n] [--device n]
+//
+//           A is M x K with a fraction d of nonzeros (SPARSE_DENSITY by
+//           default), x has K elements and B is K x N.  The sizes default
+//           to ORDER.
+//
+//  HISTORY: Written for the Exercise 8 solutions
+//
+//------------------------------------------------------------------------------
+
+#include <cstring>
+#include <algorithm>
+
+#include "matmul.hpp"
+#include "matrix_lib.hpp"
+#include "sparse_lib.hpp"
+#include "tuner.hpp"
+#include "util.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+#include "err_code.h"
+#include "device_picker.hpp"
+
+#define REPS 10          // default timed runs of each kernel
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the mean seconds of reps runs of launch, after one
+//  untimed run
+//
+//------------------------------------------------------------------------------
+template <typename F>
+static double time_runs(cl::CommandQueue& queue, int reps, F launch)
+{
+    util::Timer timer;
+    launch();
+    queue.finish();
+
+    const uint64_t start = timer.getTimeMicroseconds();
+    for (int r = 0; r < reps; r++)
+        launch();
+    queue.finish();
+    return (timer.getTimeMicroseconds() - start) / 1.0e6 / reps;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to print a kernel's rates and how it compares with the dense one
+//
+//------------------------------------------------------------------------------
+static void sparse_results(const char *label, double flops, double bytes,
+    double run_time, double dense_time)
+{
+    printf(" %-26s %9.3f ms %8.2f GFLOP/s %8.2f GB/s",
+        label, run_time * 1.0e3, flops / run_time / 1.0e9, bytes / run_time / 1.0e9);
+    if (dense_time > 0.0)
+        printf("  %6.1fx dense", dense_time / run_time);
+    printf("\n");
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the largest difference from the reference y,
+//  relative to its largest element
+//
+//------------------------------------------------------------------------------
+static double spmv_error(const util::aligned_vector<float>& y, const util::aligned_vector<float>& ref)
+{
+    double diff = 0.0, scale = 0.0;
+    for (size_t i = 0; i < y.size(); i++)
+    {
+        diff  = std::max(diff, (double)std::fabs(y[i] - ref[i]));
+        scale = std::max(scale, (double)std::fabs(ref[i]));
+    }
+    return scale > 0.0 ? diff / scale : diff;
+}
+
+int main(int argc, char *argv[])
+{
+    int M = ORDER, N = ORDER, K = ORDER;
+    double density = SPARSE_DENSITY;
+    int reps = REPS;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--size"))
+        {
+            if (i + 3 >= argc
+                || (M = atoi(argv[i+1])) < 1
+                || (N = atoi(argv[i+2])) < 1
+                || (K = atoi(argv[i+3])) < 1)
+            {
+                std::cout << "Invalid matrix sizes (try '--size M N K')\n";
+                return EXIT_FAILURE;
+            }
+            i += 3;
+        }
+        else if (!strcmp(argv[i], "--density"))
+        {
+            if (++i >= argc || (density = atof(argv[i])) <= 0.0 || density > 1.0)
+            {
+                std::cout << "Invalid density (try '--density 0.01')\n";
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!strcmp(argv[i], "--reps"))
+        {
+            if (++i >= argc || (reps = atoi(argv[i])) < 1)
+            {
+                std::cout << "Invalid number of runs\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+//--------------------------------------------------------------------------------
+// Build the matrices and their sparse forms
+//--------------------------------------------------------------------------------
+
+    util::aligned_vector<float> h_A, h_x(K), h_B((size_t)K*N), h_C((size_t)M*N);
+    util::aligned_vector<float> h_y(M), y_ref(M);
+
+    srand(RAND_SEED);
+    sparse_random(M, K, density, h_A);
+    for (int k = 0; k < K; k++)
+        h_x[k] = (float)(2.0 * rand() / RAND_MAX - 1.0);
+    for (size_t i = 0; i < h_B.size(); i++)
+        h_B[i] = (float)(2.0 * rand() / RAND_MAX - 1.0);
+
+    CsrMatrix  csr  = dense_to_csr(M, K, h_A);
+    if (csr.nnz() == 0)
+    {
+        std::cout << "A has no nonzeros (try a larger --density)\n";
+        return EXIT_FAILURE;
+    }
+    SellMatrix ell  = csr_to_ell(csr);
+    SellMatrix sell = csr_to_sell(csr, SELL_C, SELL_SIGMA);
+    csr_spmv(csr, &h_x[0], &y_ref[0]);
+
+    const double nnz = csr.nnz();
+    const double dense_bytes = sizeof(float) * (double)M * K;
+
+    printf("\n===== A is %d x %d with %d nonzeros (%.2f%%) ======\n",
+        M, K, csr.nnz(), 100.0 * nnz / ((double)M * K));
+    printf(" %-14s %12s %10s %10s\n", "format", "stored", "padding", "MB");
+    printf(" %-14s %12.0f %10s %10.2f\n", "dense", (double)M * K, "", dense_bytes / 1.0e6);
+    printf(" %-14s %12d %9.1f%% %10.2f\n", "CSR", csr.nnz(), 0.0, csr.bytes() / 1.0e6);
+    printf(" %-14s %12zu %9.1f%% %10.2f\n", "ELLPACK", ell.stored(),
+        100.0 * (ell.stored() - nnz) / nnz, ell.bytes() / 1.0e6);
+    printf(" SELL-%d-%-6d %12zu %9.1f%% %10.2f\n", SELL_C, SELL_SIGMA, sell.stored(),
+        100.0 * (sell.stored() - nnz) / nnz, sell.bytes() / 1.0e6);
+
+    try
+    {
+        cl_uint deviceIndex = 0;
+        parseArguments(argc, argv, &deviceIndex);
+
+        // Get list of devices
+        std::vector<cl::Device> devices;
+        unsigned numDevices = getDeviceList(devices);
+
+        // Check device index in range
+        if (deviceIndex >= numDevices)
+        {
+          std::cout << "Invalid device index (try '--list')\n";
+          return EXIT_FAILURE;
+        }
+
+        cl::Device device = devices[deviceIndex];
+
+        std::string name;
+        getDeviceName(device, name);
+        std::cout << "\nUsing OpenCL device: " << name << "\n";
+
+        std::vector<cl::Device> chosen_device;
+        chosen_device.push_back(device);
+        cl::Context context(chosen_device);
+        cl::CommandQueue queue(context, device);
+
+        const int max_wg = (int)device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+
+        // The formats in device memory
+        cl::Buffer d_row_ptr(context, csr.row_ptr.begin(), csr.row_ptr.end(), true);
+        cl::Buffer d_col(context, csr.col.begin(), csr.col.end(), true);
+        cl::Buffer d_val(context, csr.val.begin(), csr.val.end(), true);
+
+        cl::Buffer d_ell_ptr(context, ell.slice_ptr.begin(), ell.slice_ptr.end(), true);
+        cl::Buffer d_ell_len(context, ell.slice_len.begin(), ell.slice_len.end(), true);
+        cl::Buffer d_ell_perm(context, ell.perm.begin(), ell.perm.end(), true);
+        cl::Buffer d_ell_col(context, ell.col.begin(), ell.col.end(), true);
+        cl::Buffer d_ell_val(context, ell.val.begin(), ell.val.end(), true);
+
+        cl::Buffer d_sell_ptr(context, sell.slice_ptr.begin(), sell.slice_ptr.end(), true);
+        cl::Buffer d_sell_len(context, sell.slice_len.begin(), sell.slice_len.end(), true);
+        cl::Buffer d_sell_perm(context, sell.perm.begin(), sell.perm.end(), true);
+        cl::Buffer d_sell_col(context, sell.col.begin(), sell.col.end(), true);
+        cl::Buffer d_sell_val(context, sell.val.begin(), sell.val.end(), true);
+
+        cl::Buffer d_A(context, h_A.begin(), h_A.end(), true);
+        cl::Buffer d_x(context, h_x.begin(), h_x.end(), true);
+        cl::Buffer d_B(context, h_B.begin(), h_B.end(), true);
+        cl::Buffer d_y(context, CL_MEM_WRITE_ONLY, sizeof(float) * M);
+        cl::Buffer d_C(context, CL_MEM_WRITE_ONLY, sizeof(float) * h_C.size());
+
+//--------------------------------------------------------------------------------
+// SpMV: y = A * x
+//--------------------------------------------------------------------------------
+
+        printf("\n===== SpMV, y = A * x ======\n");
+
+        const double vec_bytes = sizeof(float) * ((double)K + M);
+        auto check_y = [&](const char *label)
+        {
+            cl::copy(queue, d_y, h_y.begin(), h_y.end());
+            const double err = spmv_error(h_y, y_ref);
+            if (err > TOL)
+                printf("  %s: errors in the product, relative error %g\n", label, err);
+        };
+
+        // The dense path: the blocked kernel with x as a K x 1 matrix
+        TuneParams params = default_tune_params();
+        load_tuning(TUNE_DB, device, M, 1, K, params);
+        const int bs = params.blksz;
+        cl::Program program = util::buildProgram(context, util::kernelSource("C_block_form.cl"),
+            block_options(params, M, 1, K));
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg>
+            block_mmul(program, "mmul");
+
+        const double dense_mv = time_runs(queue, reps, [&]() {
+            block_mmul(cl::EnqueueArgs(queue, cl::NDRange(ROUND_UP(1, bs), ROUND_UP(M, bs)), cl::NDRange(bs, bs)),
+                M, 1, K, d_A, d_x, d_y, cl::Local(sizeof(float) * bs*bs), cl::Local(sizeof(float) * bs*bs)); });
+        sparse_results("dense (C_block_form)", 2.0 * nnz, dense_bytes + vec_bytes, dense_mv, 0.0);
+        check_y("dense");
+
+        // CSR, a row per work-item
+        program = util::buildProgram(context, util::kernelSource("C_spmv_csr.cl"));
+        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer>
+            csr_scalar(program, "spmv_csr_scalar");
+
+        // CSR and ELL/SELL read x once per stored element
+        const double csr_bytes = csr.bytes() + sizeof(float) * nnz + vec_bytes;
+        double t = time_runs(queue, reps, [&]() {
+            csr_scalar(cl::EnqueueArgs(queue, cl::NDRange(M)),
+                M, d_row_ptr, d_col, d_val, d_x, d_y); });
+        sparse_results("CSR scalar", 2.0 * nnz, csr_bytes, t, dense_mv);
+        check_y("CSR scalar");
+
+        // CSR, a row per VEC work-items: VEC about the mean row length
+        int vec = 2;
+        while (vec < 32 && vec * 2 <= nnz / M)
+            vec *= 2;
+        const int wg = std::max(vec, std::min(SPMV_WG, max_wg) / vec * vec);
+        char options[32];
+        sprintf(options, "-DVEC=%d", vec);
+        program = util::buildProgram(context, util::kernelSource("C_spmv_csr.cl"), options);
+        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg>
+            csr_vector(program, "spmv_csr_vector");
+
+        t = time_runs(queue, reps, [&]() {
+            csr_vector(cl::EnqueueArgs(queue, cl::NDRange(ROUND_UP(M * vec, wg)), cl::NDRange(wg)),
+                M, d_row_ptr, d_col, d_val, d_x, d_y, cl::Local(sizeof(float) * wg)); });
+        char label[64];
+        sprintf(label, "CSR vector, %d per row", vec);
+        sparse_results(label, 2.0 * nnz, csr_bytes, t, dense_mv);
+        check_y("CSR vector");
+
+        // ELLPACK and SELL-C-sigma share a kernel
+        program = util::buildProgram(context, util::kernelSource("C_spmv_sell.cl"));
+        cl::make_kernel<int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer>
+            spmv_sell(program, "spmv_sell");
+
+        const int sell_wg = std::min(SELL_C, max_wg);
+        t = time_runs(queue, reps, [&]() {
+            spmv_sell(cl::EnqueueArgs(queue, cl::NDRange(ROUND_UP(M, sell_wg)), cl::NDRange(sell_wg)),
+                M, ell.c, d_ell_ptr, d_ell_len, d_ell_col, d_ell_val, d_ell_perm, d_x, d_y); });
+        sparse_results("ELLPACK", 2.0 * nnz, ell.bytes() + sizeof(float) * ell.stored() + vec_bytes,
+            t, dense_mv);
+        check_y("ELLPACK");
+
+        t = time_runs(queue, reps, [&]() {
+            spmv_sell(cl::EnqueueArgs(queue, cl::NDRange(ROUND_UP(M, sell_wg)), cl::NDRange(sell_wg)),
+                M, sell.c, d_sell_ptr, d_sell_len, d_sell_col, d_sell_val, d_sell_perm, d_x, d_y); });
+        sprintf(label, "SELL-%d-%d", SELL_C, SELL_SIGMA);
+        sparse_results(label, 2.0 * nnz, sell.bytes() + sizeof(float) * sell.stored() + vec_bytes,
+            t, dense_mv);
+        check_y("SELL");
+
+//--------------------------------------------------------------------------------
+// SpMM: C = A * B
+//--------------------------------------------------------------------------------
+
+        printf("\n===== SpMM, C = A * B with B %d x %d ======\n", K, N);
+
+        const double mm_flops = 2.0 * nnz * N;
+        const double mm_bytes = sizeof(float) * ((double)K * N + (double)M * N);
+
+        params = default_tune_params();
+        load_tuning(TUNE_DB, device, M, N, K, params);
+        const int mbs = params.blksz;
+        program = util::buildProgram(context, util::kernelSource("C_block_form.cl"),
+            block_options(params, M, N, K));
+        cl::make_kernel<int, int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg>
+            block_mm(program, "mmul");
+
+        const double dense_mm = time_runs(queue, reps, [&]() {
+            block_mm(cl::EnqueueArgs(queue, cl::NDRange(ROUND_UP(N, mbs), ROUND_UP(M, mbs)), cl::NDRange(mbs, mbs)),
+                M, N, K, d_A, d_B, d_C, cl::Local(sizeof(float) * mbs*mbs), cl::Local(sizeof(float) * mbs*mbs)); });
+        sparse_results("dense (C_block_form)", mm_flops, dense_bytes + mm_bytes, dense_mm, 0.0);
+        cl::copy(queue, d_C, h_C.begin(), h_C.end());
+        double residual = freivalds(M, N, K, h_A, h_B, h_C, FREIVALDS_ROUNDS);
+        if (std::isnan(residual) || residual > FREIVALDS_TOL(K))
+            printf("  dense: errors in the product, residual %g\n", residual);
+
+        program = util::buildProgram(context, util::kernelSource("C_spmm_csr.cl"));
+        cl::make_kernel<int, int, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer>
+            spmm_csr(program, "spmm_csr");
+
+        t = time_runs(queue, reps, [&]() {
+            spmm_csr(cl::EnqueueArgs(queue, cl::NDRange(N, M)),
+                M, N, d_row_ptr, d_col, d_val, d_B, d_C); });
+        sparse_results("CSR", mm_flops, csr.bytes() + mm_bytes, t, dense_mm);
+        cl::copy(queue, d_C, h_C.begin(), h_C.end());
+        residual = freivalds(M, N, K, h_A, h_B, h_C, FREIVALDS_ROUNDS);
+        if (std::isnan(residual) || residual > FREIVALDS_TOL(K))
+            printf("  CSR: errors in the product, residual %g\n", residual);
+
+    } catch (cl::Error err)
+    {
+        std::cout << "Exception\n";
+        std::cerr << "ERROR: "
+                  << err.what()
+                  << "("
+                  << err_code(err.err())
+                  << ")"
+                  << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Out-of-core matrix multiplication
+//
+//  PURPOSE: Compute C = A * B a TM x TN tile of C at a time:
+//
+//             C(ti,tj) = A(ti,:) * B(:,tj)
+//
+//           The tiles are visited row by row, so each panel of A is
+//           uploaded once and the panels of B once per row of tiles.
+//           The rows of an A panel are contiguous on the host; the B
+//           panels and C tiles are copied with the rectangular buffer
+//           transfers from OpenCL 1.1.
+//
+//           Uploads, kernels and downloads go to three command queues.
+//           Each operand has two device buffers, used by alternate tiles,
+//           and events order the work on each buffer:
+//
+//             upload of a panel  waits for the kernel that last read
+//                                that buffer
+//             kernel             waits for its two uploads and for the
+//                                download of the tile last held in its
+//                                C buffer
+//             download of C      waits for the kernel
+//
+//           Everything is enqueued up front, so while the kernel for one
+//           tile runs the next panels are uploaded and the previous tile
+//           of C is downloaded.
+//
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "matmul.hpp"
+#include "stream.hpp"
+#include "program_cache.hpp"
+#include "kernel_registry.hpp"
+
+#define STREAM_MEM_FRACTION 0.9  // share of global memory used by default
+
+//------------------------------------------------------------------------------
+//
+//  Function to check whether double buffered tiles of TM x TN fit
+//
+//------------------------------------------------------------------------------
+static bool tiles_fit(int TM, int TN, int K, cl_ulong budget, cl_ulong max_alloc)
+{
+    const cl_ulong Abytes = sizeof(float) * (cl_ulong)TM * K;
+    const cl_ulong Bbytes = sizeof(float) * (cl_ulong)K * TN;
+    const cl_ulong Cbytes = sizeof(float) * (cl_ulong)TM * TN;
+
+    return 2 * (Abytes + Bbytes + Cbytes) <= budget &&
+           Abytes <= max_alloc && Bbytes <= max_alloc && Cbytes <= max_alloc;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute C = A * B through a limited amount of device memory
+//
+//------------------------------------------------------------------------------
+double stream_mmul(cl::Context& context, cl::Device& device, const TuneParams& params,
+    int M, int N, int K, util::aligned_vector<float>& A, util::aligned_vector<float>& B, util::aligned_vector<float>& C,
+    cl_ulong mem_limit)
+{
+    util::Timer timer;
+
+    // Pick the largest tiles that fit, halving the longer side until they
+    // do.  Tiles are whole blocks of the kernel, so only the last row and
+    // column of tiles can be ragged.
+    cl_ulong budget = (cl_ulong)(STREAM_MEM_FRACTION * device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>());
+    if (mem_limit > 0 && mem_limit < budget)
+        budget = mem_limit;
+    const cl_ulong max_alloc = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+
+    int TM = ROUND_UP(M, params.tsm);
+    int TN = ROUND_UP(N, params.tsn);
+    while (!tiles_fit(TM, TN, K, budget, max_alloc))
+    {
+        if (TM >= TN && TM > params.tsm)
+            TM = ROUND_UP(TM / 2, params.tsm);
+        else if (TN > params.tsn)
+            TN = ROUND_UP(TN / 2, params.tsn);
+        else if (TM > params.tsm)
+            TM = ROUND_UP(TM / 2, params.tsm);
+        else
+            throw cl::Error(CL_MEM_OBJECT_ALLOCATION_FAILURE, "stream_mmul: K is too large for the memory limit");
+    }
+
+    const int mt = (M + TM - 1) / TM;
+    const int nt = (N + TN - 1) / TN;
+    printf(" Tiles of %d x %d (%d x %d tiles), %.1f of %.1f MB of device memory\n",
+        TM, TN, mt, nt,
+        2.0 * sizeof(float) * ((double)TM*K + (double)K*TN + (double)TM*TN) / (1024.0*1024.0),
+        device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() / (1024.0*1024.0));
+
+    // The register tiled kernel, built for the full sizes so EDGES is set
+    // when the ragged tiles need it
+    cl::Program program = util::buildProgram(context, util::kernelSource("C_block_reg.cl"),
+        reg_options(params, M, N, K));
+    cl::Kernel kernel(program, "mmul");
+
+    cl::CommandQueue upload(context, device);
+    cl::CommandQueue compute(context, device);
+    cl::CommandQueue download(context, device);
+
+    cl::Buffer d_a[2], d_b[2], d_c[2];
+    for (int s = 0; s < 2; s++)
+    {
+        d_a[s] = cl::Buffer(context, CL_MEM_READ_ONLY,  sizeof(float) * (size_t)TM * K);
+        d_b[s] = cl::Buffer(context, CL_MEM_READ_ONLY,  sizeof(float) * (size_t)K * TN);
+        d_c[s] = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * (size_t)TM * TN);
+    }
+
+    cl::Event a_ready[2], b_ready[2];   // uploads into each buffer
+    cl::Event a_used[2], b_used[2];     // last kernel to read each buffer
+    cl::Event computed[2], c_read[2];   // last kernel and download for each C buffer
+    bool a_busy[2] = {false, false};
+    bool bc_busy[2] = {false, false};
+
+    cl::size_t<3> origin;
+    origin[0] = origin[1] = origin[2] = 0;
+
+    uint64_t start = timer.getTimeMicroseconds();
+
+    int t = 0;
+    for (int ti = 0; ti < mt; ti++)
+    {
+        const int tm = std::min(TM, M - ti*TM);
+        const int sa = ti % 2;
+        std::vector<cl::Event> waits;
+
+        // Upload the panel A(ti,:), once the buffer is free
+        if (a_busy[sa])
+            waits.push_back(a_used[sa]);
+        upload.enqueueWriteBuffer(d_a[sa], CL_FALSE, 0, sizeof(float) * (size_t)tm * K,
+            &A[(size_t)ti * TM * K], &waits, &a_ready[sa]);
+        a_busy[sa] = true;
+
+        for (int tj = 0; tj < nt; tj++, t++)
+        {
+            const int tn = std::min(TN, N - tj*TN);
+            const int s  = t % 2;
+
+            // Upload the panel B(:,tj), K rows of tn floats, packed
+            // with a row pitch of tn in the device buffer
+            cl::size_t<3> host_origin, region;
+            host_origin[0] = sizeof(float) * tj*TN;
+            host_origin[1] = 0;
+            host_origin[2] = 0;
+            region[0] = sizeof(float) * tn;
+            region[1] = K;
+            region[2] = 1;
+
+            waits.clear();
+            if (bc_busy[s])
+                waits.push_back(b_used[s]);
+            upload.enqueueWriteBufferRect(d_b[s], CL_FALSE, origin, host_origin, region,
+                sizeof(float) * tn, 0, sizeof(float) * N, 0, &B[0], &waits, &b_ready[s]);
+
+            // Compute the tile C(ti,tj) of tm x tn
+            kernel.setArg(0, tm);
+            kernel.setArg(1, tn);
+            kernel.setArg(2, K);
+            kernel.setArg(3, d_a[sa]);
+            kernel.setArg(4, d_b[s]);
+            kernel.setArg(5, d_c[s]);
+            kernel.setArg(6, cl::Local(sizeof(float) * params.tsk*params.tsm));
+            kernel.setArg(7, cl::Local(sizeof(float) * params.tsk*params.tsn));
+
+            waits.clear();
+            waits.push_back(a_ready[sa]);
+            waits.push_back(b_ready[s]);
+            if (bc_busy[s])
+                waits.push_back(c_read[s]);
+            compute.enqueueNDRangeKernel(kernel, cl::NullRange,
+                cl::NDRange(ROUND_UP(tn, params.tsn)/params.wptn, ROUND_UP(tm, params.tsm)/params.wptm),
+                cl::NDRange(params.tsn/params.wptn, params.tsm/params.wptm),
+                &waits, &computed[s]);
+            a_used[sa] = computed[s];
+            b_used[s]  = computed[s];
+
+            // Download the tile into its place in C
+            host_origin[0] = sizeof(float) * tj*TN;
+            host_origin[1] = ti*TM;
+            region[0] = sizeof(float) * tn;
+            region[1] = tm;
+
+            waits.clear();
+            waits.push_back(computed[s]);
+            download.enqueueReadBufferRect(d_c[s], CL_FALSE, origin, host_origin, region,
+                sizeof(float) * tn, 0, sizeof(float) * N, 0, &C[0], &waits, &c_read[s]);
+            bc_busy[s] = true;
+        }
+    }
+
+    upload.finish();
+    compute.finish();
+    download.finish();
+
+    return (timer.getTimeMicroseconds() - start) / 1.0e6;
+}
@@ -0,0 +1,34 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Out-of-core matrix multiplication (function prototypes)
+//
+//  PURPOSE: Multiply matrices that do not fit in device memory.  C is
+//           split into tiles, and each tile is computed by the register
+//           tiled kernel (C_block_reg.cl) from a panel of rows of A and a
+//           panel of columns of B.  Two device buffers are used for each
+//           operand so the upload of the next panels and the download of
+//           the previous tile of C overlap the kernel for the current one.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __STREAM_HDR
+#define __STREAM_HDR
+
+#include "tuner.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  Function to compute C = A * B, streaming A(M,K), B(K,N) and C(M,N)
+//  through at most mem_limit bytes of device memory (0 means most of the
+//  device's global memory).  Returns the run time in seconds.
+//
+//  K is not split, so the limit must hold two panels of A and B with at
+//  least one block of rows or columns each; if not, cl::Error
+//  (CL_MEM_OBJECT_ALLOCATION_FAILURE) is thrown.
+//
+//------------------------------------------------------------------------------
+double stream_mmul(cl::Context& context, cl::Device& device, const TuneParams& params,
+    int M, int N, int K, util::aligned_vector<float>& A, util::aligned_vector<float>& B, util::aligned_vector<float>& C,
+    cl_ulong mem_limit);
+
+#endif
@@ -0,0 +1,345 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Autotuner for the blocked matrix multiplication kernels
+//
+//  PURPOSE: Search the block sizes of C_block_form.cl and C_block_reg.cl
+//           on the selected device and keep the fastest ones in a tuning
+//           database so later runs can skip the search.
+//
+//  USAGE:   The database is a plain text file with one line per key:
+//
+//             device <TAB> driver <TAB> MxNxK <TAB> blksz <TAB> tsm tsn tsk wptm wptn
+//
+//           Lines starting with '#' are comments.
+//
+//------------------------------------------------------------------------------
+
+#include <cstring>
+#include <sstream>
+#include <fstream>
+
+#include "matmul.hpp"
+#include "tuner.hpp"
+#include "matrix_lib.hpp"
+#include "kernel_registry.hpp"
+
+#define TUNE_REPS 3      // timed runs per candidate (the best one is kept)
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the compile time defaults from matmul.hpp
+//
+//------------------------------------------------------------------------------
+TuneParams default_tune_params()
+{
+    TuneParams params;
+    params.blksz = BLKSZ;
+    params.tsm   = REG_TSM;
+    params.tsn   = REG_TSN;
+    params.tsk   = REG_TSK;
+    params.wptm  = REG_WPTM;
+    params.wptn  = REG_WPTN;
+    return params;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Functions to return the build options for each blocked kernel
+//
+//------------------------------------------------------------------------------
+std::string block_options(const TuneParams& params, int M, int N, int K)
+{
+    std::ostringstream options;
+    options << "-Dblksz=" << params.blksz;
+    if (M % params.blksz || N % params.blksz || K % params.blksz)
+        options << " -DEDGES";
+    return options.str();
+}
+
+std::string reg_options(const TuneParams& params, int M, int N, int K)
+{
+    std::ostringstream options;
+    options << "-DTSM="  << params.tsm
+            << " -DTSN=" << params.tsn
+            << " -DTSK=" << params.tsk
+            << " -DWPTM=" << params.wptm
+            << " -DWPTN=" << params.wptn;
+    if (M % params.tsm || N % params.tsn || K % params.tsk)
+        options << " -DEDGES";
+    return options.str();
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to make a device string safe to use as a database field
+//
+//------------------------------------------------------------------------------
+static std::string clean_field(std::string s)
+{
+    // Some platforms include the terminating null in string queries
+    s = s.c_str();
+    for (size_t i = 0; i < s.size(); i++)
+        if (s[i] == '\t' || s[i] == '\n' || s[i] == '\r')
+            s[i] = ' ';
+    while (!s.empty() && s[s.size()-1] == ' ')
+        s.erase(s.size()-1);
+    return s;
+}
+
+static std::string tuning_key(cl::Device& device, int M, int N, int K)
+{
+    std::ostringstream key;
+    key << clean_field(device.getInfo<CL_DEVICE_NAME>()) << "\t"
+        << clean_field(device.getInfo<CL_DRIVER_VERSION>()) << "\t"
+        << M << "x" << N << "x" << K;
+    return key.str();
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to look up the tuned parameters for a device and matrix sizes
+//
+//------------------------------------------------------------------------------
+bool load_tuning(const std::string& db, cl::Device& device, int M, int N, int K, TuneParams& params)
+{
+    std::ifstream in(db.c_str());
+    if (!in.is_open())
+        return false;
+
+    std::string key = tuning_key(device, M, N, K) + "\t";
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.compare(0, key.size(), key) != 0)
+            continue;
+
+        TuneParams found;
+        std::istringstream fields(line.substr(key.size()));
+        if (fields >> found.blksz >> found.tsm >> found.tsn
+                   >> found.tsk >> found.wptm >> found.wptn)
+        {
+            params = found;
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to store the tuned parameters for a device and matrix sizes
+//
+//------------------------------------------------------------------------------
+void save_tuning(const std::string& db, cl::Device& device, int M, int N, int K, const TuneParams& params)
+{
+    std::string key = tuning_key(device, M, N, K) + "\t";
+    std::vector<std::string> lines;
+
+    // Keep every line except an earlier entry for the same key
+    std::ifstream in(db.c_str());
+    std::string line;
+    while (std::getline(in, line))
+        if (line.compare(0, key.size(), key) != 0)
+            lines.push_back(line);
+    in.close();
+
+    if (lines.empty())
+        lines.push_back("# device\tdriver\tMxNxK\tblksz\ttsm tsn tsk wptm wptn");
+
+    std::ostringstream entry;
+    entry << key << params.blksz << "\t"
+          << params.tsm << " " << params.tsn << " " << params.tsk << " "
+          << params.wptm << " " << params.wptn;
+    lines.push_back(entry.str());
+
+    std::ofstream out(db.c_str());
+    if (!out.is_open())
+    {
+        std::cout << "Cannot write tuning database: " << db << std::endl;
+        return;
+    }
+    for (size_t i = 0; i < lines.size(); i++)
+        out << lines[i] << "\n";
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to build one candidate and time it.  Returns the best run time
+//  in seconds, or a negative value if the candidate fails to build, fails
+//  to run, or gives the wrong answer.
+//
+//------------------------------------------------------------------------------
+static double time_candidate(cl::Context& context, cl::Device& device, cl::CommandQueue& queue,
+    const std::string& source, const std::string& options, int M, int N, int K,
+    const util::aligned_vector<float>& h_A, const util::aligned_vector<float>& h_B,
+    cl::Buffer& d_a, cl::Buffer& d_b, cl::Buffer& d_c,
+    size_t Ablock, size_t Bblock, cl::NDRange global, cl::NDRange local, size_t wgsize)
+{
+    util::Timer timer;
+    util::aligned_vector<float> h_C(M*N);
+    double best = -1.0;
+
+    try
+    {
+        cl::Program program(context, source);
+        program.build(options.c_str());
+
+        cl::Kernel kernel(program, "mmul");
+        if (wgsize > kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device))
+            return -1.0;
+
+        kernel.setArg(0, M);
+        kernel.setArg(1, N);
+        kernel.setArg(2, K);
+        kernel.setArg(3, d_a);
+        kernel.setArg(4, d_b);
+        kernel.setArg(5, d_c);
+        kernel.setArg(6, cl::Local(Ablock));
+        kernel.setArg(7, cl::Local(Bblock));
+
+        // Warm up run (also used to check the answer)
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local);
+        queue.finish();
+        cl::copy(queue, d_c, h_C.begin(), h_C.end());
+        const double residual = freivalds(M, N, K, h_A.data(), h_B.data(), h_C.data(),
+            FREIVALDS_ROUNDS);
+        if (std::isnan(residual) || residual > FREIVALDS_TOL(K))
+            return -1.0;
+
+        for (int r = 0; r < TUNE_REPS; r++)
+        {
+            uint64_t start = timer.getTimeMicroseconds();
+            queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local);
+            queue.finish();
+            double run_time = (timer.getTimeMicroseconds() - start) / 1.0e6;
+            if (best < 0.0 || run_time < best)
+                best = run_time;
+        }
+    }
+    catch (cl::Error err)
+    {
+        // Candidates that the device cannot build or run are skipped
+        return -1.0;
+    }
+
+    return best;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to search for the fastest parameters on a device
+//
+//------------------------------------------------------------------------------
+bool autotune(cl::Context& context, cl::Device& device, cl::CommandQueue& queue,
+    int M, int N, int K, const util::aligned_vector<float>& h_A,
+    const util::aligned_vector<float>& h_B, cl::Buffer& d_a, cl::Buffer& d_b,
+    cl::Buffer& d_c, TuneParams& tuned)
+{
+    static const int blksz_list[] = {4, 8, 16, 32};
+    static const int ts_list[]    = {32, 64, 128};
+    static const int tsk_list[]   = {8, 16, 32};
+    static const int wpt_list[]   = {4, 8};
+
+    const size_t max_wg    = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const cl_ulong max_loc = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+
+    TuneParams params = default_tune_params();
+    const double flops = 2.0 * M * N * K;
+    double best;
+    bool found = true;  // a candidate of each kernel passed
+    char label[128];
+
+    printf("\n===== Autotuning blocked kernels, %d x %d x %d ======\n", M, N, K);
+
+    // Blocked kernel: one element of C per work-item
+    std::string source = util::kernelSource("C_block_form.cl");
+    best = -1.0;
+    for (size_t b = 0; b < sizeof(blksz_list)/sizeof(int); b++)
+    {
+        TuneParams cand = params;
+        cand.blksz = blksz_list[b];
+        size_t wgsize = cand.blksz * cand.blksz;
+        size_t bytes  = sizeof(float) * cand.blksz * cand.blksz;
+        if (wgsize > max_wg || 2*bytes > max_loc)
+            continue;
+
+        double t = time_candidate(context, device, queue, source,
+            block_options(cand, M, N, K), M, N, K, h_A, h_B, d_a, d_b, d_c, bytes, bytes,
+            cl::NDRange(ROUND_UP(N, cand.blksz), ROUND_UP(M, cand.blksz)),
+            cl::NDRange(cand.blksz, cand.blksz), wgsize);
+
+        sprintf(label, "blksz=%d", cand.blksz);
+        if (t < 0.0)
+            printf(" %-36s skipped\n", label);
+        else
+            printf(" %-36s %.4f seconds at %.1f MFLOPS\n", label, t, flops / (1000000.0 * t));
+
+        if (t >= 0.0 && (best < 0.0 || t < best))
+        {
+            best = t;
+            params.blksz = cand.blksz;
+        }
+    }
+    found = found && best >= 0.0;
+
+    // Register tiled kernel: a micro-tile of C per work-item
+    source = util::kernelSource("C_block_reg.cl");
+    best = -1.0;
+    for (size_t m = 0; m < sizeof(ts_list)/sizeof(int); m++)
+    for (size_t n = 0; n < sizeof(ts_list)/sizeof(int); n++)
+    for (size_t k = 0; k < sizeof(tsk_list)/sizeof(int); k++)
+    for (size_t wm = 0; wm < sizeof(wpt_list)/sizeof(int); wm++)
+    for (size_t wn = 0; wn < sizeof(wpt_list)/sizeof(int); wn++)
+    {
+        TuneParams cand = params;
+        cand.tsm  = ts_list[m];
+        cand.tsn  = ts_list[n];
+        cand.tsk  = tsk_list[k];
+        cand.wptm = wpt_list[wm];
+        cand.wptn = wpt_list[wn];
+
+        // The kernel needs whole float4 loads per work-item
+        size_t wgsize = (cand.tsm / cand.wptm) * (cand.tsn / cand.wptn);
+        size_t Abytes = sizeof(float) * cand.tsk * cand.tsm;
+        size_t Bbytes = sizeof(float) * cand.tsk * cand.tsn;
+        if (wgsize > max_wg || Abytes + Bbytes > max_loc ||
+            (cand.tsk * cand.tsm) % (4 * wgsize) != 0 ||
+            (cand.tsk * cand.tsn) % (4 * wgsize) != 0)
+            continue;
+
+        double t = time_candidate(context, device, queue, source,
+            reg_options(cand, M, N, K), M, N, K, h_A, h_B, d_a, d_b, d_c, Abytes, Bbytes,
+            cl::NDRange(ROUND_UP(N, cand.tsn) / cand.wptn, ROUND_UP(M, cand.tsm) / cand.wptm),
+            cl::NDRange(cand.tsn / cand.wptn, cand.tsm / cand.wptm), wgsize);
+
+        sprintf(label, "tile=%dx%dx%d micro=%dx%d",
+            cand.tsm, cand.tsn, cand.tsk, cand.wptm, cand.wptn);
+        if (t < 0.0)
+            printf(" %-36s skipped\n", label);
+        else
+            printf(" %-36s %.4f seconds at %.1f MFLOPS\n", label, t, flops / (1000000.0 * t));
+
+        if (t >= 0.0 && (best < 0.0 || t < best))
+        {
+            best = t;
+            params.tsm  = cand.tsm;
+            params.tsn  = cand.tsn;
+            params.tsk  = cand.tsk;
+            params.wptm = cand.wptm;
+            params.wptn = cand.wptn;
+        }
+    }
+    found = found && best >= 0.0;
+
+    if (!found)
+    {
+        printf(" No candidate of a kernel gave the right answer: nothing tuned\n");
+        return false;
+    }
+
+    printf(" Selected blksz=%d, tile=%dx%dx%d micro=%dx%d\n",
+        params.blksz, params.tsm, params.tsn, params.tsk, params.wptm, params.wptn);
+
+    tuned = params;
+    return true;
+}
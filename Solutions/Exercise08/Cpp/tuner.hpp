@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Autotuner for the blocked matrix multiplication kernels
+//           (function prototypes)
+//
+//  PURPOSE: The blocked kernels (C_block_form.cl and C_block_reg.cl) take
+//           their block sizes as compile time constants.  The best values
+//           depend on the device, so the tuner rebuilds the kernels with
+//           -D options for a range of candidates, times each one, and
+//           remembers the winner in a small on-disk database keyed by
+//           device name, driver version and matrix sizes.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __TUNER_HDR
+#define __TUNER_HDR
+
+#include <string>
+
+#include "aligned_allocator.hpp"
+
+//------------------------------------------------------------------------------
+//
+//  Parameters for the blocked kernels
+//
+//------------------------------------------------------------------------------
+struct TuneParams
+{
+    int blksz;      // block size for C_block_form.cl (work-group is blksz x blksz)
+
+    int tsm;        // rows of C per work-group for C_block_reg.cl
+    int tsn;        // columns of C per work-group
+    int tsk;        // depth of the A and B blocks in local memory
+    int wptm;       // rows of C per work-item
+    int wptn;       // columns of C per work-item
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to return the compile time defaults from matmul.hpp
+//
+//------------------------------------------------------------------------------
+TuneParams default_tune_params();
+
+//------------------------------------------------------------------------------
+//
+//  Functions to return the build options for each blocked kernel.  EDGES
+//  is added when the matrix sizes are not multiples of the block sizes.
+//
+//------------------------------------------------------------------------------
+std::string block_options(const TuneParams& params, int M, int N, int K);
+std::string reg_options(const TuneParams& params, int M, int N, int K);
+
+//------------------------------------------------------------------------------
+//
+//  Function to look up the tuned parameters for a device and matrix sizes.
+//  Returns false (and leaves params alone) if there is no entry.
+//
+//------------------------------------------------------------------------------
+bool load_tuning(const std::string& db, cl::Device& device, int M, int N, int K, TuneParams& params);
+
+//------------------------------------------------------------------------------
+//
+//  Function to store the tuned parameters for a device and matrix sizes,
+//  replacing any earlier entry with the same key
+//
+//------------------------------------------------------------------------------
+void save_tuning(const std::string& db, cl::Device& device, int M, int N, int K, const TuneParams& params);
+
+//------------------------------------------------------------------------------
+//
+//  Function to search for the fastest parameters on a device.  d_a and d_b
+//  must hold h_A and h_B, which each candidate's C is checked against with
+//  freivalds().  Returns false (and leaves params alone) if no candidate of
+//  one of the kernels gave the right answer.
+//
+//------------------------------------------------------------------------------
+bool autotune(cl::Context& context, cl::Device& device, cl::CommandQueue& queue,
+    int M, int N, int K, const util::aligned_vector<float>& h_A,
+    const util::aligned_vector<float>& h_B, cl::Buffer& d_a, cl::Buffer& d_b,
+    cl::Buffer& d_c, TuneParams& params);
+
+#endif
@@ -78,7 +78,7 @@ d_c = cl.Buffer(context, cl.mem_flags.WRITE_ONLY, h_C.nbytes)
 kernelsource = open("../C_elem.cl").read()
 program = cl.Program(context, kernelsource).build()
 mmul = program.mmul
-mmul.set_scalar_arg_dtypes([numpy.int32, None, None, None])
+mmul.set_scalar_arg_dtypes([numpy.int32, numpy.int32, numpy.int32, None, None, None])
 print "\n===== OpenCL, matrix mult, C(i,j) per work item, order", N, "======\n"
 
 # Do the multiplication COUNT times
@@ -86,7 +86,7 @@ for i in range(COUNT):
     h_C.fill(0.0)
     start_time = time()
 
-    mmul(queue, (N, N), None, N, d_a, d_b, d_c)
+    mmul(queue, (N, N), None, N, N, N, d_a, d_b, d_c)
     queue.finish()
 
     run_time = time() - start_time
@@ -101,14 +101,14 @@ for i in range(COUNT):
 kernelsource = open("../C_row.cl").read()
 program = cl.Program(context, kernelsource).build()
 mmul = program.mmul
-mmul.set_scalar_arg_dtypes([numpy.int32, None, None, None])
+mmul.set_scalar_arg_dtypes([numpy.int32, numpy.int32, numpy.int32, None, None, None])
 print "\n===== OpenCL, matrix mult, C row per work item, order", N, "======\n"
 # Do the multiplication COUNT times
 for i in range(COUNT):
     h_C.fill(0.0)
     start_time = time()
 
-    mmul(queue, (N,), (ORDER/16,), N, d_a, d_b, d_c)
+    mmul(queue, (N,), (ORDER/16,), N, N, N, d_a, d_b, d_c)
     queue.finish()
 
     run_time = time() - start_time
@@ -123,14 +123,14 @@ for i in range(COUNT):
 kernelsource = open("../C_row_priv.cl").read()
 program = cl.Program(context, kernelsource).build()
 mmul = program.mmul
-mmul.set_scalar_arg_dtypes([numpy.int32, None, None, None])
+mmul.set_scalar_arg_dtypes([numpy.int32, numpy.int32, numpy.int32, None, None, None])
 print "\n===== OpenCL, matrix mult, C row, A row in priv mem, order", N, "======\n"
 # Do the multiplication COUNT times
 for i in range(COUNT):
     h_C.fill(0.0)
     start_time = time()
 
-    mmul(queue, (N,), (ORDER/16,), N, d_a, d_b, d_c)
+    mmul(queue, (N,), (ORDER/16,), N, N, N, d_a, d_b, d_c)
     queue.finish()
 
     run_time = time() - start_time
@@ -145,7 +145,7 @@ for i in range(COUNT):
 kernelsource = open("../C_row_priv_bloc.cl").read()
 program = cl.Program(context, kernelsource).build()
 mmul = program.mmul
-mmul.set_scalar_arg_dtypes([numpy.int32, None, None, None, None])
+mmul.set_scalar_arg_dtypes([numpy.int32, numpy.int32, numpy.int32, None, None, None, None])
 print "\n===== OpenCL, mat mult, C row, priv A, B cols loc, order", N, "======\n"
 # Do the multiplication COUNT times
 for i in range(COUNT):
@@ -153,7 +153,7 @@ for i in range(COUNT):
     start_time = time()
 
     localmem = cl.LocalMemory(numpy.dtype(numpy.float32).itemsize * N)
-    mmul(queue, (N,), (ORDER/16,), N,
+    mmul(queue, (N,), (ORDER/16,), N, N, N,
     	d_a, d_b, d_c, localmem)
     queue.finish()
 
@@ -169,7 +169,7 @@ for i in range(COUNT):
 kernelsource = open("../C_block_form.cl").read()
 program = cl.Program(context, kernelsource).build()
 mmul = program.mmul
-mmul.set_scalar_arg_dtypes([numpy.int32, None, None, None, None, None])
+mmul.set_scalar_arg_dtypes([numpy.int32, numpy.int32, numpy.int32, None, None, None, None, None])
 print "\n==== Parallel matrix mult (blocked), order {0} on device ======\n".format(N)
 # Do the multiplication COUNT times
 for i in range(COUNT):
@@ -183,7 +183,7 @@ for i in range(COUNT):
 
     A_block = cl.LocalMemory(numpy.dtype(numpy.float32).itemsize * blocksize * blocksize)
     B_block = cl.LocalMemory(numpy.dtype(numpy.float32).itemsize * blocksize * blocksize)
-    mmul(queue, (N,N), (blocksize,blocksize), N,
+    mmul(queue, (N,N), (blocksize,blocksize), N, N, N,
         d_a, d_b, d_c, A_block, B_block)
     queue.finish()
 
@@ -21,37 +21,13 @@
 #include <CL/cl.h>
 #endif
 
+#include "kernel_registry.h"
 #include "err_code.h"
 #include "device_picker.h"
 
 
 extern double wtime();       // returns time since some fixed past point (wtime.c)
 
-//------------------------------------------------------------------------------
-char * getKernelSource(char *filename)
-{
-    FILE *file = fopen(filename, "r");
-    if (!file)
-    {
-        fprintf(stderr, "Error: Could not open kernel source file\n");
-        exit(EXIT_FAILURE);
-    }
-    fseek(file, 0, SEEK_END);
-    int len = ftell(file) + 1;
-    rewind(file);
-
-    char *source = (char *)calloc(sizeof(char), len);
-    if (!source)
-    {
-        fprintf(stderr, "Error: Could not allocate memory for source string\n");
-        exit(EXIT_FAILURE);
-    }
-    fread(source, sizeof(char), len, file);
-    fclose(file);
-    return source;
-}
-
-
 //------------------------------------------------------------------------------
 
 #define INSTEPS (512*512*512)
@@ -72,7 +48,7 @@ int main(int argc, char *argv[])
 
     cl_mem d_partial_sums;
 
-    char *kernelsource = getKernelSource("../pi_ocl.cl");             // Kernel source
+    char *kernelsource = kernelSource("pi_ocl.cl");             // Kernel source
 
     cl_int err;
     cl_device_id        device;     // compute device id
@@ -14,6 +14,8 @@
 
 #include "cl.hpp"
 #include "util.hpp"
+#include "kernel_registry.hpp"
+#include "program_cache.hpp"
 
 
 #include <vector>
@@ -71,8 +73,9 @@ int main(int argc, char *argv[])
         cl::Context context(chosen_device);
         cl::CommandQueue queue(context, device);
 
-        // Create the program object
-        cl::Program program(context, util::loadProgram("../pi_ocl.cl"), true);
+        // Create the program object, from the binary cache if it has been
+        // built before (see program_cache.hpp)
+        cl::Program program = util::buildProgram(context, util::kernelSource("pi_ocl.cl"));
 
         // Create the kernel object for quering information
         cl::Kernel ko_pi(program, "pi");
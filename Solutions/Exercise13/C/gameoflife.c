@@ -17,6 +17,7 @@
 #include <CL/cl.h>
 #endif
 
+#include "kernel_registry.h"
 #include "err_code.h"
 
 // pick up device type from compiler command line or from the default type
@@ -39,8 +40,6 @@ void print_board(const char* board, const unsigned int nx, const unsigned int ny
 void save_board(const char* board, const unsigned int nx, const unsigned int ny);
 void load_params(const char *file, unsigned int *nx, unsigned int *ny, unsigned int *iterations);
 
-char *getKernelSource(char*);
-
 /*************************************************************************************
  * Main function
  ************************************************************************************/
@@ -94,7 +93,7 @@ int main(int argc, char **argv)
     checkError(err, "Creating command queue");
 
     // Create the compute program from the source buffer
-    char *kernel_source = getKernelSource("../gameoflife.cl");
+    char *kernel_source = kernelSource("gameoflife.cl");
     program = clCreateProgramWithSource(context, 1, (const char **) &kernel_source, NULL, &err);
     checkError(err, "Creating program");
 
@@ -280,26 +279,3 @@ void die(const char* message, const int line, const char *file)
   fflush(stderr);
   exit(EXIT_FAILURE);
 }
-
-char *getKernelSource(char *filename)
-{
-    FILE *file = fopen(filename, "r");
-    if (!file)
-    {
-        fprintf(stderr, "Error: Could not open kernel source file\n");
-        exit(EXIT_FAILURE);
-    }
-    fseek(file, 0, SEEK_END);
-    int len = ftell(file) + 1;
-    rewind(file);
-
-    char *source = (char *)calloc(sizeof(char), len);
-    if (!source)
-    {
-        fprintf(stderr, "Error: Could not allocate memory for source string\n");
-        exit(EXIT_FAILURE);
-    }
-    fread(source, sizeof(char), len, file);
-    fclose(file);
-    return source;
-}
@@ -16,6 +16,8 @@
 #include "cl.hpp"
 
 #include "util.hpp"
+#include "kernel_registry.hpp"
+#include "program_cache.hpp"
 
 //pick up device type from compiler command line or from 
 //the default type
@@ -71,23 +73,9 @@ int main(int argc, char **argv)
     {
         cl::Context context(DEVICE);
         cl::CommandQueue queue(context);
-        cl::Program program(context, util::loadProgram("../gameoflife.cl"));
-        try
-        {
-            program.build();
-        }
-        catch (cl::Error error)
-        {
-            // If it was a build error then show the error
-            if (error.err() == CL_BUILD_PROGRAM_FAILURE)
-            {
-                std::vector<cl::Device> devices;
-                devices = context.getInfo<CL_CONTEXT_DEVICES>();
-                std::string built = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(devices[0]);
-                std::cerr << built << "\n";
-            }
-            throw error;
-        }
+        // From the binary cache if it has been built before; a build
+        // error shows the build log (see program_cache.hpp)
+        cl::Program program = util::buildProgram(context, util::kernelSource("gameoflife.cl"));
 
         cl::make_kernel
             <cl::Buffer, cl::Buffer, unsigned int, unsigned int, cl::LocalSpaceArg>
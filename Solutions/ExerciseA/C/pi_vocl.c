@@ -20,6 +20,7 @@
 #include <CL/cl.h>
 #endif
 
+#include "kernel_registry.h"
 #include "err_code.h"
 
 //pick up device type from compiler command line or from 
@@ -29,7 +30,6 @@
 #endif
 
 double wtime();
-char * getKernelSource(char*);
 
 
 
@@ -108,7 +108,7 @@ int main(int argc, char** argv)
     queue = clCreateCommandQueue(context, device, 0, &err);
     checkError(err, "Creating command queue");
     // Create the compute program from the source buffer
-    char *kernel_source = getKernelSource("../pi_vocl.cl");
+    char *kernel_source = kernelSource("pi_vocl.cl");
     program = clCreateProgramWithSource(context, 1, (const char**)&kernel_source, NULL, &err);
     checkError(err, "Creating program");
     // Build the program
@@ -212,29 +212,3 @@ int main(int argc, char** argv)
     free(kernel_source);
 
 }
-
-//------------------------------------------------------------------------------
-
-char * getKernelSource(char *filename)
-{
-    FILE *file = fopen(filename, "r");
-    if (!file)
-    {
-        fprintf(stderr, "Error: Could not open kernel source file\n");
-        exit(EXIT_FAILURE);
-    }
-    fseek(file, 0, SEEK_END);
-    int len = ftell(file) + 1;
-    rewind(file);
-
-    char *source = (char *)calloc(sizeof(char), len);
-    if (!source)
-    {
-        fprintf(stderr, "Error: Could not allocate memory for source string\n");
-        exit(EXIT_FAILURE);
-    }
-    fread(source, sizeof(char), len, file);
-    fclose(file);
-    return source;
-}
-
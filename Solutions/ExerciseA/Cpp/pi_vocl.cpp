@@ -15,6 +15,8 @@
 
 #include "cl.hpp"
 #include "util.hpp"
+#include "kernel_registry.hpp"
+#include "program_cache.hpp"
 
 #include <vector>
 #include <iostream>
@@ -73,10 +75,11 @@ int main(int argc, char** argv)
 
 	try
 	{
-		// Create context, queue and build program
+		// Create context, queue and build program (from the binary cache
+		// if it has been built before)
 		cl::Context context(DEVICE);
 		cl::CommandQueue queue(context);
-		cl::Program program(context, util::loadProgram("../pi_vocl.cl"), true);
+		cl::Program program = util::buildProgram(context, util::kernelSource("pi_vocl.cl"));
 		cl::Kernel kernel;
 
 		// Now that we know the size of the work_groups, we can set the number of work